@@ -0,0 +1,46 @@
+// Compares a dsp-bench JSON result against a baseline and exits non-zero when
+// any case got slower than the tolerance allows.
+//
+//   node bench/compare.mjs results-native.json baseline.json [--tolerance 0.10]
+import fs from 'node:fs';
+
+const args = process.argv.slice(2);
+const tolIdx = args.indexOf('--tolerance');
+const tolerance = tolIdx >= 0 ? Number(args[tolIdx + 1]) : 0.10;
+const [resultPath, baselinePath] = args.filter((a, i) => tolIdx < 0 || (i !== tolIdx && i !== tolIdx + 1));
+
+if (!resultPath || !baselinePath) {
+  console.error('usage: compare.mjs <result.json> <baseline.json> [--tolerance 0.10]');
+  process.exit(2);
+}
+
+const result = JSON.parse(fs.readFileSync(resultPath, 'utf8'));
+const baselineFile = JSON.parse(fs.readFileSync(baselinePath, 'utf8'));
+// baseline.json holds one result object per target ("native", "wasm")
+const baseline = baselineFile[result.target];
+if (!baseline) {
+  console.error(`No "${result.target}" baseline in ${baselinePath}`);
+  process.exit(2);
+}
+
+let regressions = 0;
+for (const [name, cur] of Object.entries(result.cases)) {
+  const base = baseline.cases[name];
+  if (!base) {
+    console.log(`${name.padEnd(20)} ${cur.nsPerSampleVoice.toFixed(2).padStart(8)} ns  (no baseline)`);
+    continue;
+  }
+  const delta = cur.nsPerSampleVoice / base.nsPerSampleVoice - 1;
+  const flag = delta > tolerance ? 'REGRESSION' : delta < -tolerance ? 'faster' : '';
+  if (delta > tolerance) regressions++;
+  console.log(
+    `${name.padEnd(20)} ${cur.nsPerSampleVoice.toFixed(2).padStart(8)} ns  ` +
+    `base ${base.nsPerSampleVoice.toFixed(2).padStart(8)} ns  ` +
+    `${(delta * 100).toFixed(1).padStart(6)}%  ${String(cur.maxPolyphony128).padStart(5)} voices  ${flag}`
+  );
+}
+
+if (regressions > 0) {
+  console.error(`${regressions} case(s) more than ${(tolerance * 100).toFixed(0)}% slower than baseline`);
+  process.exit(1);
+}
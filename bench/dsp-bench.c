@@ -0,0 +1,146 @@
+// dsp-bench.c
+//
+// Render-cost benchmark for src/dsp.c. Builds natively or with emcc for node;
+// see bench/Makefile (or the dsp-bench target in CMakeLists.txt, which builds
+// it with -march=native).
+//
+// Each case renders N looping voices for M seconds of audio in 128-frame
+// quanta at 48 kHz with SF2-typical envelope, filter and LFO settings, then
+// reports the cost per output sample per voice and how many voices fit in
+// the real-time budget of one 128-frame quantum. Each case is run --repeat
+// times and the fastest run is kept, which filters out scheduler noise.
+// Output is JSON so bench/compare.mjs can diff it against bench/baseline.json.
+//
+//   ./dsp-bench [--voices N] [--seconds M] [--repeat R] [--threads T]
+//
+// --threads sets synthSetThreadCount in DSP_THREADS builds (the CMake one);
+// times are wall clock, so more threads lower them.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../src/dsp.c"
+
+#define BENCH_SR 48000.0
+#define BENCH_QUANTUM 128
+#define BENCH_BANK_FRAMES (48000 * 2)
+
+typedef struct {
+    const char* name;
+    int interpolation;   // INTERP_*
+    int controlInterval; // frames per modulation update
+    int stereo;
+} BenchCase;
+
+static const BenchCase cases[] = {
+    { "linear-cr1", INTERP_LINEAR, 1, 0 },
+    { "linear-cr16", INTERP_LINEAR, 16, 0 },
+    { "hermite-cr16", INTERP_HERMITE, 16, 0 },
+    { "sinc8-cr16", INTERP_SINC8, 16, 0 },
+    { "sinc16-cr16", INTERP_SINC16, 16, 0 },
+    { "sinc8-cr16-stereo", INTERP_SINC8, 16, 1 },
+};
+
+static int16_t bank[BENCH_BANK_FRAMES * 2];
+
+static double nowSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Harmonic-rich tone so the interpolators and filter see realistic content
+static void fillBank(void) {
+    for (int i = 0; i < BENCH_BANK_FRAMES; i++) {
+        double t = i / BENCH_SR;
+        double x = 0.5 * sin(2.0 * M_PI * 220.0 * t) + 0.25 * sin(2.0 * M_PI * 660.0 * t) +
+                   0.125 * sin(2.0 * M_PI * 1540.0 * t);
+        bank[i] = (int16_t)(x * 30000.0);
+        bank[BENCH_BANK_FRAMES + i] = (int16_t)(x * 28000.0);
+    }
+}
+
+static void setupRegion(Region* r, int stereo) {
+    regionSetRanges(r, 0, 127, 0, 127);
+    regionSetSample(r, 0, BENCH_BANK_FRAMES - 64, 1.0,
+                    stereo ? BENCH_BANK_FRAMES : -1, stereo ? BENCH_BANK_FRAMES - 64 : 0, 1.0,
+                    4800.0, BENCH_BANK_FRAMES - 4800.0, 1, BENCH_SR);
+    regionSetTuning(r, 60, 100, 0, 0);
+    regionSetAmp(r, 60.0, 0.0, 0);
+    regionSetVolEnv(r, -12000, -4000, -12000, 1200, 200, -1200);
+    regionSetModEnv(r, -12000, -3000, -12000, 0, 0.3, -2000);
+    regionSetFilter(r, 9000, 2400, 300);
+    regionSetModLfo(r, -6000, -500, 10);
+    regionSetVibLfo(r, -5000, -200, 15);
+}
+
+static double runCase(const BenchCase* bc, int voices, double seconds, int threads, int* started) {
+    Synth* s = synthCreate(BENCH_SR);
+    synthSetThreadCount(s, threads);
+    synthSetMaxVoices(s, voices);
+    synthSetInterpolation(s, bc->interpolation);
+    synthSetControlInterval(s, bc->controlInterval);
+    synthSetSampleBank(s, bank, BENCH_BANK_FRAMES * 2);
+    synthSetRegionCount(s, 0, 1);
+    setupRegion(synthGetRegion(s, 0, 0), bc->stereo);
+
+    // Spread notes over +-2 octaves so every pitch-ratio band gets exercised
+    *started = 0;
+    for (int i = 0; i < voices; i++) *started += synthNoteOn(s, 0, 36 + (i * 7) % 48, 100);
+
+    static float outL[BENCH_QUANTUM], outR[BENCH_QUANTUM];
+    int quanta = (int)(seconds * BENCH_SR / BENCH_QUANTUM);
+    double sink = 0.0;
+    double t0 = nowSeconds();
+    for (int q = 0; q < quanta; q++) {
+        synthRender(s, outL, outR, BENCH_QUANTUM);
+        sink += outL[q % BENCH_QUANTUM];
+    }
+    double elapsed = nowSeconds() - t0;
+    synthDestroy(s);
+    if (sink == 12345.678) printf("#"); // keep the render from being optimized away
+    return elapsed / ((double)quanta * BENCH_QUANTUM);
+}
+
+int main(int argc, char** argv) {
+    int voices = 64;
+    double seconds = 10.0;
+    int repeat = 3;
+    int threads = 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "--voices")) voices = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "--seconds")) seconds = atof(argv[i + 1]);
+        else if (!strcmp(argv[i], "--repeat")) repeat = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "--threads")) threads = atoi(argv[i + 1]);
+    }
+    if (repeat < 1) repeat = 1;
+    if (voices < 1) voices = 1;
+    if (voices > SYNTH_MAX_VOICES) voices = SYNTH_MAX_VOICES;
+    fillBank();
+
+#ifdef __EMSCRIPTEN__
+    const char* target = "wasm";
+#else
+    const char* target = "native";
+#endif
+    double budgetSec = BENCH_QUANTUM / BENCH_SR;
+    int caseCount = (int)(sizeof(cases) / sizeof(cases[0]));
+
+    printf("{\n  \"target\": \"%s\",\n  \"voices\": %d,\n  \"seconds\": %.1f,\n  \"repeat\": %d,\n  \"threads\": %d,\n  \"cases\": {\n",
+           target, voices, seconds, repeat, threads);
+    for (int c = 0; c < caseCount; c++) {
+        int started = 0;
+        double secPerSample = runCase(&cases[c], voices, seconds, threads, &started);
+        for (int r = 1; r < repeat; r++) {
+            double t = runCase(&cases[c], voices, seconds, threads, &started);
+            if (t < secPerSample) secPerSample = t;
+        }
+        double nsPerVoice = secPerSample * 1e9 / (started > 0 ? started : 1);
+        double quantumCostSec = nsPerVoice * 1e-9 * BENCH_QUANTUM;
+        int maxPolyphony = (int)(budgetSec / quantumCostSec);
+        printf("    \"%s\": { \"nsPerSampleVoice\": %.2f, \"maxPolyphony128\": %d, \"voicesStarted\": %d }%s\n",
+               cases[c].name, nsPerVoice, maxPolyphony, started, c + 1 < caseCount ? "," : "");
+    }
+    printf("  }\n}\n");
+    return 0;
+}
@@ -15,7 +15,7 @@ docker build -t gbk-wasm-builder .
 
 # Run container and copy output files
 echo "Compiling C to WebAssembly..."
-docker run --rm -v "$(pwd)/public:/host-output" gbk-wasm-builder sh -c "cp /output/dsp.js /output/dsp.wasm /host-output/"
+docker run --rm -v "$(pwd)/public:/host-output" gbk-wasm-builder sh -c "cp /output/dsp.js /output/dsp.wasm /output/dsp-scalar.js /output/dsp-scalar.wasm /host-output/"
 
 echo "WebAssembly module built successfully!"
-echo "Output files: public/dsp.js, public/dsp.wasm"
+echo "Output files: public/dsp.js, public/dsp.wasm, public/dsp-scalar.js, public/dsp-scalar.wasm"
@@ -1,5 +1,6 @@
 import { useCallback, useEffect, useMemo, useRef, useState } from "react";
-import { parseSF2 } from "./sf2-parser.js";
+import { createSf2Client } from "./sf2-client.js";
+import { PresetCache } from "./preset-cache.js";
 import { createMidiDriver } from "./midi-driver.js";
 import MidiReader from "./midireader.jsx";
 import { fetchWasmBinary } from "./dsp-wasm-wrapper.js";
@@ -19,10 +20,60 @@ const QWERTY_NOTE_MAP = {
   h: 69, // A4
 };
 
+// Frames between modulation (mod env, LFO, pitch, filter) updates in the
+// engine; lower is more faithful, higher leaves more CPU headroom
+const MODULATION_QUALITY_OPTIONS = [
+  { frames: 1, label: "Mod: High" },
+  { frames: 16, label: "Mod: Balanced" },
+  { frames: 32, label: "Mod: Eco" },
+];
+const DEFAULT_CONTROL_INTERVAL = 16;
+
+// Sample interpolators in the engine (INTERP_* in dsp.c); the sinc settings
+// pick a band-limited table per voice from its pitch ratio
+const INTERPOLATION_OPTIONS = [
+  { quality: 0, label: "Interp: Linear" },
+  { quality: 1, label: "Interp: Hermite" },
+  { quality: 2, label: "Interp: Sinc 8" },
+  { quality: 3, label: "Interp: Sinc 16" },
+];
+const DEFAULT_INTERPOLATION = 2;
+
+// Engine stats arrive once a second from every processor (sf2-processor.js
+// postStats); a source that has gone quiet this long is dropped from the meter
+const DSP_STATS_STALE_MS = 3000;
+
+let nextSampleBankId = 1;
+
+// Wraps the smpl chunk for the worklets. Processors key their heap copy by id,
+// so all track nodes share one upload; on cross-origin isolated pages the
+// parser worker already put the data in a SharedArrayBuffer, so posting it to
+// each node copies nothing.
+function createSampleBank(smpl) {
+  if (!smpl?.length) return null;
+  const id = nextSampleBankId++;
+  const shared = typeof SharedArrayBuffer === "function" && smpl.buffer instanceof SharedArrayBuffer;
+  return { id, smpl, shared };
+}
+
 function getPresetRows(sf2) {
   return sf2?.pdta?.phdr?.slice(0, -1) ?? [];
 }
 
+// Preset cache keys: "bank:program", plus the preset index for the rare
+// duplicate headers so each still gets its own table
+function getPresetCacheKeys(presets) {
+  const seen = new Set();
+  return presets.map((p, index) => {
+    const key = `${p.bank}:${p.preset}`;
+    if (!seen.has(key)) {
+      seen.add(key);
+      return key;
+    }
+    return `${key}:${index}`;
+  });
+}
+
 const GEN_OPER_NAMES = {
   0: "startAddrsOffset",
   1: "endAddrsOffset",
@@ -417,23 +468,59 @@ function extractProgramDetails(sf2, presetIndex) {
     };
   });
 
-  const previewRegion = sf2
-    .buildRegionsForPreset(presetIndex, {
-      decodeToFloat32: true,
-      normalize: false,
-      includeStereoLinks: false,
-    })
-    .find((r) => r.sample?.dataL?.length > 0);
-
   return {
     header,
     presetGlobal,
     regionZones,
     instruments,
-    previewRegion,
   };
 }
 
+// Every processor renders on the one audio thread, so loads and voices add up
+function summarizeDspStats(sources) {
+  let load = null;
+  let loadPeak = null;
+  let voicesAvg = 0;
+  let voicesPeak = 0;
+  let voicesStolen = 0;
+  let voicesCut = 0;
+  let eventsRejected = 0;
+  for (const { stats } of sources.values()) {
+    if (stats.load != null) load = (load ?? 0) + stats.load;
+    if (stats.loadPeak != null) loadPeak = (loadPeak ?? 0) + stats.loadPeak;
+    voicesAvg += stats.voicesAvg;
+    voicesPeak += stats.voicesPeak;
+    voicesStolen += stats.voicesStolen;
+    voicesCut += stats.voicesCut;
+    eventsRejected += stats.eventsRejected;
+  }
+  return { sources: sources.size, load, loadPeak, voicesAvg, voicesPeak, voicesStolen, voicesCut, eventsRejected };
+}
+
+function DspLoadMeter({ summary }) {
+  if (!summary || summary.sources === 0) return null;
+  const percent = (x) => `${Math.round(x * 100)}%`;
+  const timed = summary.load != null;
+  const fill = timed ? Math.min(1, summary.load) : 0;
+  const level = !timed ? "" : summary.loadPeak >= 1 ? "over" : summary.load >= 0.7 ? "high" : "";
+  const title = [
+    timed ? `DSP load ${percent(summary.load)} (worst block ${percent(summary.loadPeak)})` : "DSP load not timed in this browser",
+    `Voices ${summary.voicesAvg.toFixed(1)} avg, ${summary.voicesPeak} peak`,
+    `Stolen ${summary.voicesStolen} (${summary.voicesCut} cut without fade)`,
+    summary.eventsRejected ? `Event queue full ${summary.eventsRejected}x` : null,
+  ].filter(Boolean).join("\n");
+  return (
+    <span className={`dspMeter ${level}`} title={title}>
+      <span className="dspMeterBar">
+        <span className="dspMeterFill" style={{ width: `${fill * 100}%` }} />
+      </span>
+      <span>
+        DSP {timed ? percent(summary.load) : "--"} · {summary.voicesPeak} voices
+      </span>
+    </span>
+  );
+}
+
 function WaveformCanvas({ data }) {
   const canvasRef = useRef(null);
 
@@ -561,6 +648,9 @@ export default function App() {
   const [selectedSf2Path, setSelectedSf2Path] = useState("");
   const [didAutoEnableMidi, setDidAutoEnableMidi] = useState(false);
   const [webMidiSupported, setWebMidiSupported] = useState(true);
+  const [controlInterval, setControlInterval] = useState(DEFAULT_CONTROL_INTERVAL);
+  const [interpolation, setInterpolation] = useState(DEFAULT_INTERPOLATION);
+  const [dspSummary, setDspSummary] = useState(null);
 
   const audioCtxRef = useRef(null);
   const workletNodeRef = useRef(null);
@@ -573,13 +663,21 @@ export default function App() {
   const lastVizUpdateRef = useRef(0);
   const noteOffTimerRef = useRef(null);
   const midiDriverRef = useRef(null);
-  const presetRegionsRef = useRef({ presetIndex: null, regions: [] });
-  const presetRegionCacheRef = useRef(new Map());
+  const sf2ClientRef = useRef(null);
+  const presetCacheRef = useRef(new PresetCache());
   const activeKeyboardKeysRef = useRef(new Map());
   const workletLoadPromiseRef = useRef(null);
   const wasmDataRef = useRef(null);
+  const nodeSampleBankRef = useRef(null);
+  const nodePresetRef = useRef(); // region table last sent to the node
+  const pendingNoteOnsRef = useRef(new Map()); // note -> noteOn still awaiting its preset
+  const controlIntervalRef = useRef(DEFAULT_CONTROL_INTERVAL);
+  const interpolationRef = useRef(DEFAULT_INTERPOLATION);
+  const dspStatsRef = useRef(new Map()); // source -> { stats, at }
 
   const presets = useMemo(() => getPresetRows(sf2), [sf2]);
+  const presetCacheKeys = useMemo(() => getPresetCacheKeys(presets), [presets]);
+  const sampleBank = useMemo(() => createSampleBank(sf2?.sdta?.smpl), [sf2]);
   const visiblePresets = useMemo(() => {
     const query = presetSearch.trim().toLowerCase();
     const rows = presets
@@ -612,6 +710,23 @@ export default function App() {
     return presets.length > 0 ? 0 : null;
   }, [sf2, selectedPreset, presets.length]);
 
+  // First playable region of the selected preset, decoded by the parser worker
+  const [previewRegion, setPreviewRegion] = useState(null);
+  useEffect(() => {
+    setPreviewRegion(null);
+    if (!sf2 || selectedPreset == null) return;
+    let cancelled = false;
+    getSf2Client()
+      .preview(selectedPreset)
+      .then((region) => {
+        if (!cancelled) setPreviewRegion(region);
+      })
+      .catch(() => {});
+    return () => {
+      cancelled = true;
+    };
+  }, [sf2, selectedPreset]);
+
   const selectedSamplePreview = useMemo(() => {
     return getSamplePreviewForLayer(sf2, selectedLayer);
   }, [sf2, selectedLayer]);
@@ -647,9 +762,20 @@ export default function App() {
   }, []);
 
   useEffect(() => {
-    presetRegionsRef.current = { presetIndex: null, regions: [] };
-    presetRegionCacheRef.current = new Map();
-  }, [sf2, effectivePresetIndex]);
+    controlIntervalRef.current = controlInterval;
+    workletNodeRef.current?.port.postMessage({ type: "setControlInterval", frames: controlInterval });
+  }, [controlInterval]);
+
+  useEffect(() => {
+    interpolationRef.current = interpolation;
+    workletNodeRef.current?.port.postMessage({ type: "setInterpolation", quality: interpolation });
+  }, [interpolation]);
+
+  useEffect(() => {
+    presetCacheRef.current.clear();
+  }, [sf2]);
+
+  useEffect(() => () => sf2ClientRef.current?.terminate(), []);
 
   useEffect(() => {
     function isTypingTarget(target) {
@@ -735,11 +861,17 @@ export default function App() {
     startMidiDriver();
   }, [sf2, didAutoEnableMidi, midiEnabled]);
 
+  function getSf2Client() {
+    sf2ClientRef.current ??= createSf2Client();
+    return sf2ClientRef.current;
+  }
+
+  // Parses in the SoundFont worker; u8's buffer is transferred there
   async function parseFromU8(u8, name) {
     setLoading(true);
     setError("");
     try {
-      const parsed = parseSF2(u8);
+      const parsed = await getSf2Client().load(u8);
       setSf2(parsed);
       setSourceName(name);
       setSelectedPreset(null);
@@ -874,10 +1006,24 @@ export default function App() {
         wasmBinary: wasmDataRef.current?.wasmBinary,
         glueCode: wasmDataRef.current?.glueCode,
         basePath: wasmDataRef.current?.basePath,
+        controlInterval: controlIntervalRef.current,
+        interpolation: interpolationRef.current,
       },
     };
   }, []);
 
+  // Latest stats per processor: "preview" for the keyboard node, "partN" for
+  // the MIDI player's parts (relayed by its timer worker)
+  const onDspStats = useCallback((source, stats) => {
+    const sources = dspStatsRef.current;
+    const now = Date.now();
+    sources.set(source, { stats, at: now });
+    for (const [key, rec] of sources) {
+      if (now - rec.at > DSP_STATS_STALE_MS) sources.delete(key);
+    }
+    setDspSummary(summarizeDspStats(sources));
+  }, []);
+
   const ensureAudioGraph = useCallback(async (autoResume = false) => {
     const { ctx, analyser, processorOptions } = await ensureAudioInfrastructure();
     if (autoResume && ctx.state !== "running") {
@@ -894,11 +1040,14 @@ export default function App() {
         outputChannelCount: [2],
         processorOptions,
       });
+      node.port.onmessage = (event) => {
+        if (event.data?.type === "stats") onDspStats("preview", event.data);
+      };
       workletNodeRef.current = node;
       node.connect(analyser);
     }
     return node;
-  }, [ensureAudioInfrastructure]);
+  }, [ensureAudioInfrastructure, onDspStats]);
 
   const resolvePresetIndex = useCallback((program, bank) => {
     const exactIndex = presets.findIndex((p) => p.preset === program && p.bank === bank);
@@ -910,43 +1059,51 @@ export default function App() {
     return null;
   }, [presets]);
 
+  // Resolves to the preset's packed region table, built in the parser worker
+  // and shared through the LRU preset cache by every track playing it.
+  // Regions reference sf2.sdta.smpl by offset; the worklet holds the bank itself.
   const getRegionsForPresetIndex = useCallback((presetIndex) => {
-    if (!sf2 || presetIndex == null || presetIndex < 0) return [];
-    if (presetRegionCacheRef.current.has(presetIndex)) {
-      return presetRegionCacheRef.current.get(presetIndex);
-    }
-    const regions = sf2.buildRegionsForPreset(presetIndex, {
-      decodeToFloat32: true,
-      normalize: true,
-      includeStereoLinks: true,
-    });
-    presetRegionCacheRef.current.set(presetIndex, regions);
-    return regions;
-  }, [sf2]);
-
-  function getCurrentPresetRegions() {
-    if (!sf2 || effectivePresetIndex == null) return [];
-    if (
-      presetRegionsRef.current.presetIndex === effectivePresetIndex &&
-      presetRegionsRef.current.regions.length
-    ) {
-      return presetRegionsRef.current.regions;
-    }
-    const regions = getRegionsForPresetIndex(effectivePresetIndex);
-    presetRegionsRef.current = { presetIndex: effectivePresetIndex, regions };
-    return regions;
-  }
+    const key = presetIndex != null ? presetCacheKeys[presetIndex] : undefined;
+    if (!sf2 || key == null) return Promise.resolve(null);
+    return presetCacheRef.current.get(key, () =>
+      getSf2Client().regions(presetIndex, {
+        normalize: true,
+        includeStereoLinks: true,
+      })
+    );
+  }, [sf2, presetCacheKeys]);
 
-  async function triggerNoteOn(note, velocity) {
-    if (!sf2 || effectivePresetIndex == null) return;
+  // A noteOn may wait on the parser worker for its region table; the note is
+  // kept pending until it is posted so a quick tap's noteOff cannot overtake it
+  function triggerNoteOn(note, velocity) {
+    if (!sf2 || effectivePresetIndex == null) return Promise.resolve();
     if (selectedPreset == null) setSelectedPreset(effectivePresetIndex);
-    const node = await ensureAudioGraph(false);
-    const regions = getCurrentPresetRegions();
-    node.port.postMessage({ type: "setPreset", regions });
-    node.port.postMessage({ type: "noteOn", note, velocity });
+    const pending = pendingNoteOnsRef.current;
+    const sent = (async () => {
+      const node = await ensureAudioGraph(false);
+      if (nodeSampleBankRef.current !== sampleBank) {
+        node.port.postMessage({ type: "setSampleBank", bankId: sampleBank?.id ?? null, smpl: sampleBank?.smpl });
+        nodeSampleBankRef.current = sampleBank;
+        nodePresetRef.current = undefined; // a new bank needs the preset's samples uploaded again
+      }
+      const regions = await getRegionsForPresetIndex(effectivePresetIndex);
+      if (nodePresetRef.current !== regions) {
+        node.port.postMessage({ type: "setPreset", regions });
+        nodePresetRef.current = regions;
+      }
+      node.port.postMessage({ type: "noteOn", note, velocity });
+    })();
+    pending.set(note, sent);
+    const done = () => {
+      if (pending.get(note) === sent) pending.delete(note);
+    };
+    sent.then(done, done);
+    return sent;
   }
 
   async function triggerNoteOff(note) {
+    const pending = pendingNoteOnsRef.current.get(note);
+    if (pending) await pending.catch(() => {});
     const node = workletNodeRef.current;
     if (!node) return;
     node.port.postMessage({ type: "noteOff", note });
@@ -978,7 +1135,7 @@ export default function App() {
   // Plays the PCM sample directly using AudioBufferSourceNode.
   async function playSelectedLayer(layer = selectedLayer) {
     if (!layer) return;
-    const preview = getSamplePreviewForLayer(sf2, layer) || programDetails?.previewRegion;
+    const preview = getSamplePreviewForLayer(sf2, layer) || previewRegion;
     if (!preview || !preview.sample || !preview.sample.dataL) return;
 
     try {
@@ -1144,6 +1301,29 @@ export default function App() {
             <span>{audioCtxState === "running" ? "Power Off" : "Power On"}</span>
           </button>
           <span className="midiStatus">Audio: {audioCtxState}</span>
+          <DspLoadMeter summary={audioCtxState === "running" ? dspSummary : null} />
+          <select
+            value={controlInterval}
+            onChange={(e) => setControlInterval(Number(e.target.value))}
+            title="Modulation quality: how often envelopes, LFOs and filters are updated"
+          >
+            {MODULATION_QUALITY_OPTIONS.map((opt) => (
+              <option key={opt.frames} value={opt.frames}>
+                {opt.label}
+              </option>
+            ))}
+          </select>
+          <select
+            value={interpolation}
+            onChange={(e) => setInterpolation(Number(e.target.value))}
+            title="Sample interpolation: higher settings alias less when notes are pitched up"
+          >
+            {INTERPOLATION_OPTIONS.map((opt) => (
+              <option key={opt.quality} value={opt.quality}>
+                {opt.label}
+              </option>
+            ))}
+          </select>
           {webMidiSupported && (
             <>
               <button
@@ -1207,8 +1387,11 @@ export default function App() {
       {activeTab === "midi" && (
         <MidiReader
           sf2Ready={!!sf2}
+          sampleBank={sampleBank}
+          controlInterval={controlInterval}
+          interpolation={interpolation}
           ensureAudioInfrastructure={ensureAudioInfrastructure}
-          getRegionsForPreset={(presetIndex) => getRegionsForPresetIndex(presetIndex)}
+          getRegionsForPreset={getRegionsForPresetIndex}
           resolvePresetIndex={resolvePresetIndex}
           fallbackPresetIndex={effectivePresetIndex ?? 0}
           presetOptions={presets.map((p, idx) => ({
@@ -1218,6 +1401,7 @@ export default function App() {
             name: p.presetName || "(unnamed)",
           }))}
           onError={(msg) => setAudioError(msg)}
+          onDspStats={onDspStats}
         />
       )}
 
@@ -1271,6 +1455,16 @@ export default function App() {
                 <p>
                   <strong>Samples:</strong> {sf2.pdta.shdr.length - 1}
                 </p>
+                {(() => {
+                  const cache = presetCacheRef.current.stats();
+                  return (
+                    <p>
+                      <strong>Preset cache:</strong> {cache.entries} tables, {(cache.bytes / 1024).toFixed(1)} /{" "}
+                      {(cache.maxBytes / 1024).toFixed(0)} KiB, {cache.hits} hits / {cache.misses} misses /{" "}
+                      {cache.evictions} evictions
+                    </p>
+                  );
+                })()}
                 <h3>INFO</h3>
                 <ul className="infoList">
                   {Object.entries(sf2.info).map(([k, v]) => {
@@ -1609,7 +1803,7 @@ export default function App() {
                   {audioError ? <p className="status error">{audioError}</p> : null}
                   {(() => {
                     // Use selectedSamplePreview if available (for instrumentRegion), otherwise use previewRegion
-                    const preview = selectedSamplePreview || programDetails?.previewRegion;
+                    const preview = selectedSamplePreview || previewRegion;
                     
                     if (selectedPreset == null || !preview) {
                       return <p>Waveform appears when the selected program has playable regions.</p>;
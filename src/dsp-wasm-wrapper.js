@@ -4,6 +4,19 @@
 let dspModule = null;
 let dspReady = false;
 
+// Smallest module using a v128 instruction; validates only where wasm SIMD is supported
+const SIMD_PROBE = new Uint8Array([
+    0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3, 2, 1, 0, 10, 10, 1, 8, 0, 65, 0, 253, 15, 253, 98, 11
+]);
+
+export function isWasmSimdSupported() {
+    try {
+        return typeof WebAssembly === 'object' && WebAssembly.validate(SIMD_PROBE);
+    } catch {
+        return false;
+    }
+}
+
 // Fetch WASM binary and glue code for passing to AudioWorklet
 export async function fetchWasmBinary() {
     try {
@@ -11,8 +24,10 @@ export async function fetchWasmBinary() {
         const normalizedBase = basePath.endsWith('/') ? basePath : `${basePath}/`;
         const assetRoot = new URL(normalizedBase, window.location.origin);
         
-        const wasmUrl = new URL('dsp.wasm', assetRoot).href;
-        const glueUrl = new URL('dsp.js', assetRoot).href;
+        // dsp.wasm is the SIMD build; dsp-scalar.* is the fallback build
+        const moduleName = isWasmSimdSupported() ? 'dsp' : 'dsp-scalar';
+        const wasmUrl = new URL(`${moduleName}.wasm`, assetRoot).href;
+        const glueUrl = new URL(`${moduleName}.js`, assetRoot).href;
         
         console.log(`Fetching WASM binary from: ${wasmUrl}`);
         console.log(`Fetching WASM glue code from: ${glueUrl}`);
@@ -116,6 +131,9 @@ export function getDSPModule() {
     return dspModule;
 }
 
+// Envelope stage names by the engine's stage number (VolEnv/ModEnv.stage in dsp.c)
+const ENV_STAGES = ['idle', 'delay', 'attack', 'hold', 'decay', 'sustain', 'release'];
+
 // Wrapper classes that use WebAssembly when available, fallback to JS
 
 export class VolEnvWasm {
@@ -174,11 +192,13 @@ export class VolEnvWasm {
     }
     
     get level() {
+        if (this.ptr && dspModule) return dspModule._volEnvGetLevel(this.ptr);
         if (this.jsImpl) return this.jsImpl.level;
         return 0;
     }
     
     get stage() {
+        if (this.ptr && dspModule) return ENV_STAGES[dspModule._volEnvGetStage(this.ptr)] ?? 'idle';
         if (this.jsImpl) return this.jsImpl.stage;
         return 'idle';
     }
@@ -247,11 +267,13 @@ export class ModEnvWasm {
     }
     
     get level() {
+        if (this.ptr && dspModule) return dspModule._modEnvGetLevel(this.ptr);
         if (this.jsImpl) return this.jsImpl.level;
         return 0;
     }
     
     get stage() {
+        if (this.ptr && dspModule) return ENV_STAGES[dspModule._modEnvGetStage(this.ptr)] ?? 'idle';
         if (this.jsImpl) return this.jsImpl.stage;
         return 'idle';
     }
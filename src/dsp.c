@@ -1,6 +1,33 @@
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <math.h>
+#ifdef __EMSCRIPTEN__
 #include <emscripten.h>
+#else
+#include <time.h>
+#define EMSCRIPTEN_KEEPALIVE
+#endif
+#ifdef __wasm_simd128__
+#include <wasm_simd128.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#ifdef DSP_THREADS
+#include <pthread.h>
+#include <stdatomic.h>
+#endif
+#include "dsp.h"
+
+// Precision of the per-voice DSP state (envelopes, LFO rates, filter state and
+// coefficients, gains). Double by default, the reference; -DDSP_FLOAT32 builds
+// it in float32. Sample position, pitch rate, LFO phase and anything derived
+// from the sample rate at setup stay double either way.
+#ifdef DSP_FLOAT32
+typedef float dsp_real_t;
+#else
+typedef double dsp_real_t;
+#endif
 
 // Constants
 #define MIN_VOL_RELEASE_SEC 0.06
@@ -56,43 +83,189 @@ double lerp(double a, double b, double t) {
     return a + (b - a) * t;
 }
 
+// ---------- Fast math ----------
+// Table-driven replacements for the libm calls in the per-voice hot path.
+// The functions above stay the exact reference versions (and are what the
+// JS side calls); tests/native/fastmath-accuracy.c checks these against them.
+#define FAST_CENTS_TABLE 1200   // one entry per cent over an octave
+#define FAST_SINE_TABLE 1024    // entries per LFO cycle
+#define LOG2_10 3.321928094887362
+
+static double fastCentsTable[FAST_CENTS_TABLE + 1]; // 2^(i/1200)
+static double fastSineTable[FAST_SINE_TABLE + 1];   // sin(2*pi*i/N), wraps
+static int fastMathReady = 0;
+
+// Fills the tables once; synthCreate and voiceCreate call it, so the tables
+// are ready before any voice renders or a render pool thread starts
+static void fastMathInit(void) {
+    if (fastMathReady) return;
+    for (int i = 0; i <= FAST_CENTS_TABLE; i++) fastCentsTable[i] = pow(2.0, i / 1200.0);
+    for (int i = 0; i <= FAST_SINE_TABLE; i++) fastSineTable[i] = sin(2.0 * M_PI * i / FAST_SINE_TABLE);
+    fastMathReady = 1;
+}
+
+// 2^(c/1200): whole octaves via ldexp, cents via the table with linear
+// interpolation between neighbouring cents (relative error < 1e-7)
+EMSCRIPTEN_KEEPALIVE
+double fastCentsToRatio(double c) {
+    if (!(c > -1.0e5 && c < 1.0e5)) return centsToRatio(c); // out of range or NaN
+    double octaves = floor(c / 1200.0);
+    double cents = c - octaves * 1200.0; // 0..1200
+    int i = (int)cents;
+    if (i >= FAST_CENTS_TABLE) i = FAST_CENTS_TABLE - 1;
+    double f = cents - i;
+    double r = fastCentsTable[i] + (fastCentsTable[i + 1] - fastCentsTable[i]) * f;
+    return ldexp(r, (int)octaves);
+}
+
+EMSCRIPTEN_KEEPALIVE
+double fastFcCentsToHz(double fcCents) {
+    return 8.176 * fastCentsToRatio(fcCents);
+}
+
+// 10^(-cb/200) == 2^(-cb * 6 * log2(10) / 1200)
+EMSCRIPTEN_KEEPALIVE
+double fastCbAttenToLin(double cb) {
+    return fastCentsToRatio(-cb * 6.0 * LOG2_10);
+}
+
+// sin(2*pi*phase) for phase in cycles, [0,1)
+EMSCRIPTEN_KEEPALIVE
+double fastSinCycles(double phase) {
+    double x = (phase - floor(phase)) * FAST_SINE_TABLE;
+    int i = (int)x;
+    if (i >= FAST_SINE_TABLE) i = FAST_SINE_TABLE - 1;
+    double f = x - i;
+    return fastSineTable[i] + (fastSineTable[i + 1] - fastSineTable[i]) * f;
+}
+
+// Envelope stages are counted in samples: a timed stage (delay, attack, hold,
+// decay, release) ends on the first sample at which its time has elapsed, and
+// that last sample lands on the stage's target and enters the next stage.
+// Lengths and per-sample increments are worked out when the envelope is set,
+// so stepping needs no divisions and block rendering only branches at stage
+// boundaries. Zero-length attack, decay and release stages take one sample.
+static int envStageSamples(double seconds, double sr) {
+    double n = ceil(seconds * sr - 1e-9);
+    if (n < 1.0) return 1;
+    return n > (double)INT32_MAX ? INT32_MAX : (int)n;
+}
+
 // Volume Envelope structure and functions
 typedef struct {
     double sr;
     int stage; // 0=idle, 1=delay, 2=attack, 3=hold, 4=decay, 5=sustain, 6=release
     double level;
-    double t;
-    double peak;
-    
-    double delay;
-    double attack;
-    double hold;
-    double decay;
-    double sustain;
-    double release;
-    
-    double releaseStart;
+    dsp_real_t peak;
+    dsp_real_t sustain;
+    double release; // seconds, for the release multiplier at noteOff
+
+    // Stage lengths in samples (0 = no delay / hold stage)
+    int delaySamples;
+    int attackSamples;
+    int holdSamples;
+    int decaySamples;
+    int releaseSamples;
+    int left; // samples remaining in the current timed stage
+
+    // Recursive segment state: attack runs u *= mul toward 0 (level = peak * (1 - u)),
+    // decay/release run level *= mul, so no exp/log per sample. Kept double in
+    // float32 builds too: a rounded multiplier compounds over a segment's length.
+    double attackMul;
+    double decayMul;
+    double mul;
+    double u;
 } VolEnv;
 
-EMSCRIPTEN_KEEPALIVE
-VolEnv* volEnvCreate(double sr) {
-    VolEnv* env = (VolEnv*)malloc(sizeof(VolEnv));
-    if (!env) return NULL;
-    
+// Stage times in seconds -> sample counts and per-sample multipliers
+static void volEnvSetTimes(VolEnv* env, double delay, double attack, double hold,
+                           double decay, double release) {
+    double sr = env->sr;
+    env->delaySamples = delay > 0.0 ? envStageSamples(delay, sr) : 0;
+    env->attackSamples = envStageSamples(attack, sr);
+    env->holdSamples = hold > 0.0 ? envStageSamples(hold, sr) : 0;
+    env->decaySamples = envStageSamples(decay, sr);
+    env->releaseSamples = envStageSamples(release, sr);
+    env->release = release;
+
+    // attack: 1 - exp(-6x), x = t / attack
+    env->attackMul = attack > 0.0 ? exp(-6.0 / (attack * sr)) : 0.0;
+    // decay: exponential from peak to sustain
+    double start = fmax(EPS, env->peak);
+    double end = fmax(EPS, env->sustain);
+    env->decayMul = decay > 0.0 ? pow(end / start, 1.0 / (decay * sr)) : 1.0;
+}
+
+static void volEnvInit(VolEnv* env, double sr) {
     env->sr = sr;
     env->stage = 0; // idle
     env->level = 0.0;
-    env->t = 0.0;
     env->peak = 1.0;
-    
-    env->delay = 0.0;
-    env->attack = 0.01;
-    env->hold = 0.0;
-    env->decay = 0.1;
     env->sustain = 0.5;
-    env->release = 0.2;
+    env->left = 0;
+    env->mul = 1.0;
+    env->u = 1.0;
+    volEnvSetTimes(env, 0.0, 0.01, 0.0, 0.1, 0.2);
+}
+
+// Enters an envelope stage: starts its sample count and multiplier
+static void volEnvEnterStage(VolEnv* env, int stage) {
+    env->stage = stage;
+    switch (stage) {
+        case 1:
+            env->left = env->delaySamples;
+            break;
+        case 2:
+            env->left = env->attackSamples;
+            env->u = 1.0;
+            env->mul = env->attackMul;
+            break;
+        case 3:
+            env->left = env->holdSamples;
+            break;
+        case 4:
+            env->left = env->decaySamples;
+            env->mul = env->decayMul;
+            break;
+        case 6: // release: exponential from the current level to EPS
+            env->left = env->releaseSamples;
+            env->mul = pow(EPS / fmax(EPS, env->level), 1.0 / (env->release * env->sr));
+            break;
+    }
+}
+
+// Last sample of a timed stage: land on the target, enter the next stage
+static void volEnvFinishStage(VolEnv* env) {
+    switch (env->stage) {
+        case 1: // delay
+            env->level = 0.0;
+            volEnvEnterStage(env, 2);
+            break;
+        case 2: // attack
+            volEnvEnterStage(env, (env->holdSamples > 0) ? 3 : 4); // hold or decay
+            env->level = env->peak;
+            break;
+        case 3: // hold
+            volEnvEnterStage(env, 4);
+            env->level = env->peak;
+            break;
+        case 4: // decay
+            volEnvEnterStage(env, 5);
+            env->level = env->sustain;
+            break;
+        case 6: // release
+            env->level = 0.0;
+            env->stage = 0; // idle
+            break;
+    }
+}
+
+EMSCRIPTEN_KEEPALIVE
+VolEnv* volEnvCreate(double sr) {
+    VolEnv* env = (VolEnv*)malloc(sizeof(VolEnv));
+    if (!env) return NULL;
     
-    env->releaseStart = 0.0;
+    volEnvInit(env, sr);
     return env;
 }
 
@@ -104,164 +277,234 @@ void volEnvDestroy(VolEnv* env) {
 EMSCRIPTEN_KEEPALIVE
 void volEnvSetFromSf2(VolEnv* env, double delayTc, double attackTc, double holdTc, 
                       double decayTc, double sustainCb, double releaseTc) {
-    env->delay = fmax(0.0, timecentsToSeconds(delayTc));
-    env->attack = fmax(0.0, timecentsToSeconds(attackTc));
-    env->hold = fmax(0.0, timecentsToSeconds(holdTc));
-    env->decay = fmax(0.0, timecentsToSeconds(decayTc));
-    double rel = timecentsToSeconds(releaseTc);
-    env->release = fmax(MIN_VOL_RELEASE_SEC, rel);
-    
     double sustainDb = -sustainCb / 10.0;
     env->sustain = fmin(1.0, fmax(0.0, pow(10.0, sustainDb / 20.0)));
+    volEnvSetTimes(env,
+                   fmax(0.0, timecentsToSeconds(delayTc)),
+                   fmax(0.0, timecentsToSeconds(attackTc)),
+                   fmax(0.0, timecentsToSeconds(holdTc)),
+                   fmax(0.0, timecentsToSeconds(decayTc)),
+                   fmax(MIN_VOL_RELEASE_SEC, timecentsToSeconds(releaseTc)));
 }
 
 EMSCRIPTEN_KEEPALIVE
 void volEnvNoteOn(VolEnv* env) {
-    env->stage = (env->delay > 0) ? 1 : 2; // delay or attack
-    env->t = 0.0;
+    volEnvEnterStage(env, (env->delaySamples > 0) ? 1 : 2); // delay or attack
     env->level = 0.0;
 }
 
 EMSCRIPTEN_KEEPALIVE
 void volEnvNoteOff(VolEnv* env) {
     if (env->stage == 0) return; // idle
-    env->stage = 6; // release
-    env->t = 0.0;
-    env->releaseStart = env->level;
+    volEnvEnterStage(env, 6); // release
+}
+
+// Stage (0 idle, 1 delay, 2 attack, 3 hold, 4 decay, 5 sustain, 6 release)
+// and current output level, for the JS wrappers and voice stealing
+EMSCRIPTEN_KEEPALIVE
+int volEnvGetStage(const VolEnv* env) {
+    return env->stage;
+}
+
+EMSCRIPTEN_KEEPALIVE
+double volEnvGetLevel(const VolEnv* env) {
+    return env->level;
 }
 
 EMSCRIPTEN_KEEPALIVE
 double volEnvNext(VolEnv* env) {
-    double dt = 1.0 / env->sr;
-    
     switch (env->stage) {
         case 0: // idle
             env->level = 0.0;
             return 0.0;
-            
-        case 1: // delay
-            env->t += dt;
-            if (env->t >= env->delay) {
-                env->stage = 2; // attack
-                env->t = 0.0;
-            }
-            env->level = 0.0;
-            return 0.0;
-            
-        case 2: { // attack
-            if (env->attack <= 0.0) {
-                env->level = env->peak;
-                env->stage = (env->hold > 0) ? 3 : 4; // hold or decay
-                env->t = 0.0;
-                return env->level;
-            }
-            env->t += dt;
-            double x = fmin(1.0, env->t / env->attack);
-            double shaped = 1.0 - exp(-x * 6.0);
-            env->level = env->peak * shaped;
-            
-            if (x >= 1.0) {
-                env->level = env->peak;
-                env->stage = (env->hold > 0) ? 3 : 4; // hold or decay
-                env->t = 0.0;
-            }
-            return env->level;
-        }
-        
-        case 3: // hold
-            env->t += dt;
-            env->level = env->peak;
-            if (env->t >= env->hold) {
-                env->stage = 4; // decay
-                env->t = 0.0;
-            }
-            return env->level;
-            
-        case 4: { // decay
-            if (env->decay <= 0.0) {
-                env->level = env->sustain;
-                env->stage = 5; // sustain
-                env->t = 0.0;
-                return env->level;
-            }
-            env->t += dt;
-            double x = fmin(1.0, env->t / env->decay);
-            
-            double start = fmax(EPS, env->peak);
-            double end = fmax(EPS, env->sustain);
-            double y = exp(log(start) + (log(end) - log(start)) * x);
-            env->level = y;
-            
-            if (x >= 1.0) {
-                env->level = env->sustain;
-                env->stage = 5; // sustain
-                env->t = 0.0;
-            }
-            return env->level;
-        }
-        
         case 5: // sustain
             env->level = env->sustain;
             return env->level;
-            
-        case 6: { // release
-            if (env->release <= 0.0) {
+    }
+    if (--env->left > 0) {
+        switch (env->stage) {
+            case 1: // delay
                 env->level = 0.0;
-                env->stage = 0; // idle
-                return 0.0;
+                break;
+            case 2: // attack
+                env->u *= env->mul;
+                env->level = env->peak * (1.0 - env->u);
+                break;
+            case 3: // hold
+                env->level = env->peak;
+                break;
+            default: // decay, release
+                env->level *= env->mul;
+                break;
+        }
+        return env->level;
+    }
+    volEnvFinishStage(env);
+    return env->level;
+}
+
+// Writes the next n envelope values to out (same values as n volEnvNext
+// calls). Each stage runs as one loop up to its last sample or the end of
+// the block; only that last sample goes through volEnvNext.
+EMSCRIPTEN_KEEPALIVE
+void volEnvRenderBlock(VolEnv* env, float* out, int n) {
+    int i = 0;
+    while (i < n) {
+        if (env->stage == 0 || env->stage == 5) { // idle, sustain: constant
+            float x = (float)volEnvNext(env);
+            for (; i < n; i++) out[i] = x;
+            return;
+        }
+        int run = env->left - 1;
+        if (run > n - i) run = n - i;
+        float* o = out + i;
+        double level = env->level;
+        double mul = env->mul;
+        switch (env->stage) {
+            case 2: { // attack
+                double u = env->u;
+                double peak = env->peak;
+                for (int k = 0; k < run; k++) {
+                    u *= mul;
+                    o[k] = (float)(peak * (1.0 - u));
+                }
+                env->u = u;
+                level = peak * (1.0 - u);
+                break;
             }
-            env->t += dt;
-            double x = fmin(1.0, env->t / env->release);
-            double start = fmax(EPS, env->releaseStart);
-            double end = EPS;
-            double y = exp(log(start) + (log(end) - log(start)) * x);
-            env->level = y;
-            
-            if (x >= 1.0) {
-                env->level = 0.0;
-                env->stage = 0; // idle
+            case 4: // decay
+            case 6: // release
+                for (int k = 0; k < run; k++) {
+                    level *= mul;
+                    o[k] = (float)level;
+                }
+                break;
+            default: { // delay, hold
+                level = env->stage == 3 ? env->peak : 0.0;
+                float x = (float)level;
+                for (int k = 0; k < run; k++) o[k] = x;
+                break;
             }
-            return env->level;
         }
+        env->level = level;
+        env->left -= run;
+        i += run;
+        if (i < n) out[i++] = (float)volEnvNext(env); // the stage's last sample
     }
-    return 0.0;
 }
 
-// Mod Envelope
+// Mod Envelope: linear segments on the same sample-counted stages, stepped
+// by whole sample counts (one sample, or one control period)
 typedef struct {
     double sr;
     int stage;
-    double level;
-    double t;
-    
-    double delay;
-    double attack;
-    double hold;
-    double decay;
-    double sustain;
-    double release;
-    
-    double releaseStart;
+    dsp_real_t level;
+    dsp_real_t sustain;
+    double release; // seconds, for the release slope at noteOff
+
+    // Stage lengths in samples (0 = no delay / hold stage)
+    int delaySamples;
+    int attackSamples;
+    int holdSamples;
+    int decaySamples;
+    int releaseSamples;
+    int left; // samples remaining in the current timed stage
+    int len;  // samples the current stage started with
+
+    // The current stage runs level = base + step * elapsed samples (no running
+    // sum, so float32 builds do not drift over long stages)
+    dsp_real_t base;
+    dsp_real_t step;
+    dsp_real_t attackStep;
+    dsp_real_t decayStep;
 } ModEnv;
 
-EMSCRIPTEN_KEEPALIVE
-ModEnv* modEnvCreate(double sr) {
-    ModEnv* env = (ModEnv*)malloc(sizeof(ModEnv));
-    if (!env) return NULL;
-    
+// Stage times in seconds -> sample counts and per-sample slopes
+static void modEnvSetTimes(ModEnv* env, double delay, double attack, double hold,
+                           double decay, double release) {
+    double sr = env->sr;
+    env->delaySamples = delay > 0.0 ? envStageSamples(delay, sr) : 0;
+    env->attackSamples = envStageSamples(attack, sr);
+    env->holdSamples = hold > 0.0 ? envStageSamples(hold, sr) : 0;
+    env->decaySamples = envStageSamples(decay, sr);
+    env->releaseSamples = envStageSamples(release, sr);
+    env->release = release;
+    env->attackStep = attack > 0.0 ? 1.0 / (attack * sr) : 0.0;
+    env->decayStep = decay > 0.0 ? (env->sustain - 1.0) / (decay * sr) : 0.0;
+}
+
+static void modEnvInit(ModEnv* env, double sr) {
     env->sr = sr;
     env->stage = 0; // idle
     env->level = 0.0;
-    env->t = 0.0;
-    
-    env->delay = 0.0;
-    env->attack = 0.01;
-    env->hold = 0.0;
-    env->decay = 0.1;
     env->sustain = 0.0;
-    env->release = 0.2;
+    env->left = 0;
+    env->len = 0;
+    env->base = 0.0;
+    env->step = 0.0;
+    modEnvSetTimes(env, 0.0, 0.01, 0.0, 0.1, 0.2);
+}
+
+static void modEnvEnterStage(ModEnv* env, int stage) {
+    env->stage = stage;
+    env->base = env->level;
+    switch (stage) {
+        case 1:
+            env->left = env->delaySamples;
+            env->step = 0.0;
+            break;
+        case 2:
+            env->left = env->attackSamples;
+            env->step = env->attackStep;
+            break;
+        case 3:
+            env->left = env->holdSamples;
+            env->step = 0.0;
+            break;
+        case 4:
+            env->left = env->decaySamples;
+            env->step = env->decayStep;
+            break;
+        case 6: // release: linear from the current level to 0
+            env->left = env->releaseSamples;
+            env->step = -env->level / (env->release * env->sr);
+            break;
+    }
+    env->len = env->left;
+}
+
+// Last sample of a timed stage: land on the target, enter the next stage
+static void modEnvFinishStage(ModEnv* env) {
+    switch (env->stage) {
+        case 1: // delay
+            env->level = 0.0;
+            modEnvEnterStage(env, 2);
+            break;
+        case 2: // attack
+            env->level = 1.0;
+            modEnvEnterStage(env, (env->holdSamples > 0) ? 3 : 4);
+            break;
+        case 3: // hold
+            env->level = 1.0;
+            modEnvEnterStage(env, 4);
+            break;
+        case 4: // decay
+            env->level = env->sustain;
+            modEnvEnterStage(env, 5);
+            break;
+        case 6: // release
+            env->level = 0.0;
+            env->stage = 0;
+            break;
+    }
+}
+
+EMSCRIPTEN_KEEPALIVE
+ModEnv* modEnvCreate(double sr) {
+    ModEnv* env = (ModEnv*)malloc(sizeof(ModEnv));
+    if (!env) return NULL;
     
-    env->releaseStart = 0.0;
+    modEnvInit(env, sr);
     return env;
 }
 
@@ -273,133 +516,108 @@ void modEnvDestroy(ModEnv* env) {
 EMSCRIPTEN_KEEPALIVE
 void modEnvSetFromSf2(ModEnv* env, double delayTc, double attackTc, double holdTc,
                       double decayTc, double sustain, double releaseTc) {
-    env->delay = fmax(0.0, timecentsToSeconds(delayTc));
-    env->attack = fmax(0.0, timecentsToSeconds(attackTc));
-    env->hold = fmax(0.0, timecentsToSeconds(holdTc));
-    env->decay = fmax(0.0, timecentsToSeconds(decayTc));
-    double rel = timecentsToSeconds(releaseTc);
-    env->release = fmax(MIN_MOD_RELEASE_SEC, rel);
     env->sustain = fmin(1.0, fmax(0.0, sustain));
+    modEnvSetTimes(env,
+                   fmax(0.0, timecentsToSeconds(delayTc)),
+                   fmax(0.0, timecentsToSeconds(attackTc)),
+                   fmax(0.0, timecentsToSeconds(holdTc)),
+                   fmax(0.0, timecentsToSeconds(decayTc)),
+                   fmax(MIN_MOD_RELEASE_SEC, timecentsToSeconds(releaseTc)));
 }
 
 EMSCRIPTEN_KEEPALIVE
 void modEnvNoteOn(ModEnv* env) {
-    env->stage = (env->delay > 0) ? 1 : 2;
-    env->t = 0.0;
     env->level = 0.0;
+    modEnvEnterStage(env, (env->delaySamples > 0) ? 1 : 2);
 }
 
 EMSCRIPTEN_KEEPALIVE
 void modEnvNoteOff(ModEnv* env) {
     if (env->stage == 0) return;
-    env->stage = 6;
-    env->t = 0.0;
-    env->releaseStart = env->level;
+    modEnvEnterStage(env, 6);
 }
 
-EMSCRIPTEN_KEEPALIVE
-double modEnvNext(ModEnv* env) {
-    double dt = 1.0 / env->sr;
-    
+// Advances the envelope by `samples` (one sample, or one control period);
+// time left over past a stage's end is dropped
+static double modEnvStep(ModEnv* env, int samples) {
     switch (env->stage) {
         case 0: // idle
             env->level = 0.0;
             return 0.0;
-            
-        case 1: // delay
-            env->t += dt;
-            if (env->t >= env->delay) {
-                env->stage = 2;
-                env->t = 0.0;
-            }
-            env->level = 0.0;
-            return 0.0;
-            
-        case 2: { // attack
-            if (env->attack <= 0.0) {
-                env->level = 1.0;
-                env->stage = (env->hold > 0) ? 3 : 4;
-                env->t = 0.0;
-                return env->level;
-            }
-            env->t += dt;
-            double x = fmin(1.0, env->t / env->attack);
-            env->level = x;
-            if (x >= 1.0) {
-                env->level = 1.0;
-                env->stage = (env->hold > 0) ? 3 : 4;
-                env->t = 0.0;
-            }
-            return env->level;
-        }
-        
-        case 3: // hold
-            env->t += dt;
-            env->level = 1.0;
-            if (env->t >= env->hold) {
-                env->stage = 4;
-                env->t = 0.0;
-            }
-            return env->level;
-            
-        case 4: { // decay
-            if (env->decay <= 0.0) {
-                env->level = env->sustain;
-                env->stage = 5;
-                env->t = 0.0;
-                return env->level;
-            }
-            env->t += dt;
-            double x = fmin(1.0, env->t / env->decay);
-            env->level = lerp(1.0, env->sustain, x);
-            if (x >= 1.0) {
-                env->level = env->sustain;
-                env->stage = 5;
-                env->t = 0.0;
-            }
-            return env->level;
-        }
-        
         case 5: // sustain
             env->level = env->sustain;
             return env->level;
-            
-        case 6: { // release
-            if (env->release <= 0.0) {
-                env->level = 0.0;
-                env->stage = 0;
-                return 0.0;
-            }
-            env->t += dt;
-            double x = fmin(1.0, env->t / env->release);
-            env->level = lerp(env->releaseStart, 0.0, x);
-            if (x >= 1.0) {
-                env->level = 0.0;
-                env->stage = 0;
-            }
-            return env->level;
+    }
+    if (samples < env->left) {
+        env->left -= samples;
+        env->level = env->base + env->step * (dsp_real_t)(env->len - env->left);
+        return env->level;
+    }
+    modEnvFinishStage(env);
+    return env->level;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int modEnvGetStage(const ModEnv* env) {
+    return env->stage;
+}
+
+EMSCRIPTEN_KEEPALIVE
+double modEnvGetLevel(const ModEnv* env) {
+    return env->level;
+}
+
+EMSCRIPTEN_KEEPALIVE
+double modEnvNext(ModEnv* env) {
+    return modEnvStep(env, 1);
+}
+
+// Writes the next n per-sample envelope values to out (same values as n
+// modEnvNext calls), one loop per stage
+EMSCRIPTEN_KEEPALIVE
+void modEnvRenderBlock(ModEnv* env, float* out, int n) {
+    int i = 0;
+    while (i < n) {
+        if (env->stage == 0 || env->stage == 5) { // idle, sustain: constant
+            float x = (float)modEnvStep(env, 1);
+            for (; i < n; i++) out[i] = x;
+            return;
         }
+        int run = env->left - 1;
+        if (run > n - i) run = n - i;
+        float* o = out + i;
+        dsp_real_t base = env->base;
+        dsp_real_t step = env->step;
+        int elapsed = env->len - env->left;
+        for (int k = 1; k <= run; k++) o[k - 1] = (float)(base + step * (dsp_real_t)(elapsed + k));
+        env->left -= run;
+        if (run > 0) env->level = base + step * (dsp_real_t)(env->len - env->left);
+        i += run;
+        if (i < n) out[i++] = (float)modEnvStep(env, 1); // the stage's last sample
     }
-    return 0.0;
 }
 
 // LFO
 typedef struct {
     double sr;
-    double phase;
-    double freqHz;
-    double delayLeft;
+    double phase; // cycles, 0..1
+    dsp_real_t freqHz;
+    double delayLeft; // seconds, counted down like the phase
 } LFO;
 
+static void lfoInit(LFO* lfo, double sr) {
+    lfo->sr = sr;
+    lfo->phase = 0.0;
+    lfo->freqHz = 5.0;
+    lfo->delayLeft = 0.0;
+}
+
 EMSCRIPTEN_KEEPALIVE
 LFO* lfoCreate(double sr) {
     LFO* lfo = (LFO*)malloc(sizeof(LFO));
     if (!lfo) return NULL;
     
-    lfo->sr = sr;
-    lfo->phase = 0.0;
-    lfo->freqHz = 5.0;
-    lfo->delayLeft = 0.0;
+    lfoInit(lfo, sr);
     return lfo;
 }
 
@@ -414,28 +632,60 @@ void lfoSet(LFO* lfo, double freqHz, double delaySec) {
     lfo->delayLeft = fmax(0.0, delaySec);
 }
 
-EMSCRIPTEN_KEEPALIVE
-double lfoNext(LFO* lfo) {
+// Advances the LFO by dt seconds (one sample, or one control period)
+static double lfoStep(LFO* lfo, double dt) {
     if (lfo->delayLeft > 0.0) {
-        lfo->delayLeft -= 1.0 / lfo->sr;
+        lfo->delayLeft -= dt;
         return 0.0;
     }
-    lfo->phase += 2.0 * M_PI * lfo->freqHz / lfo->sr;
-    if (lfo->phase > 2.0 * M_PI) {
-        lfo->phase -= 2.0 * M_PI;
+    // Phase accumulator in cycles; the sine comes from the fast-math table
+    lfo->phase += lfo->freqHz * dt;
+    if (lfo->phase >= 1.0) {
+        lfo->phase -= floor(lfo->phase);
     }
-    return sin(lfo->phase);
+    return fastSinCycles(lfo->phase);
+}
+
+EMSCRIPTEN_KEEPALIVE
+double lfoNext(LFO* lfo) {
+    return lfoStep(lfo, 1.0 / lfo->sr);
+}
+
+// Biquad coefficients (normalized by a0)
+typedef struct {
+    double b0;
+    double b1;
+    double b2;
+    double a1;
+    double a2;
+} LpfCoefs;
+
+static void lpfCoefsForCutoff(double sr, double hz, LpfCoefs* c) {
+    double clamped = fmax(5.0, fmin(hz, sr * 0.45));
+    double Q = 0.7071; // Butterworth response
+    
+    double w0 = 2.0 * M_PI * clamped / sr;
+    double cosw0 = cos(w0);
+    double sinw0 = sin(w0);
+    double alpha = sinw0 / (2.0 * Q);
+    
+    double a0 = 1.0 + alpha;
+    c->b0 = ((1.0 - cosw0) / 2.0) / a0;
+    c->b1 = (1.0 - cosw0) / a0;
+    c->b2 = ((1.0 - cosw0) / 2.0) / a0;
+    c->a1 = (-2.0 * cosw0) / a0;
+    c->a2 = (1.0 - alpha) / a0;
 }
 
 // Two-Pole Low-Pass Filter (Biquad)
 typedef struct {
     double sr;
     // State variables for left channel
-    double z1L;
-    double z2L;
+    dsp_real_t z1L;
+    dsp_real_t z2L;
     // State variables for right channel
-    double z1R;
-    double z2R;
+    dsp_real_t z1R;
+    dsp_real_t z2R;
     // Biquad coefficients
     double b0;
     double b1;
@@ -444,11 +694,7 @@ typedef struct {
     double a2;
 } TwoPoleLPF;
 
-EMSCRIPTEN_KEEPALIVE
-TwoPoleLPF* lpfCreate(double sr) {
-    TwoPoleLPF* lpf = (TwoPoleLPF*)malloc(sizeof(TwoPoleLPF));
-    if (!lpf) return NULL;
-    
+static void lpfInit(TwoPoleLPF* lpf, double sr) {
     lpf->sr = sr;
     lpf->z1L = 0.0;
     lpf->z2L = 0.0;
@@ -459,6 +705,14 @@ TwoPoleLPF* lpfCreate(double sr) {
     lpf->b2 = 0.0;
     lpf->a1 = 0.0;
     lpf->a2 = 0.0;
+}
+
+EMSCRIPTEN_KEEPALIVE
+TwoPoleLPF* lpfCreate(double sr) {
+    TwoPoleLPF* lpf = (TwoPoleLPF*)malloc(sizeof(TwoPoleLPF));
+    if (!lpf) return NULL;
+    
+    lpfInit(lpf, sr);
     return lpf;
 }
 
@@ -469,20 +723,13 @@ void lpfDestroy(TwoPoleLPF* lpf) {
 
 EMSCRIPTEN_KEEPALIVE
 void lpfSetCutoffHz(TwoPoleLPF* lpf, double hz) {
-    double clamped = fmax(5.0, fmin(hz, lpf->sr * 0.45));
-    double Q = 0.7071; // Butterworth response
-    
-    double w0 = 2.0 * M_PI * clamped / lpf->sr;
-    double cosw0 = cos(w0);
-    double sinw0 = sin(w0);
-    double alpha = sinw0 / (2.0 * Q);
-    
-    double a0 = 1.0 + alpha;
-    lpf->b0 = ((1.0 - cosw0) / 2.0) / a0;
-    lpf->b1 = (1.0 - cosw0) / a0;
-    lpf->b2 = ((1.0 - cosw0) / 2.0) / a0;
-    lpf->a1 = (-2.0 * cosw0) / a0;
-    lpf->a2 = (1.0 - alpha) / a0;
+    LpfCoefs c;
+    lpfCoefsForCutoff(lpf->sr, hz, &c);
+    lpf->b0 = c.b0;
+    lpf->b1 = c.b1;
+    lpf->b2 = c.b2;
+    lpf->a1 = c.a1;
+    lpf->a2 = c.a2;
 }
 
 EMSCRIPTEN_KEEPALIVE
@@ -511,3 +758,2218 @@ double readSampleMono(const float* data, int dataLen, double pos) {
     double b = (i + 1 >= 0 && i + 1 < dataLen) ? data[i + 1] : 0.0;
     return a + (b - a) * f;
 }
+
+// Same as readSampleMono but reads raw 16-bit PCM and converts on the fly
+EMSCRIPTEN_KEEPALIVE
+double readSampleMonoI16(const int16_t* data, int dataLen, double pos) {
+    int i = (int)pos;
+    if (i < 0 || i >= dataLen - 1) return 0.0;
+    double f = pos - i;
+    double a = data[i];
+    double b = data[i + 1];
+    return (a + (b - a) * f) * (1.0 / 32768.0);
+}
+
+
+// ---------- Block kernels ----------
+// Voices are rendered in chunks: a scalar pass steps the modulators and stages
+// per-frame read positions and gains, then these kernels do the per-sample
+// arithmetic. With -msimd128 they use wasm SIMD; otherwise the scalar loops
+// below are compiled (the fallback build for browsers without SIMD).
+#define VOICE_CHUNK 64
+
+// ---------- Interpolators ----------
+// Linear (reference, cheapest), 4-point Hermite, and 8/16-tap polyphase
+// windowed sinc with Q15 tables. Sinc tables are band-limited per pitch-ratio
+// band so pitching up does not alias; a voice picks one at noteOn. The
+// INTERP_* qualities are in dsp.h.
+#define SINC_PHASES 512
+#define SINC_BANDS 6
+
+// Upper pitch ratio of each band; the last band takes everything above 4x
+static const double sincBandMaxRatio[SINC_BANDS] = { 1.0, 1.41421356, 2.0, 2.82842712, 4.0, 1.0e30 };
+// Cutoff as a fraction of the source Nyquist: 0.9 / band ratio (last band at 0.9 / 5.6)
+static const double sincBandCutoff[SINC_BANDS] = { 0.9, 0.63639610, 0.45, 0.31819805, 0.225, 0.16 };
+
+static int16_t sincTable8[SINC_BANDS][SINC_PHASES * 8];
+static int16_t sincTable16[SINC_BANDS][SINC_PHASES * 16];
+static int sincTablesReady = 0;
+
+static int sincBandForRatio(double ratio) {
+    int b = 0;
+    while (b < SINC_BANDS - 1 && ratio > sincBandMaxRatio[b]) b++;
+    return b;
+}
+
+// Blackman-windowed sinc, SINC_PHASES x taps Q15 coefficients; each phase is
+// normalized to unity DC gain. Tap k multiplies data[j - taps/2 + 1 + k].
+static void sincTableBuild(int16_t* table, int taps, int band) {
+    double fc = sincBandCutoff[band];
+    double half = taps / 2.0;
+    for (int p = 0; p < SINC_PHASES; p++) {
+        double frac = (double)p / SINC_PHASES;
+        double h[16];
+        double sum = 0.0;
+        for (int k = 0; k < taps; k++) {
+            double x = (k - (taps / 2 - 1)) - frac;
+            double sinc = fabs(x) < 1e-9 ? 1.0 : sin(M_PI * fc * x) / (M_PI * fc * x);
+            double w = fabs(x) >= half ? 0.0 : 0.42 + 0.5 * cos(M_PI * x / half) + 0.08 * cos(2.0 * M_PI * x / half);
+            h[k] = fc * sinc * w;
+            sum += h[k];
+        }
+        int isum = 0;
+        int peak = 0;
+        for (int k = 0; k < taps; k++) {
+            int q = (int)lround(h[k] / sum * 32768.0);
+            q = q > 32767 ? 32767 : (q < -32768 ? -32768 : q);
+            table[p * taps + k] = (int16_t)q;
+            isum += q;
+            if (abs(q) > abs(table[p * taps + peak])) peak = k;
+        }
+        // Put the rounding residue on the largest tap so each phase sums to 1.0
+        int fixed = table[p * taps + peak] + (32768 - isum);
+        table[p * taps + peak] = (int16_t)(fixed > 32767 ? 32767 : fixed);
+    }
+}
+
+// Builds every taps x band table once; synthCreate and voiceCreate call it,
+// so a noteOn only looks one up
+static void sincTablesInit(void) {
+    if (sincTablesReady) return;
+    for (int b = 0; b < SINC_BANDS; b++) {
+        sincTableBuild(sincTable8[b], 8, b);
+        sincTableBuild(sincTable16[b], 16, b);
+    }
+    sincTablesReady = 1;
+}
+
+static const int16_t* sincTableGet(int taps, int band) {
+    return taps == 16 ? sincTable16[band] : sincTable8[band];
+}
+
+static int16_t sampleAt(const int16_t* data, int dataLen, int j) {
+    return (j >= 0 && j < dataLen) ? data[j] : 0;
+}
+
+// The kernels read through one pointer per frame, src[i] -> the frame's sample
+// j, and may touch src[i][-VOICE_WINDOW_BEFORE .. VOICE_WINDOW_AFTER - 1]
+// (Hermite's j-1..j+2, 16-tap sinc's j-7..j+9 when its phase rounds up).
+// voiceWindows points each frame into the sample, the loop seam or a padded
+// copy, so the kernels themselves never bounds-check.
+#define VOICE_WINDOW_BEFORE 8
+#define VOICE_WINDOW_AFTER 10
+#define VOICE_WINDOW (VOICE_WINDOW_BEFORE + VOICE_WINDOW_AFTER)
+
+// Window for frames past the end of the sample: they render silence
+static const int16_t zeroWindow[VOICE_WINDOW];
+
+// out[i] = lerp(src[i][0], src[i][1], frac[i]) * gain / 32768
+static void interpLinearBlock(const int16_t* const* src, const float* frac,
+                              float gain, float* out, int n) {
+    const float scale = gain * (1.0f / 32768.0f);
+    int i = 0;
+#ifdef __wasm_simd128__
+    const v128_t vscale = wasm_f32x4_splat(scale);
+    for (; i + 4 <= n; i += 4) {
+        float a[4], b[4];
+        for (int k = 0; k < 4; k++) {
+            a[k] = src[i + k][0];
+            b[k] = src[i + k][1];
+        }
+        v128_t va = wasm_v128_load(a);
+        v128_t vb = wasm_v128_load(b);
+        v128_t vf = wasm_v128_load(frac + i);
+        v128_t y = wasm_f32x4_add(va, wasm_f32x4_mul(wasm_f32x4_sub(vb, va), vf));
+        wasm_v128_store(out + i, wasm_f32x4_mul(y, vscale));
+    }
+#endif
+    for (; i < n; i++) {
+        float a = src[i][0];
+        float b = src[i][1];
+        out[i] = (a + (b - a) * frac[i]) * scale;
+    }
+}
+
+// 4-point, 3rd-order Hermite between src[i][0] and src[i][1]
+static void interpHermiteBlock(const int16_t* const* src, const float* frac,
+                               float gain, float* out, int n) {
+    const float scale = gain * (1.0f / 32768.0f);
+    int i = 0;
+#ifdef __wasm_simd128__
+    const v128_t vscale = wasm_f32x4_splat(scale);
+    const v128_t half = wasm_f32x4_splat(0.5f);
+    const v128_t oneHalf = wasm_f32x4_splat(1.5f);
+    const v128_t two = wasm_f32x4_splat(2.0f);
+    const v128_t twoHalf = wasm_f32x4_splat(2.5f);
+    for (; i + 4 <= n; i += 4) {
+        float ym1[4], y0[4], y1[4], y2[4];
+        for (int k = 0; k < 4; k++) {
+            const int16_t* x = src[i + k];
+            ym1[k] = x[-1];
+            y0[k] = x[0];
+            y1[k] = x[1];
+            y2[k] = x[2];
+        }
+        v128_t vm1 = wasm_v128_load(ym1);
+        v128_t v0 = wasm_v128_load(y0);
+        v128_t v1 = wasm_v128_load(y1);
+        v128_t v2 = wasm_v128_load(y2);
+        v128_t f = wasm_v128_load(frac + i);
+        v128_t c1 = wasm_f32x4_mul(half, wasm_f32x4_sub(v1, vm1));
+        v128_t c2 = wasm_f32x4_sub(wasm_f32x4_add(vm1, wasm_f32x4_mul(two, v1)),
+                                   wasm_f32x4_add(wasm_f32x4_mul(twoHalf, v0), wasm_f32x4_mul(half, v2)));
+        v128_t c3 = wasm_f32x4_add(wasm_f32x4_mul(half, wasm_f32x4_sub(v2, vm1)),
+                                   wasm_f32x4_mul(oneHalf, wasm_f32x4_sub(v0, v1)));
+        v128_t y = wasm_f32x4_add(wasm_f32x4_mul(wasm_f32x4_add(wasm_f32x4_mul(
+                       wasm_f32x4_add(wasm_f32x4_mul(c3, f), c2), f), c1), f), v0);
+        wasm_v128_store(out + i, wasm_f32x4_mul(y, vscale));
+    }
+#endif
+    for (; i < n; i++) {
+        const int16_t* x = src[i];
+        float ym1 = x[-1];
+        float y0 = x[0];
+        float y1 = x[1];
+        float y2 = x[2];
+        float f = frac[i];
+        float c1 = 0.5f * (y1 - ym1);
+        float c2 = ym1 - 2.5f * y0 + 2.0f * y1 - 0.5f * y2;
+        float c3 = 0.5f * (y2 - ym1) + 1.5f * (y0 - y1);
+        out[i] = (((c3 * f + c2) * f + c1) * f + y0) * scale;
+    }
+}
+
+// Polyphase sinc: Q15 taps for the nearest of SINC_PHASES fractional phases
+static void interpSincBlock(const int16_t* const* src, const float* frac, float gain,
+                            const int16_t* table, int taps, float* out, int n) {
+    const float scale = gain * (1.0f / (32768.0f * 32768.0f));
+    const int before = taps / 2 - 1;
+    for (int i = 0; i < n; i++) {
+        const int16_t* x = src[i] - before;
+        int p = (int)(frac[i] * SINC_PHASES + 0.5f);
+        if (p >= SINC_PHASES) {
+            // Rounds up to the next sample at phase 0
+            p = 0;
+            x++;
+        }
+        const int16_t* c = table + p * taps;
+#ifdef __wasm_simd128__
+        // i16x8 dot products give exact pairwise sums; widen before adding
+        v128_t acc = wasm_f32x4_convert_i32x4(wasm_i32x4_dot_i16x8(wasm_v128_load(x), wasm_v128_load(c)));
+        if (taps == 16) {
+            acc = wasm_f32x4_add(acc, wasm_f32x4_convert_i32x4(
+                wasm_i32x4_dot_i16x8(wasm_v128_load(x + 8), wasm_v128_load(c + 8))));
+        }
+        float sum = wasm_f32x4_extract_lane(acc, 0) + wasm_f32x4_extract_lane(acc, 1) +
+                    wasm_f32x4_extract_lane(acc, 2) + wasm_f32x4_extract_lane(acc, 3);
+#elif defined(__SSE2__)
+        // Native builds: pmaddwd is the same pairwise dot, summed the same way
+        __m128 acc = _mm_cvtepi32_ps(_mm_madd_epi16(_mm_loadu_si128((const __m128i*)x),
+                                                    _mm_loadu_si128((const __m128i*)c)));
+        if (taps == 16) {
+            acc = _mm_add_ps(acc, _mm_cvtepi32_ps(_mm_madd_epi16(_mm_loadu_si128((const __m128i*)(x + 8)),
+                                                                 _mm_loadu_si128((const __m128i*)(c + 8)))));
+        }
+        float lanes[4];
+        _mm_storeu_ps(lanes, acc);
+        float sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#else
+        int64_t isum = 0;
+        for (int k = 0; k < taps; k++) isum += (int32_t)x[k] * c[k];
+        float sum = (float)isum;
+#endif
+        out[i] = sum * scale;
+    }
+}
+
+// Runs L and R through the biquad together (one f64x2 lane pair) with
+// per-frame coefficients; the filter keeps the last set. DSP_FLOAT32 builds
+// take the scalar loop, which the compiler keeps in float registers.
+static void lpfProcessStereoBlock(TwoPoleLPF* lpf, const LpfCoefs* coefs,
+                                  float* xL, float* xR, int n) {
+    if (n <= 0) return;
+#if defined(__wasm_simd128__) && !defined(DSP_FLOAT32)
+    v128_t z1 = wasm_f64x2_make(lpf->z1L, lpf->z1R);
+    v128_t z2 = wasm_f64x2_make(lpf->z2L, lpf->z2R);
+    for (int i = 0; i < n; i++) {
+        const LpfCoefs* c = &coefs[i];
+        v128_t x = wasm_f64x2_make(xL[i], xR[i]);
+        v128_t y = wasm_f64x2_add(wasm_f64x2_mul(wasm_f64x2_splat(c->b0), x), z1);
+        z1 = wasm_f64x2_add(wasm_f64x2_sub(wasm_f64x2_mul(wasm_f64x2_splat(c->b1), x),
+                                           wasm_f64x2_mul(wasm_f64x2_splat(c->a1), y)), z2);
+        z2 = wasm_f64x2_sub(wasm_f64x2_mul(wasm_f64x2_splat(c->b2), x),
+                            wasm_f64x2_mul(wasm_f64x2_splat(c->a2), y));
+        xL[i] = (float)wasm_f64x2_extract_lane(y, 0);
+        xR[i] = (float)wasm_f64x2_extract_lane(y, 1);
+    }
+    lpf->z1L = wasm_f64x2_extract_lane(z1, 0);
+    lpf->z1R = wasm_f64x2_extract_lane(z1, 1);
+    lpf->z2L = wasm_f64x2_extract_lane(z2, 0);
+    lpf->z2R = wasm_f64x2_extract_lane(z2, 1);
+#else
+    for (int i = 0; i < n; i++) {
+        const LpfCoefs* c = &coefs[i];
+        dsp_real_t yL = c->b0 * xL[i] + lpf->z1L;
+        lpf->z1L = c->b1 * xL[i] - c->a1 * yL + lpf->z2L;
+        lpf->z2L = c->b2 * xL[i] - c->a2 * yL;
+        dsp_real_t yR = c->b0 * xR[i] + lpf->z1R;
+        lpf->z1R = c->b1 * xR[i] - c->a1 * yR + lpf->z2R;
+        lpf->z2R = c->b2 * xR[i] - c->a2 * yR;
+        xL[i] = (float)yL;
+        xR[i] = (float)yR;
+    }
+#endif
+    const LpfCoefs* last = &coefs[n - 1];
+    lpf->b0 = last->b0;
+    lpf->b1 = last->b1;
+    lpf->b2 = last->b2;
+    lpf->a1 = last->a1;
+    lpf->a2 = last->a2;
+}
+
+// Gain/pan/accumulate: outL += xL * gainL, outR += xR * gainR
+static void mixAccumulateBlock(float* outL, float* outR, const float* xL, const float* xR,
+                               const float* gainL, const float* gainR, int n) {
+    int i = 0;
+#ifdef __wasm_simd128__
+    for (; i + 4 <= n; i += 4) {
+        v128_t l = wasm_f32x4_mul(wasm_v128_load(xL + i), wasm_v128_load(gainL + i));
+        v128_t r = wasm_f32x4_mul(wasm_v128_load(xR + i), wasm_v128_load(gainR + i));
+        wasm_v128_store(outL + i, wasm_f32x4_add(wasm_v128_load(outL + i), l));
+        wasm_v128_store(outR + i, wasm_f32x4_add(wasm_v128_load(outR + i), r));
+    }
+#endif
+    for (; i < n; i++) {
+        outL[i] += xL[i] * gainL[i];
+        outR[i] += xR[i] * gainR[i];
+    }
+}
+
+// Effects send: bus += (xL * gainL + xR * gainR) * send, the mixed output
+// summed to mono
+static void sendAccumulateBlock(float* bus, const float* xL, const float* xR,
+                                const float* gainL, const float* gainR, float send, int n) {
+    for (int i = 0; i < n; i++) {
+        float l = xL[i] * gainL[i];
+        float r = xR[i] * gainR[i];
+        bus[i] += (l + r) * send;
+    }
+}
+
+// Heap helpers so the JS side can stage sample data and output buffers
+EMSCRIPTEN_KEEPALIVE
+void* dspMalloc(int bytes) {
+    return malloc(bytes > 0 ? (size_t)bytes : 1);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void dspFree(void* ptr) {
+    free(ptr);
+}
+
+// Positions are 32.32 fixed point: frame index in the high word, fraction in
+// the low word, so a frame's sample index and phase are a shift and a mask
+#define PHASE_ONE 4294967296.0
+#define PHASE_FRAME ((uint64_t)1 << 32)
+
+// Frames of loop kept on each side of the loop point in a voice's seam buffer;
+// covers any read window that crosses it
+#define VOICE_SEAM 32
+
+// Voice: one playing region with all of its modulation state, rendered a block at a time
+typedef struct {
+    double sr;
+
+    // 16-bit sample data (dataR == NULL => mono), positions in frames
+    const int16_t* dataL;
+    const int16_t* dataR;
+    int length;
+    int lengthR;
+    dsp_real_t gainL; // peak normalization per channel
+    dsp_real_t gainR;
+    int loopStart; // frames
+    int loopEnd;
+    int looping;
+    int loopUntilRelease; // sampleModes 3: loop until noteOff, then play the tail
+    int inReleaseTail;
+    int finished;
+
+    // Playback: position and per-frame increment in 32.32 fixed point. Loop
+    // wrap subtracts loopLenFx; loopSeamed voices (a valid loop inside the
+    // sample) read windows that cross the loop point from seamL/seamR, which
+    // hold VOICE_SEAM frames from each side of it
+    uint64_t phase;
+    uint64_t lengthFx;
+    uint64_t loopStartFx;
+    uint64_t loopEndFx;
+    uint64_t loopLenFx;
+    int loopSeamed;
+    int loopWrapped; // has wrapped at least once since noteOn
+    int16_t seamL[2 * VOICE_SEAM];
+    int16_t seamR[2 * VOICE_SEAM];
+    double baseRate;
+
+    // Control-rate modulation: mod env, LFOs, pitch and filter coefficients are
+    // recomputed every controlInterval frames and linearly ramped in between
+    int controlInterval;
+    int controlLeft;   // frames until the next control update (0 = update now)
+    int controlPrimed; // 0 until the first update after noteOn
+    int64_t inc;       // 32.32 frames per output frame
+    int64_t incStep;
+    LpfCoefs coefs;
+    LpfCoefs coefsStep;
+
+    // Interpolator picked at noteOn from the quality setting and pitch ratio
+    int interpQuality; // INTERP_* upper bound
+    int interpMode;    // INTERP_* in use
+    const int16_t* sincTable;
+    int sincTaps;
+
+    // Modulation depths (cents)
+    dsp_real_t vibLfoToPitchCents;
+    dsp_real_t modLfoToPitchCents;
+    dsp_real_t initialFilterFcCents;
+    dsp_real_t modEnvToFilterFcCents;
+    dsp_real_t modLfoToFilterFcCents;
+
+    // Gains
+    dsp_real_t baseGain;
+    dsp_real_t regionPanPos; // -1..+1
+    dsp_real_t volumeMul;    // cc7 * cc11
+    dsp_real_t ccPanPos;     // -1..+1
+    dsp_real_t fadeGain;     // 1 unless the voice was stolen and is ramping out
+    dsp_real_t fadeStep;     // per-frame decrement of fadeGain (0 = not fading)
+    dsp_real_t reverbSend;   // 0..1 of the output sent to the effects buses
+    dsp_real_t chorusSend;
+
+    // Pool bookkeeping (used by Synth)
+    int channel;
+    int note;
+    int exclusiveClass;
+    unsigned int age;
+    int renderedFrames;        // frames computed by the last voiceRenderBlock call
+    unsigned int renderStamp;  // Synth render call that last counted this voice
+
+    VolEnv volEnv;
+    ModEnv modEnv;
+    LFO modLfo;
+    LFO vibLfo;
+    TwoPoleLPF lpf;
+} Voice;
+
+EMSCRIPTEN_KEEPALIVE
+Voice* voiceCreate(double sr) {
+    fastMathInit();
+    sincTablesInit();
+    Voice* v = (Voice*)calloc(1, sizeof(Voice));
+    if (!v) return NULL;
+
+    v->sr = sr;
+    v->baseRate = 1.0;
+    v->controlInterval = 1;
+    v->initialFilterFcCents = 13500.0;
+    v->volumeMul = 1.0;
+    v->fadeGain = 1.0;
+    v->finished = 1;
+
+    volEnvInit(&v->volEnv, sr);
+    modEnvInit(&v->modEnv, sr);
+    lfoInit(&v->modLfo, sr);
+    lfoInit(&v->vibLfo, sr);
+    lpfInit(&v->lpf, sr);
+    return v;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void voiceDestroy(Voice* v) {
+    free(v);
+}
+
+// Interpolation quality (INTERP_*), applied from the next noteOn. Linear and
+// Hermite are used as given; the sinc settings take the table whose band
+// matches the voice's base pitch ratio.
+EMSCRIPTEN_KEEPALIVE
+void voiceSetInterpolation(Voice* v, int quality) {
+    v->interpQuality = quality < INTERP_LINEAR ? INTERP_LINEAR : (quality > INTERP_SINC16 ? INTERP_SINC16 : quality);
+}
+
+// Frames between modulation updates: 1 = every sample (reference quality)
+EMSCRIPTEN_KEEPALIVE
+void voiceSetControlInterval(Voice* v, int frames) {
+    v->controlInterval = frames < 1 ? 1 : (frames > VOICE_CHUNK ? VOICE_CHUNK : frames);
+    v->controlLeft = 0; // re-ramp over the new period
+}
+
+// Accessors so the existing *SetFromSf2 / lfoSet exports configure the embedded state
+EMSCRIPTEN_KEEPALIVE
+VolEnv* voiceGetVolEnv(Voice* v) { return &v->volEnv; }
+
+EMSCRIPTEN_KEEPALIVE
+ModEnv* voiceGetModEnv(Voice* v) { return &v->modEnv; }
+
+EMSCRIPTEN_KEEPALIVE
+LFO* voiceGetModLfo(Voice* v) { return &v->modLfo; }
+
+EMSCRIPTEN_KEEPALIVE
+LFO* voiceGetVibLfo(Voice* v) { return &v->vibLfo; }
+
+// seam[k] is loop frame loopEnd - VOICE_SEAM + k taken around the loop, so
+// the buffer reads straight across the loop point (and repeats short loops)
+static void voiceBuildSeam(const Voice* v, const int16_t* data, int length, int16_t* seam) {
+    int loopLen = v->loopEnd - v->loopStart;
+    for (int k = 0; k < 2 * VOICE_SEAM; k++) {
+        int x = (v->loopEnd - VOICE_SEAM + k - v->loopStart) % loopLen;
+        if (x < 0) x += loopLen;
+        seam[k] = sampleAt(data, length, v->loopStart + x);
+    }
+}
+
+EMSCRIPTEN_KEEPALIVE
+void voiceSetSample(Voice* v, const int16_t* dataL, const int16_t* dataR, int length, int lengthR,
+                    double gainL, double gainR, double loopStart, double loopEnd, int sampleModes) {
+    v->dataL = dataL;
+    v->dataR = dataR;
+    v->length = length;
+    v->lengthR = lengthR;
+    v->gainL = gainL;
+    v->gainR = gainR;
+    v->loopStart = (int)loopStart;
+    v->loopEnd = (int)loopEnd;
+    v->looping = (sampleModes == 1 || sampleModes == 3);
+    v->loopUntilRelease = (sampleModes == 3);
+
+    v->lengthFx = (uint64_t)(length > 0 ? length : 0) << 32;
+    v->loopStartFx = (uint64_t)(v->loopStart > 0 ? v->loopStart : 0) << 32;
+    v->loopEndFx = (uint64_t)(v->loopEnd > 0 ? v->loopEnd : 0) << 32;
+    v->loopLenFx = v->loopEndFx > v->loopStartFx ? v->loopEndFx - v->loopStartFx : 0;
+    v->loopSeamed = v->looping && v->loopStart >= 0 && v->loopEnd > v->loopStart && v->loopEnd <= length;
+    if (v->loopSeamed) {
+        voiceBuildSeam(v, dataL, length, v->seamL);
+        if (dataR) voiceBuildSeam(v, dataR, lengthR, v->seamR);
+    }
+}
+
+EMSCRIPTEN_KEEPALIVE
+void voiceSetPitch(Voice* v, double baseRate, double vibLfoToPitchCents, double modLfoToPitchCents) {
+    v->baseRate = baseRate;
+    v->vibLfoToPitchCents = vibLfoToPitchCents;
+    v->modLfoToPitchCents = modLfoToPitchCents;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void voiceSetFilter(Voice* v, double initialFcCents, double modEnvToFcCents, double modLfoToFcCents) {
+    v->initialFilterFcCents = initialFcCents;
+    v->modEnvToFilterFcCents = modEnvToFcCents;
+    v->modLfoToFilterFcCents = modLfoToFcCents;
+    lpfSetCutoffHz(&v->lpf, fcCentsToHz(initialFcCents));
+}
+
+EMSCRIPTEN_KEEPALIVE
+void voiceSetGain(Voice* v, double baseGain, double pan) {
+    v->baseGain = baseGain;
+    v->regionPanPos = fmax(-500.0, fmin(500.0, pan)) / 500.0;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void voiceSetMix(Voice* v, double volumeMul, double ccPanPos) {
+    v->volumeMul = volumeMul;
+    v->ccPanPos = ccPanPos;
+}
+
+// Effects send levels 0..1, read by the synth when it feeds its buses
+// (synthVoiceSends)
+EMSCRIPTEN_KEEPALIVE
+void voiceSetSends(Voice* v, double reverb, double chorus) {
+    v->reverbSend = fmax(0.0, fmin(1.0, reverb));
+    v->chorusSend = fmax(0.0, fmin(1.0, chorus));
+}
+
+static void voiceSelectInterpolator(Voice* v) {
+    v->interpMode = v->interpQuality;
+    v->sincTable = NULL;
+    v->sincTaps = 0;
+    if (v->interpMode == INTERP_SINC8 || v->interpMode == INTERP_SINC16) {
+        v->sincTaps = v->interpMode == INTERP_SINC16 ? 16 : 8;
+        v->sincTable = sincTableGet(v->sincTaps, sincBandForRatio(v->baseRate));
+    }
+}
+
+EMSCRIPTEN_KEEPALIVE
+void voiceNoteOn(Voice* v) {
+    v->phase = 0;
+    v->loopWrapped = 0;
+    v->inReleaseTail = 0;
+    v->fadeGain = 1.0;
+    v->fadeStep = 0.0;
+    v->finished = (v->dataL == NULL || v->length <= 0);
+    v->controlLeft = 0;
+    v->controlPrimed = 0;
+    voiceSelectInterpolator(v);
+
+    v->modLfo.phase = 0.0;
+    v->vibLfo.phase = 0.0;
+    v->lpf.z1L = v->lpf.z2L = 0.0;
+    v->lpf.z1R = v->lpf.z2R = 0.0;
+
+    volEnvNoteOn(&v->volEnv);
+    modEnvNoteOn(&v->modEnv);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void voiceNoteOff(Voice* v) {
+    volEnvNoteOff(&v->volEnv);
+    modEnvNoteOff(&v->modEnv);
+
+    // sampleModes 3: stop looping on release, play tail to end
+    if (v->loopUntilRelease) v->inReleaseTail = 1;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int voiceIsFinished(Voice* v) {
+    return v->finished;
+}
+
+static void voiceInterpolate(const Voice* v, const int16_t* const* src, const float* frac,
+                             float gain, float* out, int n) {
+    switch (v->interpMode) {
+        case INTERP_HERMITE:
+            interpHermiteBlock(src, frac, gain, out, n);
+            break;
+        case INTERP_SINC8:
+        case INTERP_SINC16:
+            interpSincBlock(src, frac, gain, v->sincTable, v->sincTaps, out, n);
+            break;
+        default:
+            interpLinearBlock(src, frac, gain, out, n);
+            break;
+    }
+}
+
+// Steps the modulators by one control period and sets up the pitch and
+// coefficient ramps that reach the new targets at the end of that period
+static void voiceControlUpdate(Voice* v) {
+    int n = v->controlInterval;
+    double dt = n / v->sr;
+    double modEnv = modEnvStep(&v->modEnv, n); // 0..1
+    double modLfo = lfoStep(&v->modLfo, dt);    // -1..1
+    double vibLfo = lfoStep(&v->vibLfo, dt);    // -1..1
+
+    // Pitch modulation (cents)
+    double pitchCents = vibLfo * v->vibLfoToPitchCents + modLfo * v->modLfoToPitchCents;
+    double rate = v->baseRate * fastCentsToRatio(pitchCents);
+
+    // Filter cutoff modulation
+    double fcCents = v->initialFilterFcCents +
+                     modEnv * v->modEnvToFilterFcCents +
+                     modLfo * v->modLfoToFilterFcCents;
+    LpfCoefs target;
+    lpfCoefsForCutoff(v->sr, fastFcCentsToHz(fcCents), &target);
+
+    int64_t inc = (int64_t)(rate * PHASE_ONE + 0.5);
+    if (!v->controlPrimed) {
+        // Nothing to ramp from right after noteOn: start at the target
+        v->inc = inc;
+        v->coefs = target;
+        v->controlPrimed = 1;
+        v->incStep = 0;
+        v->coefsStep.b0 = v->coefsStep.b1 = v->coefsStep.b2 = 0.0;
+        v->coefsStep.a1 = v->coefsStep.a2 = 0.0;
+    } else {
+        double inv = 1.0 / n;
+        v->incStep = (inc - v->inc) / n;
+        v->coefsStep.b0 = (target.b0 - v->coefs.b0) * inv;
+        v->coefsStep.b1 = (target.b1 - v->coefs.b1) * inv;
+        v->coefsStep.b2 = (target.b2 - v->coefs.b2) * inv;
+        v->coefsStep.a1 = (target.a1 - v->coefs.a1) * inv;
+        v->coefsStep.a2 = (target.a2 - v->coefs.a2) * inv;
+    }
+    v->controlLeft = n;
+}
+
+static void voiceAdvancePos(Voice* v) {
+    v->phase += (uint64_t)v->inc;
+
+    // In "release tail" mode looping is disabled
+    if (v->looping && !v->inReleaseTail) {
+        if (v->phase >= v->loopEndFx) {
+            if (v->loopLenFx > PHASE_FRAME) {
+                // More than one subtraction only when a frame steps past a whole loop
+                do {
+                    v->phase -= v->loopLenFx;
+                } while (v->phase >= v->loopEndFx);
+            } else {
+                v->phase = v->loopStartFx;
+            }
+            v->loopWrapped = 1;
+        }
+    } else if (v->phase >= v->lengthFx) {
+        v->finished = 1;
+    }
+}
+
+// Points src[i] at frame idx[i] of one channel. Frames whose read window lies
+// inside the sample (and, while looping, inside the loop once it has wrapped,
+// which happens from frame wrapFrom on) read the sample directly; windows
+// crossing the loop point read the seam; the rest (sample start, or a loop
+// shorter than a window on its first pass) get a copy in edge[i] that is
+// zero-padded outside the sample, and frames past the end the zero window.
+static void voiceWindows(const Voice* v, const int16_t* data, int length, const int16_t* seam,
+                         const int* idx, int wrapFrom, int n, const int16_t** src,
+                         int16_t (*edge)[VOICE_WINDOW]) {
+    int loop = v->loopSeamed && !v->inReleaseTail;
+    int hi = loop ? v->loopEnd : length;
+    for (int i = 0; i < n; i++) {
+        int j = idx[i];
+        int wrapped = loop && i >= wrapFrom;
+        int lo = wrapped ? v->loopStart : 0;
+        if (j - VOICE_WINDOW_BEFORE >= lo && j + VOICE_WINDOW_AFTER <= hi) {
+            src[i] = data + j;
+        } else if (loop && (wrapped || j - VOICE_WINDOW_BEFORE >= v->loopStart)) {
+            int toSeam = j + VOICE_WINDOW_AFTER > hi ? v->loopEnd : v->loopStart;
+            src[i] = seam + (j - toSeam + VOICE_SEAM);
+        } else if (!loop && j >= length - 1) {
+            src[i] = zeroWindow + VOICE_WINDOW_BEFORE;
+        } else {
+            for (int k = 0; k < VOICE_WINDOW; k++) {
+                int x = j - VOICE_WINDOW_BEFORE + k;
+                if (loop && x >= v->loopEnd) x = v->loopStart + (x - v->loopStart) % (v->loopEnd - v->loopStart);
+                edge[i][k] = sampleAt(data, length, x);
+            }
+            src[i] = edge[i] + VOICE_WINDOW_BEFORE;
+        }
+    }
+}
+
+// Envelope x region gain below which a whole chunk is inaudible (about
+// -100 dBFS, under one 16-bit step). Channel volume is left out so that a
+// voice under cc7 = 0 survives to be turned back up.
+#define VOICE_SILENCE_GAIN 1.0e-5
+
+// Renders `frames` samples of this voice and accumulates them into outL/outR.
+// The voice finishes as soon as its volume envelope goes idle, or once a
+// full chunk in decay, sustain or release (where the level can only fall)
+// stays under VOICE_SILENCE_GAIN. Frames spent in the delay stage only
+// advance position and modulators: nothing is audible yet, so the
+// interpolation, filter and mix kernels skip them.
+// reverbBus/chorusBus (NULL = no send) are indexed like outL/outR and also
+// get the output summed to mono, times reverbSend/chorusSend.
+static void voiceRenderSends(Voice* v, float* outL, float* outR, float* reverbBus, float reverbSend,
+                             float* chorusBus, float chorusSend, int frames) {
+    int idx[VOICE_CHUNK];
+    float frac[VOICE_CHUNK];
+    LpfCoefs coefs[VOICE_CHUNK];
+    float gainL[VOICE_CHUNK];
+    float gainR[VOICE_CHUNK];
+    float xL[VOICE_CHUNK];
+    float xR[VOICE_CHUNK];
+    float env[VOICE_CHUNK];
+    const int16_t* src[VOICE_CHUNK];
+    int16_t edge[VOICE_CHUNK][VOICE_WINDOW];
+
+    // Pan only changes between blocks
+    double panL, panR;
+    balanceToGains(v->regionPanPos + v->ccPanPos, &panL, &panR);
+    v->renderedFrames = 0;
+
+    for (int offset = 0; offset < frames && !v->finished; offset += VOICE_CHUNK) {
+        int chunk = frames - offset < VOICE_CHUNK ? frames - offset : VOICE_CHUNK;
+
+        // Frames still in the delay stage (a prefix of the chunk) are silent and
+        // never reach the kernels, so the filter starts from rest at the attack
+        // wherever the chunk boundaries fall
+        int delayed = 0;
+        if (v->volEnv.stage == 1) delayed = v->volEnv.left < chunk ? v->volEnv.left : chunk;
+
+        // Volume envelope for the whole chunk (audio rate)
+        volEnvRenderBlock(&v->volEnv, env, chunk);
+
+        // --- Scalar pass: read positions, ramped coefficients and gain per frame ---
+        int n = 0;
+        double peak = 0.0; // loudest envelope x region gain in the chunk
+        int wrapFrom = v->loopWrapped ? 0 : chunk; // first frame after the first loop wrap
+        // The coefficient ramp runs in registers and goes back to the voice only
+        // around control updates, which read it. Ramping through v->coefs made
+        // AVX builds reload the struct with one wide load right after its
+        // narrow stores, a stalled store forward on every frame.
+        LpfCoefs c = v->coefs;
+        LpfCoefs dc = v->coefsStep;
+        while (n < chunk && !v->finished) {
+            if (v->controlLeft == 0) {
+                v->coefs = c;
+                voiceControlUpdate(v);
+                c = v->coefs;
+                dc = v->coefsStep;
+            }
+            v->controlLeft--;
+
+            v->inc += v->incStep;
+            c.b0 += dc.b0;
+            c.b1 += dc.b1;
+            c.b2 += dc.b2;
+            c.a1 += dc.a1;
+            c.a2 += dc.a2;
+            coefs[n] = c;
+
+            idx[n] = (int)(v->phase >> 32);
+            frac[n] = (float)(uint32_t)v->phase * (float)(1.0 / PHASE_ONE);
+
+            double level = v->baseGain * env[n];
+            if (level > peak) peak = level;
+            double g = level * v->volumeMul * v->fadeGain;
+            gainL[n] = (float)(g * panL);
+            gainR[n] = (float)(g * panR);
+            n++;
+
+            if (v->fadeStep > 0.0) {
+                v->fadeGain -= v->fadeStep;
+                if (v->fadeGain <= 0.0) v->finished = 1;
+            }
+
+            // Advance position (looping/tail)
+            voiceAdvancePos(v);
+            if (wrapFrom == chunk && v->loopWrapped) wrapFrom = n;
+        }
+        v->coefs = c;
+
+        if (v->volEnv.stage == 0) v->finished = 1; // release complete
+        if (delayed >= n) continue;
+
+        // --- Kernels: interpolate (stereo if provided; else mono), filter, mix ---
+        int d = delayed;
+        int m = n - d;
+        voiceWindows(v, v->dataL, v->length, v->seamL, idx + d, wrapFrom - d, m, src, edge);
+        voiceInterpolate(v, src, frac + d, (float)v->gainL, xL, m);
+        if (v->dataR) {
+            voiceWindows(v, v->dataR, v->lengthR, v->seamR, idx + d, wrapFrom - d, m, src, edge);
+            voiceInterpolate(v, src, frac + d, (float)v->gainR, xR, m);
+        } else {
+            memcpy(xR, xL, (size_t)m * sizeof(float));
+        }
+        lpfProcessStereoBlock(&v->lpf, coefs + d, xL, xR, m);
+        mixAccumulateBlock(outL + offset + d, outR + offset + d, xL, xR, gainL + d, gainR + d, m);
+        if (reverbBus) sendAccumulateBlock(reverbBus + offset + d, xL, xR, gainL + d, gainR + d, reverbSend, m);
+        if (chorusBus) sendAccumulateBlock(chorusBus + offset + d, xL, xR, gainL + d, gainR + d, chorusSend, m);
+        v->renderedFrames += m;
+
+        if (n == VOICE_CHUNK && peak < VOICE_SILENCE_GAIN && v->volEnv.stage >= 4) v->finished = 1;
+    }
+}
+
+EMSCRIPTEN_KEEPALIVE
+void voiceRenderBlock(Voice* v, float* outL, float* outR, int frames) {
+    voiceRenderSends(v, outL, outR, NULL, 0.0f, NULL, 0.0f, frames);
+}
+
+
+// Region: one playable preset/instrument zone with all generators resolved
+struct Region {
+    int keyLo, keyHi;
+    int velLo, velHi;
+
+    // Sample frames are offsets into the synth's 16-bit sample bank (offsetR < 0 => mono)
+    int offsetL;
+    int offsetR;
+    int length;
+    int lengthR;
+    double gainL;
+    double gainR;
+    double loopStart;
+    double loopEnd;
+    int sampleModes;
+    double sampleRate;
+
+    // Tuning
+    int rootKey;
+    double scaleTuning;
+    double coarseTune;
+    double fineTune;
+
+    // Amp
+    double attenuationCb;
+    double pan;
+    int exclusiveClass;
+
+    // Envelopes (delay, attack, hold, decay, sustain, release) in SF2 units
+    double volEnv[6];
+    double modEnv[6];
+
+    // Filter
+    double initialFilterFcCents;
+    double modEnvToFilterFcCents;
+    double modLfoToFilterFcCents;
+
+    // LFOs
+    double modLfoDelayTc;
+    double modLfoFreqCents;
+    double modLfoToPitchCents;
+    double vibLfoDelayTc;
+    double vibLfoFreqCents;
+    double vibLfoToPitchCents;
+
+    // Effects sends (0.1% units)
+    double chorusSend;
+    double reverbSend;
+};
+
+static void regionInit(Region* r) {
+    r->keyLo = 0;
+    r->keyHi = 127;
+    r->velLo = 0;
+    r->velHi = 127;
+
+    r->offsetL = 0;
+    r->offsetR = -1;
+    r->length = 0;
+    r->lengthR = 0;
+    r->gainL = 1.0;
+    r->gainR = 1.0;
+    r->loopStart = 0.0;
+    r->loopEnd = 0.0;
+    r->sampleModes = 0;
+    r->sampleRate = 44100.0;
+
+    r->rootKey = 60;
+    r->scaleTuning = 100.0;
+    r->coarseTune = 0.0;
+    r->fineTune = 0.0;
+
+    r->attenuationCb = 0.0;
+    r->pan = 0.0;
+    r->exclusiveClass = 0;
+
+    for (int i = 0; i < 6; i++) {
+        r->volEnv[i] = -12000.0;
+        r->modEnv[i] = -12000.0;
+    }
+    r->volEnv[4] = 0.0; // sustainCb
+    r->volEnv[5] = 0.0; // releaseTc
+    r->modEnv[4] = 0.0; // sustain 0..1
+    r->modEnv[5] = 0.0;
+
+    r->initialFilterFcCents = 13500.0;
+    r->modEnvToFilterFcCents = 0.0;
+    r->modLfoToFilterFcCents = 0.0;
+
+    r->modLfoDelayTc = -12000.0;
+    r->modLfoFreqCents = 0.0;
+    r->modLfoToPitchCents = 0.0;
+    r->vibLfoDelayTc = -12000.0;
+    r->vibLfoFreqCents = 0.0;
+    r->vibLfoToPitchCents = 0.0;
+
+    r->chorusSend = 0.0;
+    r->reverbSend = 0.0;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void regionSetRanges(Region* r, int keyLo, int keyHi, int velLo, int velHi) {
+    r->keyLo = keyLo;
+    r->keyHi = keyHi;
+    r->velLo = velLo;
+    r->velHi = velHi;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void regionSetSample(Region* r, int offsetL, int length, double gainL,
+                     int offsetR, int lengthR, double gainR,
+                     double loopStart, double loopEnd, int sampleModes, double sampleRate) {
+    r->offsetL = offsetL;
+    r->length = length;
+    r->gainL = gainL;
+    r->offsetR = offsetR;
+    r->lengthR = lengthR;
+    r->gainR = gainR;
+    r->loopStart = loopStart;
+    r->loopEnd = loopEnd;
+    r->sampleModes = sampleModes;
+    r->sampleRate = sampleRate;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void regionSetTuning(Region* r, int rootKey, double scaleTuning, double coarseTune, double fineTune) {
+    r->rootKey = rootKey;
+    r->scaleTuning = scaleTuning;
+    r->coarseTune = coarseTune;
+    r->fineTune = fineTune;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void regionSetAmp(Region* r, double attenuationCb, double pan, int exclusiveClass) {
+    r->attenuationCb = attenuationCb;
+    r->pan = pan;
+    r->exclusiveClass = exclusiveClass;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void regionSetVolEnv(Region* r, double delayTc, double attackTc, double holdTc,
+                     double decayTc, double sustainCb, double releaseTc) {
+    r->volEnv[0] = delayTc;
+    r->volEnv[1] = attackTc;
+    r->volEnv[2] = holdTc;
+    r->volEnv[3] = decayTc;
+    r->volEnv[4] = sustainCb;
+    r->volEnv[5] = releaseTc;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void regionSetModEnv(Region* r, double delayTc, double attackTc, double holdTc,
+                     double decayTc, double sustain, double releaseTc) {
+    r->modEnv[0] = delayTc;
+    r->modEnv[1] = attackTc;
+    r->modEnv[2] = holdTc;
+    r->modEnv[3] = decayTc;
+    r->modEnv[4] = sustain;
+    r->modEnv[5] = releaseTc;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void regionSetFilter(Region* r, double initialFcCents, double modEnvToFcCents, double modLfoToFcCents) {
+    r->initialFilterFcCents = initialFcCents;
+    r->modEnvToFilterFcCents = modEnvToFcCents;
+    r->modLfoToFilterFcCents = modLfoToFcCents;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void regionSetModLfo(Region* r, double delayTc, double freqCents, double toPitchCents) {
+    r->modLfoDelayTc = delayTc;
+    r->modLfoFreqCents = freqCents;
+    r->modLfoToPitchCents = toPitchCents;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void regionSetVibLfo(Region* r, double delayTc, double freqCents, double toPitchCents) {
+    r->vibLfoDelayTc = delayTc;
+    r->vibLfoFreqCents = freqCents;
+    r->vibLfoToPitchCents = toPitchCents;
+}
+
+// chorusEffectsSend / reverbEffectsSend in 0.1% units (0..1000)
+EMSCRIPTEN_KEEPALIVE
+void regionSetEffects(Region* r, double chorusSend, double reverbSend) {
+    r->chorusSend = chorusSend;
+    r->reverbSend = reverbSend;
+}
+
+// A region is playable when its sample range lies inside the loaded bank
+static int regionInBank(const Region* r, int bankLength) {
+    if (r->length <= 0 || r->offsetL < 0 || r->offsetL + r->length > bankLength) return 0;
+    if (r->offsetR >= 0 && r->offsetR + r->lengthR > bankLength) return 0;
+    return 1;
+}
+
+// Configures a pooled voice from a region and starts it
+static void voiceStartRegion(Voice* v, const Region* r, const int16_t* bank, int note, int velocity) {
+    const int16_t* dataR = r->offsetR >= 0 ? bank + r->offsetR : NULL;
+    voiceSetSample(v, bank + r->offsetL, dataR, r->length, r->lengthR, r->gainL, r->gainR,
+                   r->loopStart, r->loopEnd, r->sampleModes);
+
+    double keyTrackCents = (note - r->rootKey) * r->scaleTuning;
+    double tuneCents = r->coarseTune * 100.0 + r->fineTune;
+    double srRatio = r->sampleRate / v->sr;
+    voiceSetPitch(v, centsToRatio(keyTrackCents + tuneCents) * srRatio,
+                  r->vibLfoToPitchCents, r->modLfoToPitchCents);
+    voiceSetFilter(v, r->initialFilterFcCents, r->modEnvToFilterFcCents, r->modLfoToFilterFcCents);
+    voiceSetGain(v, velToLin(velocity, 2.0) * cbAttenToLin(r->attenuationCb), r->pan);
+    voiceSetSends(v, r->reverbSend * 0.001, r->chorusSend * 0.001);
+
+    volEnvSetFromSf2(&v->volEnv, r->volEnv[0], r->volEnv[1], r->volEnv[2],
+                     r->volEnv[3], r->volEnv[4], r->volEnv[5]);
+    modEnvSetFromSf2(&v->modEnv, r->modEnv[0], r->modEnv[1], r->modEnv[2],
+                     r->modEnv[3], r->modEnv[4], r->modEnv[5]);
+
+    lfoSet(&v->modLfo, centsToRatio(r->modLfoFreqCents), timecentsToSeconds(r->modLfoDelayTc));
+    lfoSet(&v->vibLfo, centsToRatio(r->vibLfoFreqCents), timecentsToSeconds(r->vibLfoDelayTc));
+
+    v->note = note;
+    v->exclusiveClass = r->exclusiveClass;
+    voiceNoteOn(v);
+}
+
+// ---------- Effects ----------
+// The reverb and chorus shared by every voice: voices with an SF2 effects
+// send add their output, summed to mono and scaled by the region's send and
+// the channel's send level, to one bus per effect, and each effect runs once
+// per piece of up to SYNTH_FX_FRAMES frames on its bus. The cost is the same
+// whatever the voice count, and every delay line is allocated with the synth.
+// With nothing sent and the tails died out the effects go idle and are
+// skipped, so a song without sends renders exactly as it would dry.
+#define SYNTH_FX_FRAMES 256 // bus length; longer ranges render in pieces, and as a
+                            // multiple of VOICE_CHUNK it keeps chunk boundaries put
+#define FX_REVERB_LINES 8
+#define FX_REVERB_T60 1.8        // seconds to fall 60 dB
+#define FX_REVERB_DAMP_HZ 6000.0 // one-pole lowpass in each feedback path
+#define FX_REVERB_GAIN 0.35f
+#define FX_CHORUS_DELAY_SEC 0.012
+#define FX_CHORUS_DEPTH_SEC 0.003
+#define FX_CHORUS_RATE_HZ 0.4
+#define FX_CHORUS_FEEDBACK 0.2f
+#define FX_CHORUS_GAIN 0.7f
+#define FX_SILENCE 1.0e-7f // delay line level under which an unfed effect goes idle
+
+// Delay line lengths at 48 kHz, mutually prime so their echoes do not line up
+static const int fxReverbDelays[FX_REVERB_LINES] = { 1153, 1327, 1499, 1667, 1823, 1993, 2179, 2351 };
+
+// Feedback delay network: eight delay lines mixed back into each other
+// through a Hadamard matrix, with a per-line gain for FX_REVERB_T60
+typedef struct {
+    float* line[FX_REVERB_LINES];
+    int length[FX_REVERB_LINES];
+    int pos[FX_REVERB_LINES];
+    float feedback[FX_REVERB_LINES];
+    float damp[FX_REVERB_LINES]; // lowpass state
+    float dampCoef;
+} FdnReverb;
+
+// Stereo chorus: one delay line read by two taps whose delays a triangle LFO
+// sweeps in opposite directions
+typedef struct {
+    float* line; // power-of-two ring
+    int mask;
+    int pos;
+    float delay; // frames
+    float depth;
+    double phase; // LFO, cycles
+    double phaseInc;
+    float last; // previous output, fed back
+} Chorus;
+
+typedef struct {
+    float reverbBus[SYNTH_FX_FRAMES];
+    float chorusBus[SYNTH_FX_FRAMES];
+    FdnReverb reverb;
+    Chorus chorus;
+    float* memory; // every delay line
+    size_t memoryLength;
+    int span;   // longest delay line
+    int quiet;  // frames since a delay line was last written above FX_SILENCE
+    int fed;    // something was sent in the current piece
+    int idle;   // nothing sent since the tails died out
+} SynthEffects;
+
+static int effectsInit(SynthEffects* fx, double sr) {
+    FdnReverb* rv = &fx->reverb;
+    Chorus* ch = &fx->chorus;
+    size_t total = 0;
+    for (int k = 0; k < FX_REVERB_LINES; k++) {
+        int len = (int)(fxReverbDelays[k] * sr / 48000.0 + 0.5);
+        rv->length[k] = len < 1 ? 1 : len;
+        rv->feedback[k] = (float)pow(10.0, -3.0 * rv->length[k] / (FX_REVERB_T60 * sr));
+        total += (size_t)rv->length[k];
+        if (rv->length[k] > fx->span) fx->span = rv->length[k];
+    }
+    rv->dampCoef = (float)(1.0 - exp(-2.0 * M_PI * FX_REVERB_DAMP_HZ / sr));
+
+    int ring = 1;
+    while (ring < (int)((FX_CHORUS_DELAY_SEC + FX_CHORUS_DEPTH_SEC) * sr) + 4) ring <<= 1;
+    ch->mask = ring - 1;
+    ch->delay = (float)(FX_CHORUS_DELAY_SEC * sr);
+    ch->depth = (float)(FX_CHORUS_DEPTH_SEC * sr);
+    ch->phaseInc = FX_CHORUS_RATE_HZ / sr;
+    total += (size_t)ring;
+    if (ring > fx->span) fx->span = ring;
+
+    fx->memory = (float*)calloc(total, sizeof(float));
+    if (!fx->memory) return 0;
+    fx->memoryLength = total;
+    float* p = fx->memory;
+    for (int k = 0; k < FX_REVERB_LINES; k++) {
+        rv->line[k] = p;
+        p += rv->length[k];
+    }
+    ch->line = p;
+    fx->idle = 1;
+    return 1;
+}
+
+// Silences the tails (delay lines, filter and LFO state)
+static void effectsClear(SynthEffects* fx) {
+    memset(fx->memory, 0, fx->memoryLength * sizeof(float));
+    for (int k = 0; k < FX_REVERB_LINES; k++) {
+        fx->reverb.pos[k] = 0;
+        fx->reverb.damp[k] = 0.0f;
+    }
+    fx->chorus.pos = 0;
+    fx->chorus.phase = 0.0;
+    fx->chorus.last = 0.0f;
+    fx->quiet = 0;
+    fx->idle = 1;
+}
+
+// In-place 8-point Hadamard transform scaled to be orthogonal
+static void hadamard8(float* x) {
+    for (int h = 1; h < 8; h <<= 1) {
+        for (int i = 0; i < 8; i += h << 1) {
+            for (int j = i; j < i + h; j++) {
+                float a = x[j];
+                float b = x[j + h];
+                x[j] = a + b;
+                x[j + h] = a - b;
+            }
+        }
+    }
+    for (int i = 0; i < 8; i++) x[i] *= 0.35355339f;
+}
+
+// Adds the reverb of in[0, n) to outL/outR; returns the loudest value written
+// to a delay line
+static float reverbProcess(FdnReverb* rv, const float* in, float* outL, float* outR, int n) {
+    float peak = 0.0f;
+    for (int i = 0; i < n; i++) {
+        float y[FX_REVERB_LINES];
+        float d[FX_REVERB_LINES];
+        for (int k = 0; k < FX_REVERB_LINES; k++) {
+            y[k] = rv->line[k][rv->pos[k]];
+            rv->damp[k] += rv->dampCoef * (y[k] - rv->damp[k]);
+            d[k] = rv->damp[k];
+        }
+        hadamard8(d);
+        for (int k = 0; k < FX_REVERB_LINES; k++) {
+            float w = in[i] + d[k] * rv->feedback[k];
+            rv->line[k][rv->pos[k]] = w;
+            if (++rv->pos[k] == rv->length[k]) rv->pos[k] = 0;
+            peak = fmaxf(peak, fabsf(w));
+        }
+        outL[i] += (y[0] - y[2] + y[4] - y[6]) * FX_REVERB_GAIN;
+        outR[i] += (y[1] - y[3] + y[5] - y[7]) * FX_REVERB_GAIN;
+    }
+    return peak;
+}
+
+// Linearly interpolated read `delay` frames behind the write position
+static float chorusTap(const Chorus* ch, float delay) {
+    float p = (float)(ch->pos + ch->mask + 1) - delay;
+    int i = (int)p;
+    float f = p - (float)i;
+    float a = ch->line[i & ch->mask];
+    float b = ch->line[(i + 1) & ch->mask];
+    return a + (b - a) * f;
+}
+
+// Adds the chorus of in[0, n) to outL/outR; returns the loudest value written
+// to the delay line
+static float chorusProcess(Chorus* ch, const float* in, float* outL, float* outR, int n) {
+    float peak = 0.0f;
+    for (int i = 0; i < n; i++) {
+        float w = in[i] + ch->last * FX_CHORUS_FEEDBACK;
+        ch->line[ch->pos] = w;
+        peak = fmaxf(peak, fabsf(w));
+        float tri = (float)(4.0 * fabs(ch->phase - 0.5) - 1.0); // -1..1
+        float l = chorusTap(ch, ch->delay + ch->depth * tri);
+        float r = chorusTap(ch, ch->delay - ch->depth * tri);
+        ch->last = 0.5f * (l + r);
+        ch->pos = (ch->pos + 1) & ch->mask;
+        ch->phase += ch->phaseInc;
+        if (ch->phase >= 1.0) ch->phase -= 1.0;
+        outL[i] += l * FX_CHORUS_GAIN;
+        outR[i] += r * FX_CHORUS_GAIN;
+    }
+    return peak;
+}
+
+// Runs both effects on the buses' first n frames, adds their return to
+// outL/outR and leaves the buses cleared for the next piece. Once nothing
+// above FX_SILENCE has gone into the delay lines for a whole line length,
+// everything they still hold is below it and the effects go idle.
+static void effectsProcess(SynthEffects* fx, float* outL, float* outR, int n) {
+    if (fx->fed) fx->idle = 0;
+    if (fx->idle) return;
+    float peak = reverbProcess(&fx->reverb, fx->reverbBus, outL, outR, n);
+    peak = fmaxf(peak, chorusProcess(&fx->chorus, fx->chorusBus, outL, outR, n));
+    if (fx->fed) {
+        memset(fx->reverbBus, 0, (size_t)n * sizeof(float));
+        memset(fx->chorusBus, 0, (size_t)n * sizeof(float));
+        fx->fed = 0;
+    }
+    fx->quiet = peak < FX_SILENCE ? fx->quiet + n : 0;
+    if (fx->quiet >= fx->span) effectsClear(fx);
+}
+
+// Synth: fixed-capacity voice pool shared by 16 MIDI-style channels, each with
+// its own region table (program) and controllers, plus the mixer.
+// Voices are preallocated with the synth so noteOn never allocates.
+#define SYNTH_MAX_VOICES 256
+#define SYNTH_DEFAULT_VOICES 64
+#define SYNTH_DEFAULT_CONTROL_INTERVAL 16
+#define SYNTH_DEFAULT_INTERPOLATION INTERP_SINC8
+#define SYNTH_EVENT_CAPACITY 1024
+#define SYNTH_FADE_VOICES 16     // stolen voices ramping out, outside the budget
+#define SYNTH_STEAL_FADE_SEC 0.005
+#define SYNTH_RENDER_SLOTS (SYNTH_MAX_VOICES + SYNTH_FADE_VOICES)
+
+// Timestamped event for sample-accurate scheduling (see synthScheduleEvent;
+// the SYNTH_EVENT_* types are in dsp.h)
+typedef struct {
+    int offset; // frames from the start of the next render call
+    int type;
+    int channel;
+    int a, b, c;
+} SynthEvent;
+
+// Key/velocity lookup compiled from a channel's region table: each of the
+// 128 x 128 cells names a span of region indices, so noteOn visits only the
+// regions that sound instead of scanning the whole table (drum kits have
+// hundreds). Span 0 is empty; adjacent cells with the same regions share a span.
+#define REGION_INDEX_KEYS 128
+#define REGION_INDEX_VELS 128
+
+typedef struct {
+    int start; // into SynthChannel.indexList
+    int count;
+} RegionSpan;
+
+typedef struct {
+    Region* regions;
+    int regionCount;
+    int regionCapacity;
+
+    uint16_t* indexCells; // REGION_INDEX_KEYS * REGION_INDEX_VELS span ids
+    RegionSpan* indexSpans;
+    int indexSpanCount;
+    int indexSpanCapacity;
+    int* indexList;
+    int indexListCount;
+    int indexListCapacity;
+    int indexDirty; // regions changed since the last build
+
+    int cc7Volume;
+    int cc10Pan;
+    int cc11Expression;
+    double reverbSend; // synthSetChannelSends: scales the regions' sends, 0..1
+    double chorusSend;
+} SynthChannel;
+
+struct Synth {
+    double sr;
+
+    // Raw SF2 smpl chunk, loaded once and shared by every region
+    const int16_t* sampleBank;
+    int sampleBankLength;
+
+    SynthChannel channels[SYNTH_CHANNELS];
+
+    // Global voice budget across all channels
+    Voice voices[SYNTH_MAX_VOICES];
+    int maxVoices;
+    unsigned int ageCounter;
+
+    // Stolen voices finish a short fade here while their slot plays the new note
+    Voice fading[SYNTH_FADE_VOICES];
+
+    // Voices whose samples were computed in the last render call (the rest of
+    // the active ones were waiting out a delay)
+    unsigned int renderCalls;
+    int renderedVoices;
+
+    int controlInterval; // frames between modulation updates, shared by all voices
+    int interpolation;   // INTERP_* quality for new notes
+
+    // Pending events, ordered by offset (ties keep submission order)
+    SynthEvent events[SYNTH_EVENT_CAPACITY];
+    int eventCount;
+
+    SynthEffects fx; // reverb and chorus behind the voice sends
+
+#ifdef DSP_THREADS
+    struct SynthPool* pool; // synthSetThreadCount; NULL renders straight into the output
+#endif
+
+    SynthStats stats; // since the last synthResetStats
+    int profiling;    // synthSetProfiling: time the render stages
+};
+
+#ifdef DSP_THREADS
+static void synthPoolDestroy(struct SynthPool* p);
+#endif
+
+static int synthValidChannel(int channel) {
+    return channel >= 0 && channel < SYNTH_CHANNELS;
+}
+
+EMSCRIPTEN_KEEPALIVE
+Synth* synthCreate(double sr) {
+    fastMathInit();
+    sincTablesInit();
+    Synth* s = (Synth*)calloc(1, sizeof(Synth));
+    if (!s) return NULL;
+
+    s->sr = sr;
+    s->maxVoices = SYNTH_DEFAULT_VOICES;
+    s->controlInterval = SYNTH_DEFAULT_CONTROL_INTERVAL;
+    s->interpolation = SYNTH_DEFAULT_INTERPOLATION;
+    for (int c = 0; c < SYNTH_CHANNELS; c++) {
+        SynthChannel* ch = &s->channels[c];
+        ch->cc7Volume = 100;
+        ch->cc10Pan = 64;
+        ch->cc11Expression = 127;
+        ch->reverbSend = 1.0;
+        ch->chorusSend = 1.0;
+    }
+    if (!effectsInit(&s->fx, sr)) {
+        free(s);
+        return NULL;
+    }
+
+    for (int i = 0; i < SYNTH_MAX_VOICES; i++) {
+        Voice* v = &s->voices[i];
+        v->sr = sr;
+        v->finished = 1;
+        v->controlInterval = s->controlInterval;
+        v->interpQuality = s->interpolation;
+        volEnvInit(&v->volEnv, sr);
+        modEnvInit(&v->modEnv, sr);
+        lfoInit(&v->modLfo, sr);
+        lfoInit(&v->vibLfo, sr);
+        lpfInit(&v->lpf, sr);
+    }
+    for (int i = 0; i < SYNTH_FADE_VOICES; i++) s->fading[i].finished = 1;
+    return s;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void synthDestroy(Synth* s) {
+    if (!s) return;
+    for (int c = 0; c < SYNTH_CHANNELS; c++) {
+        SynthChannel* ch = &s->channels[c];
+        free(ch->regions);
+        free(ch->indexCells);
+        free(ch->indexSpans);
+        free(ch->indexList);
+    }
+#ifdef DSP_THREADS
+    synthPoolDestroy(s->pool);
+#endif
+    free(s->fx.memory);
+    free(s);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void synthSetMaxVoices(Synth* s, int maxVoices) {
+    int n = maxVoices < 1 ? 1 : (maxVoices > SYNTH_MAX_VOICES ? SYNTH_MAX_VOICES : maxVoices);
+    // Voices above the new budget are cut immediately
+    for (int i = n; i < SYNTH_MAX_VOICES; i++) s->voices[i].finished = 1;
+    s->maxVoices = n;
+}
+
+// Quality/CPU trade-off: 1 updates modulation every sample, 16-32 is
+// inaudible for typical SF2 envelopes and LFOs at a fraction of the cost
+EMSCRIPTEN_KEEPALIVE
+void synthSetControlInterval(Synth* s, int frames) {
+    for (int i = 0; i < SYNTH_MAX_VOICES; i++) voiceSetControlInterval(&s->voices[i], frames);
+    s->controlInterval = s->voices[0].controlInterval;
+}
+
+// Interpolation quality for notes started from now on (INTERP_*: 0 linear,
+// 1 Hermite, 2 8-tap sinc, 3 16-tap sinc)
+EMSCRIPTEN_KEEPALIVE
+void synthSetInterpolation(Synth* s, int quality) {
+    for (int i = 0; i < SYNTH_MAX_VOICES; i++) voiceSetInterpolation(&s->voices[i], quality);
+    s->interpolation = s->voices[0].interpQuality;
+}
+
+// Stops every voice without a release tail (e.g. before sample data is freed)
+// and silences the effects
+EMSCRIPTEN_KEEPALIVE
+void synthAllSoundOff(Synth* s) {
+    for (int i = 0; i < SYNTH_MAX_VOICES; i++) s->voices[i].finished = 1;
+    for (int i = 0; i < SYNTH_FADE_VOICES; i++) s->fading[i].finished = 1;
+    effectsClear(&s->fx);
+}
+
+// Points the synth at a 16-bit sample bank that stays owned by the caller
+EMSCRIPTEN_KEEPALIVE
+void synthSetSampleBank(Synth* s, const int16_t* smpl, int length) {
+    synthAllSoundOff(s);
+    s->sampleBank = smpl;
+    s->sampleBankLength = smpl ? length : 0;
+}
+
+// Replaces a channel's region table (a program change); regions start with SF2
+// defaults and are filled via regionSet*. Sounding voices copied their region
+// parameters at noteOn, so they keep playing.
+EMSCRIPTEN_KEEPALIVE
+int synthSetRegionCount(Synth* s, int channel, int count) {
+    if (!synthValidChannel(channel)) return 0;
+    SynthChannel* ch = &s->channels[channel];
+    if (count < 0) count = 0;
+    if (count > ch->regionCapacity) {
+        Region* next = (Region*)realloc(ch->regions, (size_t)count * sizeof(Region));
+        if (!next) {
+            ch->regionCount = 0;
+            return 0;
+        }
+        ch->regions = next;
+        ch->regionCapacity = count;
+    }
+    for (int i = 0; i < count; i++) regionInit(&ch->regions[i]);
+    ch->regionCount = count;
+    ch->indexDirty = 1;
+    return 1;
+}
+
+// Region pointers are handed out for regionSet*, so taking one invalidates
+// the channel's lookup index
+EMSCRIPTEN_KEEPALIVE
+Region* synthGetRegion(Synth* s, int channel, int index) {
+    if (!synthValidChannel(channel)) return NULL;
+    SynthChannel* ch = &s->channels[channel];
+    if (index < 0 || index >= ch->regionCount) return NULL;
+    ch->indexDirty = 1;
+    return &ch->regions[index];
+}
+
+static int clampMidi(int x) {
+    return x < 0 ? 0 : (x > 127 ? 127 : x);
+}
+
+static int regionIndexReserve(SynthChannel* ch, int spans, int list) {
+    if (spans > ch->indexSpanCapacity) {
+        int cap = ch->indexSpanCapacity ? ch->indexSpanCapacity : 64;
+        while (cap < spans) cap *= 2;
+        RegionSpan* next = (RegionSpan*)realloc(ch->indexSpans, (size_t)cap * sizeof(RegionSpan));
+        if (!next) return 0;
+        ch->indexSpans = next;
+        ch->indexSpanCapacity = cap;
+    }
+    if (list > ch->indexListCapacity) {
+        int cap = ch->indexListCapacity ? ch->indexListCapacity : 256;
+        while (cap < list) cap *= 2;
+        int* next = (int*)realloc(ch->indexList, (size_t)cap * sizeof(int));
+        if (!next) return 0;
+        ch->indexList = next;
+        ch->indexListCapacity = cap;
+    }
+    return 1;
+}
+
+// Compiles the channel's key/velocity index. Cost is per key x velocity band
+// x regions on that key, paid once per program change; the processor calls it
+// right after loading a table and synthNoteOn rebuilds a stale one itself.
+// Returns 0 (and synthNoteOn falls back to a full scan) if allocation fails.
+EMSCRIPTEN_KEEPALIVE
+int synthBuildRegionIndex(Synth* s, int channel) {
+    if (!synthValidChannel(channel)) return 0;
+    SynthChannel* ch = &s->channels[channel];
+    ch->indexDirty = 0;
+    ch->indexSpanCount = 0;
+    ch->indexListCount = 0;
+    if (!ch->indexCells) {
+        ch->indexCells = (uint16_t*)malloc(REGION_INDEX_KEYS * REGION_INDEX_VELS * sizeof(uint16_t));
+    }
+    int* keyRegions = (int*)malloc((size_t)(ch->regionCount > 0 ? ch->regionCount : 1) * sizeof(int));
+    if (!ch->indexCells || !keyRegions || !regionIndexReserve(ch, 1, 0)) {
+        free(keyRegions);
+        ch->indexSpanCount = 0;
+        return 0;
+    }
+    ch->indexSpans[ch->indexSpanCount++] = (RegionSpan){ 0, 0 };
+
+    for (int key = 0; key < REGION_INDEX_KEYS; key++) {
+        uint16_t* cells = ch->indexCells + key * REGION_INDEX_VELS;
+
+        // Regions on this key, in table order, and where their velocity ranges split
+        int n = 0;
+        unsigned char split[REGION_INDEX_VELS + 1] = { 0 };
+        for (int i = 0; i < ch->regionCount; i++) {
+            const Region* r = &ch->regions[i];
+            if (key < r->keyLo || key > r->keyHi || r->velLo > r->velHi) continue;
+            keyRegions[n++] = i;
+            split[clampMidi(r->velLo)] = 1;
+            split[clampMidi(r->velHi) + 1] = 1;
+        }
+
+        int vel = 0;
+        while (vel < REGION_INDEX_VELS) {
+            int end = vel + 1;
+            while (end < REGION_INDEX_VELS && !split[end]) end++;
+
+            if (!regionIndexReserve(ch, ch->indexSpanCount + 1, ch->indexListCount + n)) {
+                free(keyRegions);
+                ch->indexSpanCount = 0;
+                return 0;
+            }
+            int start = ch->indexListCount;
+            int count = 0;
+            for (int j = 0; j < n; j++) {
+                const Region* r = &ch->regions[keyRegions[j]];
+                if (vel >= r->velLo && vel <= r->velHi) ch->indexList[start + count++] = keyRegions[j];
+            }
+
+            // Reuse the previous span when the band holds the same regions
+            int id = 0;
+            if (count > 0) {
+                const RegionSpan* last = &ch->indexSpans[ch->indexSpanCount - 1];
+                if (last->count == count &&
+                    memcmp(ch->indexList + last->start, ch->indexList + start, (size_t)count * sizeof(int)) == 0) {
+                    id = ch->indexSpanCount - 1;
+                } else {
+                    id = ch->indexSpanCount;
+                    ch->indexSpans[ch->indexSpanCount++] = (RegionSpan){ start, count };
+                    ch->indexListCount += count;
+                }
+            }
+            for (int v = vel; v < end; v++) cells[v] = (uint16_t)id;
+            vel = end;
+        }
+    }
+    free(keyRegions);
+    return 1;
+}
+
+// Replaces a channel's region table from a packed table in one call (ints:
+// REGION_INT_COLUMNS * count, floats: REGION_FLOAT_COLUMNS * count) and
+// compiles its lookup index. Returns 0 if the table cannot be allocated.
+EMSCRIPTEN_KEEPALIVE
+int synthLoadRegions(Synth* s, int channel, const int32_t* ints, const float* floats, int count) {
+    if (!synthSetRegionCount(s, channel, count)) return 0;
+    SynthChannel* ch = &s->channels[channel];
+#define ICOL(c) ints[(c) * count + i]
+#define FCOL(c) (double)floats[(c) * count + i]
+    for (int i = 0; i < ch->regionCount; i++) {
+        Region* r = &ch->regions[i];
+        r->keyLo = ICOL(REGION_COL_KEY_LO);
+        r->keyHi = ICOL(REGION_COL_KEY_HI);
+        r->velLo = ICOL(REGION_COL_VEL_LO);
+        r->velHi = ICOL(REGION_COL_VEL_HI);
+        r->offsetL = ICOL(REGION_COL_OFFSET_L);
+        r->length = ICOL(REGION_COL_LENGTH);
+        r->offsetR = ICOL(REGION_COL_OFFSET_R);
+        r->lengthR = ICOL(REGION_COL_LENGTH_R);
+        r->loopStart = ICOL(REGION_COL_LOOP_START);
+        r->loopEnd = ICOL(REGION_COL_LOOP_END);
+        r->sampleModes = ICOL(REGION_COL_SAMPLE_MODES);
+        r->rootKey = ICOL(REGION_COL_ROOT_KEY);
+        r->exclusiveClass = ICOL(REGION_COL_EXCLUSIVE_CLASS);
+
+        r->gainL = FCOL(REGION_FCOL_GAIN_L);
+        r->gainR = FCOL(REGION_FCOL_GAIN_R);
+        r->sampleRate = FCOL(REGION_FCOL_SAMPLE_RATE);
+        r->scaleTuning = FCOL(REGION_FCOL_SCALE_TUNING);
+        r->coarseTune = FCOL(REGION_FCOL_COARSE_TUNE);
+        r->fineTune = FCOL(REGION_FCOL_FINE_TUNE);
+        r->attenuationCb = FCOL(REGION_FCOL_ATTENUATION);
+        r->pan = FCOL(REGION_FCOL_PAN);
+        for (int k = 0; k < 6; k++) {
+            r->volEnv[k] = FCOL(REGION_FCOL_VOL_ENV + k);
+            r->modEnv[k] = FCOL(REGION_FCOL_MOD_ENV + k);
+        }
+        r->initialFilterFcCents = FCOL(REGION_FCOL_FILTER_FC);
+        r->modEnvToFilterFcCents = FCOL(REGION_FCOL_MOD_ENV_TO_FC);
+        r->modLfoToFilterFcCents = FCOL(REGION_FCOL_MOD_LFO_TO_FC);
+        r->modLfoDelayTc = FCOL(REGION_FCOL_MOD_LFO_DELAY);
+        r->modLfoFreqCents = FCOL(REGION_FCOL_MOD_LFO_FREQ);
+        r->modLfoToPitchCents = FCOL(REGION_FCOL_MOD_LFO_TO_PITCH);
+        r->vibLfoDelayTc = FCOL(REGION_FCOL_VIB_LFO_DELAY);
+        r->vibLfoFreqCents = FCOL(REGION_FCOL_VIB_LFO_FREQ);
+        r->vibLfoToPitchCents = FCOL(REGION_FCOL_VIB_LFO_TO_PITCH);
+        r->chorusSend = FCOL(REGION_FCOL_CHORUS_SEND);
+        r->reverbSend = FCOL(REGION_FCOL_REVERB_SEND);
+    }
+#undef ICOL
+#undef FCOL
+    synthBuildRegionIndex(s, channel);
+    return 1;
+}
+
+// Regions sounding for (note, velocity): indices into ch->regions, or NULL
+// with *count = regionCount to scan the whole table
+static const int* synthLookupRegions(Synth* s, int channel, int note, int velocity, int* count) {
+    SynthChannel* ch = &s->channels[channel];
+    if (ch->indexDirty) synthBuildRegionIndex(s, channel);
+    if (ch->indexSpanCount == 0 || note < 0 || note > 127 || velocity < 0 || velocity > 127) {
+        *count = ch->regionCount;
+        return NULL;
+    }
+    const RegionSpan* span = &ch->indexSpans[ch->indexCells[note * REGION_INDEX_VELS + velocity]];
+    *count = span->count;
+    return ch->indexList + span->start;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void synthSetControllers(Synth* s, int channel, int cc7Volume, int cc10Pan, int cc11Expression) {
+    if (!synthValidChannel(channel)) return;
+    SynthChannel* ch = &s->channels[channel];
+    ch->cc7Volume = cc7Volume < 0 ? 0 : (cc7Volume > 127 ? 127 : cc7Volume);
+    ch->cc10Pan = cc10Pan < 0 ? 0 : (cc10Pan > 127 ? 127 : cc10Pan);
+    ch->cc11Expression = cc11Expression < 0 ? 0 : (cc11Expression > 127 ? 127 : cc11Expression);
+}
+
+// Channel send levels 0..1 (1 by default), applied on top of the regions'
+// reverb and chorus sends from the next render on, sounding voices included
+EMSCRIPTEN_KEEPALIVE
+void synthSetChannelSends(Synth* s, int channel, double reverb, double chorus) {
+    if (!synthValidChannel(channel)) return;
+    SynthChannel* ch = &s->channels[channel];
+    ch->reverbSend = fmax(0.0, fmin(1.0, reverb));
+    ch->chorusSend = fmax(0.0, fmin(1.0, chorus));
+}
+
+static void synthChokeExclusive(Synth* s, int channel, int exclusiveClass) {
+    for (int i = 0; i < s->maxVoices; i++) {
+        Voice* v = &s->voices[i];
+        if (!v->finished && v->channel == channel && v->exclusiveClass == exclusiveClass) voiceNoteOff(v);
+    }
+}
+
+// How much losing a voice would be heard: 0 for a voice that has gone silent
+// after release, then releasing voices by loudness, then held voices by
+// loudness. Delay/attack/hold count at peak, so fresh notes are not taken
+// for quiet ones.
+static void voiceStealRank(const Voice* v, int* tier, double* loudness) {
+    const VolEnv* env = &v->volEnv;
+    int stage = env->stage;
+    double level = (stage >= 1 && stage <= 3) ? env->peak : env->level;
+    *tier = (stage == 0 || stage == 6) ? 0 : 1;
+    *loudness = level * v->baseGain * v->volumeMul * v->fadeGain;
+}
+
+// Hands a stolen voice to a fade slot so it ramps out over
+// SYNTH_STEAL_FADE_SEC instead of being cut mid-waveform (a click). With
+// every fade slot busy the voice is cut.
+static void synthFadeOutVoice(Synth* s, const Voice* v) {
+    for (int i = 0; i < SYNTH_FADE_VOICES; i++) {
+        Voice* f = &s->fading[i];
+        if (!f->finished) continue;
+        *f = *v;
+        f->fadeStep = f->fadeGain / (SYNTH_STEAL_FADE_SEC * f->sr);
+        f->renderStamp = 0;
+        return;
+    }
+    s->stats.voicesCut++;
+}
+
+// Returns a free voice slot or, when the budget is exhausted, steals the
+// voice that will be missed least (voiceStealRank; oldest on ties) and
+// fades it out
+static Voice* synthAllocVoice(Synth* s) {
+    Voice* victim = NULL;
+    int victimTier = 0;
+    double victimLoudness = 0.0;
+    for (int i = 0; i < s->maxVoices; i++) {
+        Voice* v = &s->voices[i];
+        if (v->finished) return v;
+        int tier;
+        double loudness;
+        voiceStealRank(v, &tier, &loudness);
+        if (!victim || tier < victimTier ||
+            (tier == victimTier && (loudness < victimLoudness ||
+                                    (loudness == victimLoudness && v->age < victim->age)))) {
+            victim = v;
+            victimTier = tier;
+            victimLoudness = loudness;
+        }
+    }
+    if (victim) {
+        s->stats.voicesStolen++;
+        synthFadeOutVoice(s, victim);
+    }
+    return victim;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int synthNoteOn(Synth* s, int channel, int note, int velocity) {
+    if (!synthValidChannel(channel)) return 0;
+    const SynthChannel* ch = &s->channels[channel];
+    int started = 0;
+    int count;
+    const int* list = synthLookupRegions(s, channel, note, velocity, &count);
+
+    // exclusiveClass choke (within the channel)
+    for (int n = 0; n < count; n++) {
+        const Region* r = &ch->regions[list ? list[n] : n];
+        if (note < r->keyLo || note > r->keyHi || velocity < r->velLo || velocity > r->velHi) continue;
+        if (r->exclusiveClass) synthChokeExclusive(s, channel, r->exclusiveClass);
+    }
+
+    // allocate voices (layering allowed)
+    for (int n = 0; n < count; n++) {
+        const Region* r = &ch->regions[list ? list[n] : n];
+        if (note < r->keyLo || note > r->keyHi || velocity < r->velLo || velocity > r->velHi) continue;
+        if (!s->sampleBank || !regionInBank(r, s->sampleBankLength)) continue;
+
+        Voice* v = synthAllocVoice(s);
+        voiceStartRegion(v, r, s->sampleBank, note, velocity);
+        v->channel = channel;
+        v->age = ++s->ageCounter;
+        started++;
+    }
+    return started;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void synthNoteOff(Synth* s, int channel, int note) {
+    for (int i = 0; i < s->maxVoices; i++) {
+        Voice* v = &s->voices[i];
+        if (!v->finished && v->channel == channel && v->note == note) voiceNoteOff(v);
+    }
+}
+
+// Releases every voice on a channel, or on all channels when channel < 0
+EMSCRIPTEN_KEEPALIVE
+void synthAllNotesOff(Synth* s, int channel) {
+    for (int i = 0; i < s->maxVoices; i++) {
+        Voice* v = &s->voices[i];
+        if (!v->finished && (channel < 0 || v->channel == channel)) voiceNoteOff(v);
+    }
+}
+
+EMSCRIPTEN_KEEPALIVE
+int synthGetActiveVoiceCount(Synth* s) {
+    int n = 0;
+    for (int i = 0; i < s->maxVoices; i++) n += !s->voices[i].finished;
+    return n;
+}
+
+// Voices (fade slots included) that ran the sample kernels during the last
+// synthRender / synthRenderChannels call; compare with synthGetActiveVoiceCount
+EMSCRIPTEN_KEEPALIVE
+int synthGetRenderedVoiceCount(Synth* s) {
+    return s->renderedVoices;
+}
+
+// Queues an event to be applied `offset` frames into the next render call, so
+// note timing is exact within the quantum instead of snapped to its start.
+// Offsets past the rendered block carry over into later calls.
+// Returns 0 when the queue is full (the caller should apply it immediately).
+EMSCRIPTEN_KEEPALIVE
+int synthScheduleEvent(Synth* s, int offset, int type, int channel, int a, int b, int c) {
+    if (s->eventCount >= SYNTH_EVENT_CAPACITY) {
+        s->stats.eventsRejected++;
+        return 0;
+    }
+    if (offset < 0) offset = 0;
+
+    // Insertion keeps the queue sorted; events almost always arrive in order
+    int i = s->eventCount++;
+    while (i > 0 && s->events[i - 1].offset > offset) {
+        s->events[i] = s->events[i - 1];
+        i--;
+    }
+    SynthEvent* ev = &s->events[i];
+    ev->offset = offset;
+    ev->type = type;
+    ev->channel = channel;
+    ev->a = a;
+    ev->b = b;
+    ev->c = c;
+    if (s->eventCount > s->stats.eventsQueuedPeak) s->stats.eventsQueuedPeak = s->eventCount;
+    return 1;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int synthGetPendingEventCount(Synth* s) {
+    return s->eventCount;
+}
+
+// Drops pending events for one channel, or all of them when channel < 0
+EMSCRIPTEN_KEEPALIVE
+void synthClearEvents(Synth* s, int channel) {
+    int n = 0;
+    for (int i = 0; i < s->eventCount; i++) {
+        if (channel < 0 || s->events[i].channel == channel) continue;
+        s->events[n++] = s->events[i];
+    }
+    s->eventCount = n;
+}
+
+static void synthApplyEvent(Synth* s, const SynthEvent* ev) {
+    switch (ev->type) {
+        case SYNTH_EVENT_NOTE_ON: synthNoteOn(s, ev->channel, ev->a, ev->b); break;
+        case SYNTH_EVENT_NOTE_OFF: synthNoteOff(s, ev->channel, ev->a); break;
+        case SYNTH_EVENT_ALL_NOTES_OFF: synthAllNotesOff(s, ev->channel); break;
+        case SYNTH_EVENT_CONTROLLERS: synthSetControllers(s, ev->channel, ev->a, ev->b, ev->c); break;
+        default: break;
+    }
+}
+
+// Applies the voice's channel controllers before it is rendered
+static void synthApplyChannelMix(const Synth* s, Voice* v) {
+    const SynthChannel* ch = &s->channels[v->channel];
+    double volumeMul = (ch->cc7Volume / 127.0) * (ch->cc11Expression / 127.0);
+    double ccPanPos = (ch->cc10Pan - 64) / 63.0;
+    voiceSetMix(v, volumeMul, ccPanPos);
+}
+
+// A voice's effects bus gains: region send x channel send level, halved for
+// the mono sum (0 = no send)
+static void synthVoiceSends(const Synth* s, const Voice* v, float* reverb, float* chorus) {
+    const SynthChannel* ch = &s->channels[v->channel];
+    *reverb = (float)(0.5 * v->reverbSend * ch->reverbSend);
+    *chorus = (float)(0.5 * v->chorusSend * ch->chorusSend);
+}
+
+// Renders frames [start, end) of a block. With perChannel, outL is the planar
+// SYNTH_CHANNELS * 2 layout of synthRenderChannels and outR is unused. With
+// fx, sends go to its buses, which start at frame `start`.
+static void synthRenderVoices(Synth* s, Voice* voices, int count, float* outL, float* outR, SynthEffects* fx,
+                              int frames, int start, int end, int perChannel) {
+    for (int i = 0; i < count; i++) {
+        Voice* v = &voices[i];
+        if (v->finished) continue;
+        float* l = outL;
+        float* r = outR;
+        if (perChannel) {
+            l = outL + (size_t)(v->channel * 2) * frames;
+            r = l + frames;
+        }
+        synthApplyChannelMix(s, v);
+        float rs = 0.0f;
+        float cs = 0.0f;
+        if (fx) synthVoiceSends(s, v, &rs, &cs);
+        voiceRenderSends(v, l + start, r + start, rs > 0.0f ? fx->reverbBus : NULL, rs,
+                         cs > 0.0f ? fx->chorusBus : NULL, cs, end - start);
+        if (v->renderedFrames > 0 && (rs > 0.0f || cs > 0.0f)) fx->fed = 1;
+        if (v->renderedFrames > 0 && v->renderStamp != s->renderCalls) {
+            v->renderStamp = s->renderCalls;
+            s->renderedVoices++;
+        }
+    }
+}
+
+// Monotonic clock in seconds for the profiling timings (synthSetProfiling)
+static double dspNow(void) {
+#ifdef __EMSCRIPTEN__
+    return emscripten_get_now() * 0.001;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+// ---------- Threaded rendering (DSP_THREADS, native builds) ----------
+// The active voices of a range are handed out in batches from a shared cursor
+// to the pool threads and the calling thread; whoever is idle takes the next
+// batch, so uneven voices (stereo, sinc16, delays) balance out. Each voice
+// renders into its own zeroed slot buffer and the caller sums the slots in
+// voice order, so the mix is bit-identical for any thread count and however
+// the batches were scheduled.
+#ifdef DSP_THREADS
+#define SYNTH_MAX_THREADS 64
+#define SYNTH_THREAD_FRAMES 256 // slot length; longer ranges render in pieces, and as a
+                                // multiple of VOICE_CHUNK it keeps chunk boundaries put
+#define SYNTH_THREAD_BATCH 4    // voices taken from the cursor at a time
+
+typedef struct SynthPool {
+    pthread_t threads[SYNTH_MAX_THREADS];
+    int threadCount; // pool threads; the calling thread works too
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned int generation; // bumped per job
+    int busy;                // pool threads still in the current job
+    int quit;
+
+    // Current job: render slots [0, count) for `frames` frames
+    Voice* slots[SYNTH_RENDER_SLOTS];
+    int count;
+    int frames;
+    atomic_int next;
+    float* scratch; // SYNTH_RENDER_SLOTS x (L, R) x SYNTH_THREAD_FRAMES
+} SynthPool;
+
+static void synthPoolRun(SynthPool* p) {
+    for (;;) {
+        int i = atomic_fetch_add(&p->next, SYNTH_THREAD_BATCH);
+        if (i >= p->count) return;
+        int end = i + SYNTH_THREAD_BATCH < p->count ? i + SYNTH_THREAD_BATCH : p->count;
+        for (; i < end; i++) {
+            float* l = p->scratch + (size_t)i * 2 * SYNTH_THREAD_FRAMES;
+            float* r = l + SYNTH_THREAD_FRAMES;
+            memset(l, 0, (size_t)p->frames * sizeof(float));
+            memset(r, 0, (size_t)p->frames * sizeof(float));
+            voiceRenderBlock(p->slots[i], l, r, p->frames);
+        }
+    }
+}
+
+static void* synthPoolThread(void* arg) {
+    SynthPool* p = (SynthPool*)arg;
+    unsigned int seen = 0;
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        while (!p->quit && p->generation == seen) pthread_cond_wait(&p->start, &p->lock);
+        if (p->quit) break;
+        seen = p->generation;
+        pthread_mutex_unlock(&p->lock);
+        synthPoolRun(p);
+        pthread_mutex_lock(&p->lock);
+        if (--p->busy == 0) pthread_cond_signal(&p->done);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+static void synthPoolDestroy(SynthPool* p) {
+    if (!p) return;
+    pthread_mutex_lock(&p->lock);
+    p->quit = 1;
+    pthread_cond_broadcast(&p->start);
+    pthread_mutex_unlock(&p->lock);
+    for (int i = 0; i < p->threadCount; i++) pthread_join(p->threads[i], NULL);
+    pthread_cond_destroy(&p->start);
+    pthread_cond_destroy(&p->done);
+    pthread_mutex_destroy(&p->lock);
+    free(p->scratch);
+    free(p);
+}
+
+static SynthPool* synthPoolCreate(int threads) {
+    SynthPool* p = (SynthPool*)calloc(1, sizeof(SynthPool));
+    if (!p) return NULL;
+    p->scratch = (float*)malloc((size_t)SYNTH_RENDER_SLOTS * 2 * SYNTH_THREAD_FRAMES * sizeof(float));
+    if (!p->scratch) {
+        free(p);
+        return NULL;
+    }
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->start, NULL);
+    pthread_cond_init(&p->done, NULL);
+    atomic_init(&p->next, 0);
+    // Thread creation failing just leaves fewer helpers
+    for (int i = 0; i < threads - 1 && i < SYNTH_MAX_THREADS; i++) {
+        if (pthread_create(&p->threads[p->threadCount], NULL, synthPoolThread, p) != 0) break;
+        p->threadCount++;
+    }
+    return p;
+}
+
+// Renders p->slots[0, count) into their slot buffers on every thread
+static void synthPoolDispatch(SynthPool* p, int count, int frames) {
+    p->count = count;
+    p->frames = frames;
+    atomic_store(&p->next, 0);
+    if (p->threadCount == 0 || count <= SYNTH_THREAD_BATCH) {
+        synthPoolRun(p);
+        return;
+    }
+    pthread_mutex_lock(&p->lock);
+    p->busy = p->threadCount;
+    p->generation++;
+    pthread_cond_broadcast(&p->start);
+    pthread_mutex_unlock(&p->lock);
+
+    synthPoolRun(p);
+
+    pthread_mutex_lock(&p->lock);
+    while (p->busy > 0) pthread_cond_wait(&p->done, &p->lock);
+    pthread_mutex_unlock(&p->lock);
+}
+
+// bus += (l + r) * send for a voice's slot, as sendAccumulateBlock does for
+// the direct path
+static void sendAccumulateSlot(float* bus, const float* l, const float* r, float send, int n) {
+    for (int i = 0; i < n; i++) bus[i] += (l[i] + r[i]) * send;
+}
+
+static void synthRenderRangePooled(Synth* s, float* outL, float* outR, SynthEffects* fx, int frames,
+                                   int start, int end, int perChannel) {
+    SynthPool* p = s->pool;
+    for (int from = start; from < end; from += SYNTH_THREAD_FRAMES) {
+        int n = end - from < SYNTH_THREAD_FRAMES ? end - from : SYNTH_THREAD_FRAMES;
+
+        // Slots follow the serial order: the voice pool, then the fade slots
+        int count = 0;
+        for (int i = 0; i < s->maxVoices; i++) {
+            if (!s->voices[i].finished) p->slots[count++] = &s->voices[i];
+        }
+        for (int i = 0; i < SYNTH_FADE_VOICES; i++) {
+            if (!s->fading[i].finished) p->slots[count++] = &s->fading[i];
+        }
+        for (int k = 0; k < count; k++) synthApplyChannelMix(s, p->slots[k]);
+        double t = s->profiling ? dspNow() : 0.0;
+        synthPoolDispatch(p, count, n);
+        if (s->profiling) {
+            double now = dspNow();
+            s->stats.voiceSeconds += now - t;
+            t = now;
+        }
+
+        for (int k = 0; k < count; k++) {
+            Voice* v = p->slots[k];
+            if (v->renderedFrames == 0) continue;
+            const float* srcL = p->scratch + (size_t)k * 2 * SYNTH_THREAD_FRAMES;
+            const float* srcR = srcL + SYNTH_THREAD_FRAMES;
+            float* l = outL;
+            float* r = outR;
+            if (perChannel) {
+                l = outL + (size_t)(v->channel * 2) * frames;
+                r = l + frames;
+            }
+            l += from;
+            r += from;
+            for (int i = 0; i < n; i++) {
+                l[i] += srcL[i];
+                r[i] += srcR[i];
+            }
+            if (fx) {
+                float rs, cs;
+                synthVoiceSends(s, v, &rs, &cs);
+                if (rs > 0.0f) sendAccumulateSlot(fx->reverbBus + (from - start), srcL, srcR, rs, n);
+                if (cs > 0.0f) sendAccumulateSlot(fx->chorusBus + (from - start), srcL, srcR, cs, n);
+                if (rs > 0.0f || cs > 0.0f) fx->fed = 1;
+            }
+            if (v->renderStamp != s->renderCalls) {
+                v->renderStamp = s->renderCalls;
+                s->renderedVoices++;
+            }
+        }
+        if (s->profiling) s->stats.mixSeconds += dspNow() - t;
+    }
+}
+#endif
+
+// Render threads for this synth, calling thread included; 0 (the default)
+// renders on the calling thread straight into the output without slot
+// buffers. Returns the thread count in use, which is 0 in builds without
+// DSP_THREADS or when the pool cannot be allocated.
+EMSCRIPTEN_KEEPALIVE
+int synthSetThreadCount(Synth* s, int threads) {
+#ifdef DSP_THREADS
+    synthPoolDestroy(s->pool);
+    s->pool = NULL;
+    if (threads <= 0) return 0;
+    if (threads > SYNTH_MAX_THREADS) threads = SYNTH_MAX_THREADS;
+    s->pool = synthPoolCreate(threads);
+    return s->pool ? s->pool->threadCount + 1 : 0;
+#else
+    (void)s;
+    (void)threads;
+    return 0;
+#endif
+}
+
+static void synthRenderPiece(Synth* s, float* outL, float* outR, SynthEffects* fx, int frames,
+                             int start, int end, int perChannel) {
+#ifdef DSP_THREADS
+    if (s->pool) {
+        synthRenderRangePooled(s, outL, outR, fx, frames, start, end, perChannel);
+        return;
+    }
+#endif
+    double t = s->profiling ? dspNow() : 0.0;
+    synthRenderVoices(s, s->voices, s->maxVoices, outL, outR, fx, frames, start, end, perChannel);
+    synthRenderVoices(s, s->fading, SYNTH_FADE_VOICES, outL, outR, fx, frames, start, end, perChannel);
+    if (s->profiling) s->stats.voiceSeconds += dspNow() - t;
+}
+
+// Renders frames [start, end) in pieces of up to SYNTH_FX_FRAMES, each
+// followed by the effects, whose return is added to fxL/fxR (NULL = dry)
+static void synthRenderRange(Synth* s, float* outL, float* outR, float* fxL, float* fxR, int frames,
+                             int start, int end, int perChannel) {
+    SynthEffects* fx = fxL ? &s->fx : NULL;
+    for (int from = start; from < end; from += SYNTH_FX_FRAMES) {
+        int to = end - from < SYNTH_FX_FRAMES ? end : from + SYNTH_FX_FRAMES;
+        synthRenderPiece(s, outL, outR, fx, frames, from, to, perChannel);
+        if (!fx) continue;
+        double t = s->profiling ? dspNow() : 0.0;
+        effectsProcess(fx, fxL + from, fxR + from, to - from);
+        if (s->profiling) s->stats.effectSeconds += dspNow() - t;
+    }
+}
+
+// Clears the outputs and renders the block, split at every queued event
+// offset inside it
+static void synthRenderScheduled(Synth* s, float* outL, float* outR, float* fxL, float* fxR, int frames,
+                                 int perChannel) {
+    double start = s->profiling ? dspNow() : 0.0;
+    if (perChannel) {
+        for (int i = 0; i < SYNTH_CHANNELS * 2 * frames; i++) outL[i] = 0.0f;
+        if (fxL) {
+            for (int i = 0; i < frames; i++) {
+                fxL[i] = 0.0f;
+                fxR[i] = 0.0f;
+            }
+        }
+    } else {
+        for (int i = 0; i < frames; i++) {
+            outL[i] = 0.0f;
+            outR[i] = 0.0f;
+        }
+    }
+    if (s->profiling) s->stats.mixSeconds += dspNow() - start;
+
+    s->renderCalls++;
+    s->renderedVoices = 0;
+    int pos = 0;
+    int e = 0;
+    for (; e < s->eventCount && s->events[e].offset < frames; e++) {
+        const SynthEvent* ev = &s->events[e];
+        if (ev->offset > pos) {
+            synthRenderRange(s, outL, outR, fxL, fxR, frames, pos, ev->offset, perChannel);
+            pos = ev->offset;
+        }
+        double t = s->profiling ? dspNow() : 0.0;
+        synthApplyEvent(s, ev);
+        if (s->profiling) s->stats.eventSeconds += dspNow() - t;
+    }
+    if (pos < frames) synthRenderRange(s, outL, outR, fxL, fxR, frames, pos, frames, perChannel);
+
+    // Later events move down and become relative to the next block
+    int left = s->eventCount - e;
+    for (int i = 0; i < left; i++) {
+        s->events[i] = s->events[e + i];
+        s->events[i].offset -= frames;
+    }
+    s->eventCount = left;
+
+    SynthStats* st = &s->stats;
+    st->blocks++;
+    st->frames += frames;
+    st->voicesSum += s->renderedVoices;
+    if (s->renderedVoices > st->voicesPeak) st->voicesPeak = s->renderedVoices;
+    if (s->profiling && frames > 0) {
+        double elapsed = dspNow() - start;
+        double load = elapsed * s->sr / frames;
+        st->renderSeconds += elapsed;
+        if (load > st->loadPeak) st->loadPeak = load;
+    }
+}
+
+// Renders and mixes all active voices of every channel, plus the reverb and
+// chorus return, into outL/outR (overwritten)
+EMSCRIPTEN_KEEPALIVE
+void synthRender(Synth* s, float* outL, float* outR, int frames) {
+    synthRenderScheduled(s, outL, outR, outL, outR, frames, 0);
+}
+
+// Renders each channel to its own stereo pair for per-channel routing.
+// out holds SYNTH_CHANNELS * 2 planar blocks: channel c is [L at 2c][R at 2c+1],
+// each `frames` long (overwritten). The effects are left out (sends are
+// ignored); see synthRenderChannelsWithReturn.
+EMSCRIPTEN_KEEPALIVE
+void synthRenderChannels(Synth* s, float* out, int frames) {
+    synthRenderScheduled(s, out, NULL, NULL, NULL, frames, 1);
+}
+
+// synthRenderChannels plus the shared reverb and chorus return in its own
+// stereo pair, fxReturn = [L frames][R frames] (overwritten), since it
+// belongs to no single channel
+EMSCRIPTEN_KEEPALIVE
+void synthRenderChannelsWithReturn(Synth* s, float* out, float* fxReturn, int frames) {
+    synthRenderScheduled(s, out, NULL, fxReturn, fxReturn ? fxReturn + frames : NULL, frames, 1);
+}
+
+// ---------- Profiling ----------
+// Counters run all the time (a few adds per block); the stage timings only
+// after synthSetProfiling(s, 1), since the clock costs a host call per stage
+// in WASM (dspNow). The struct is read in place: sf2-processor.js views it
+// as doubles.
+EMSCRIPTEN_KEEPALIVE
+SynthStats* synthGetStats(Synth* s) {
+    return &s->stats;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void synthResetStats(Synth* s) {
+    memset(&s->stats, 0, sizeof s->stats);
+}
+
+EMSCRIPTEN_KEEPALIVE
+void synthSetProfiling(Synth* s, int on) {
+    s->profiling = on != 0;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int synthGetChannelCount(void) {
+    return SYNTH_CHANNELS;
+}
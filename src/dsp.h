@@ -0,0 +1,177 @@
+// dsp.h
+//
+// C API of the DSP engine in dsp.c for native hosts (headless rendering, the
+// benchmark, the native tests). The same functions are exported from the
+// WASM module, where the JS side calls them through cwrap with heap pointers.
+// Synth and Region are opaque; everything is set through the calls below.
+#ifndef GBK_DSP_H
+#define GBK_DSP_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct Synth Synth;
+typedef struct Region Region;
+
+// Interpolation quality (synthSetInterpolation)
+#define INTERP_LINEAR 0
+#define INTERP_HERMITE 1
+#define INTERP_SINC8 2
+#define INTERP_SINC16 3
+
+#define SYNTH_CHANNELS 16
+
+// Timestamped event for sample-accurate scheduling (see synthScheduleEvent)
+enum {
+    SYNTH_EVENT_NOTE_ON = 0,     // a = note, b = velocity
+    SYNTH_EVENT_NOTE_OFF = 1,    // a = note
+    SYNTH_EVENT_ALL_NOTES_OFF = 2,
+    SYNTH_EVENT_CONTROLLERS = 3, // a = cc7, b = cc10, c = cc11
+};
+
+// Packed region table columns (sf2-parser.js REGION_INT_COLUMNS /
+// REGION_FLOAT_COLUMNS): column c of region i is at [c * count + i]
+enum {
+    REGION_COL_KEY_LO = 0,
+    REGION_COL_KEY_HI = 1,
+    REGION_COL_VEL_LO = 2,
+    REGION_COL_VEL_HI = 3,
+    REGION_COL_OFFSET_L = 4,
+    REGION_COL_LENGTH = 5,
+    REGION_COL_OFFSET_R = 6,
+    REGION_COL_LENGTH_R = 7,
+    REGION_COL_LOOP_START = 8,
+    REGION_COL_LOOP_END = 9,
+    REGION_COL_SAMPLE_MODES = 10,
+    REGION_COL_ROOT_KEY = 11,
+    REGION_COL_EXCLUSIVE_CLASS = 12,
+    REGION_INT_COLUMNS = 13,
+};
+
+enum {
+    REGION_FCOL_GAIN_L = 0,
+    REGION_FCOL_GAIN_R = 1,
+    REGION_FCOL_SAMPLE_RATE = 2,
+    REGION_FCOL_SCALE_TUNING = 3,
+    REGION_FCOL_COARSE_TUNE = 4,
+    REGION_FCOL_FINE_TUNE = 5,
+    REGION_FCOL_ATTENUATION = 6,
+    REGION_FCOL_PAN = 7,
+    REGION_FCOL_VOL_ENV = 8,  // 6 columns: delay, attack, hold, decay, sustain, release
+    REGION_FCOL_MOD_ENV = 14, // 6 columns, as above
+    REGION_FCOL_FILTER_FC = 20,
+    REGION_FCOL_MOD_ENV_TO_FC = 21,
+    REGION_FCOL_MOD_LFO_TO_FC = 22,
+    REGION_FCOL_MOD_LFO_DELAY = 23,
+    REGION_FCOL_MOD_LFO_FREQ = 24,
+    REGION_FCOL_MOD_LFO_TO_PITCH = 25,
+    REGION_FCOL_VIB_LFO_DELAY = 26,
+    REGION_FCOL_VIB_LFO_FREQ = 27,
+    REGION_FCOL_VIB_LFO_TO_PITCH = 28,
+    REGION_FCOL_CHORUS_SEND = 29, // 0.1% units, as in the SF2 generators
+    REGION_FCOL_REVERB_SEND = 30,
+    REGION_FLOAT_COLUMNS = 31,
+};
+
+// Engine counters since the last synthResetStats (synthGetStats). Every field
+// is a double so JS can read the struct as a Float64Array; keep the order in
+// step with SYNTH_STATS_FIELDS in sf2-processor.js. Timings are in seconds and
+// stay 0 unless synthSetProfiling is on.
+typedef struct SynthStats {
+    double blocks;           // synthRender / synthRenderChannels calls
+    double frames;           // frames rendered
+    double voicesPeak;       // most voices rendered in one block (fade slots included)
+    double voicesSum;        // voices rendered, summed over blocks (/ blocks = average)
+    double voicesStolen;     // notes that took a sounding voice's slot
+    double voicesCut;        // stolen voices cut without a fade (every fade slot busy)
+    double eventsQueuedPeak; // deepest the event queue got
+    double eventsRejected;   // synthScheduleEvent calls refused by a full queue
+    double renderSeconds;    // whole render calls
+    double eventSeconds;     // applying queued events (region lookup, voice allocation)
+    double voiceSeconds;     // voice kernels (and the direct path's mix)
+    double mixSeconds;       // clearing the output and summing thread slots
+    double loadPeak;         // worst block: render time / block duration
+    double effectSeconds;    // reverb and chorus
+} SynthStats;
+
+// Unit conversions
+double timecentsToSeconds(double tc);
+double centsToRatio(double c);
+double cbAttenToLin(double cb);
+double velToLin(double vel, double curve);
+double fcCentsToHz(double fcCents);
+
+void* dspMalloc(int bytes);
+void dspFree(void* ptr);
+
+// Lifetime and engine settings
+Synth* synthCreate(double sr);
+void synthDestroy(Synth* s);
+void synthSetMaxVoices(Synth* s, int maxVoices);
+void synthSetControlInterval(Synth* s, int frames);
+void synthSetInterpolation(Synth* s, int quality);
+
+// The SF2 smpl chunk; the synth keeps the pointer, so it must outlive it
+void synthSetSampleBank(Synth* s, const int16_t* smpl, int length);
+
+// Region tables: one packed table per program change, or one region at a time
+int synthLoadRegions(Synth* s, int channel, const int32_t* ints, const float* floats, int count);
+int synthSetRegionCount(Synth* s, int channel, int count);
+Region* synthGetRegion(Synth* s, int channel, int index);
+int synthBuildRegionIndex(Synth* s, int channel);
+void regionSetRanges(Region* r, int keyLo, int keyHi, int velLo, int velHi);
+void regionSetSample(Region* r, int offsetL, int length, double gainL,
+                     int offsetR, int lengthR, double gainR,
+                     double loopStart, double loopEnd, int sampleModes, double sampleRate);
+void regionSetTuning(Region* r, int rootKey, double scaleTuning, double coarseTune, double fineTune);
+void regionSetAmp(Region* r, double attenuationCb, double pan, int exclusiveClass);
+void regionSetVolEnv(Region* r, double delayTc, double attackTc, double holdTc,
+                     double decayTc, double sustainCb, double releaseTc);
+void regionSetModEnv(Region* r, double delayTc, double attackTc, double holdTc,
+                     double decayTc, double sustain, double releaseTc);
+void regionSetFilter(Region* r, double initialFcCents, double modEnvToFcCents, double modLfoToFcCents);
+void regionSetModLfo(Region* r, double delayTc, double freqCents, double toPitchCents);
+void regionSetVibLfo(Region* r, double delayTc, double freqCents, double toPitchCents);
+void regionSetEffects(Region* r, double chorusSend, double reverbSend);
+
+// Immediate events
+int synthNoteOn(Synth* s, int channel, int note, int velocity);
+void synthNoteOff(Synth* s, int channel, int note);
+void synthAllNotesOff(Synth* s, int channel);
+void synthAllSoundOff(Synth* s);
+void synthSetControllers(Synth* s, int channel, int cc7Volume, int cc10Pan, int cc11Expression);
+void synthSetChannelSends(Synth* s, int channel, double reverb, double chorus);
+
+// Events applied `offset` frames into the next render call
+int synthScheduleEvent(Synth* s, int offset, int type, int channel, int a, int b, int c);
+int synthGetPendingEventCount(Synth* s);
+void synthClearEvents(Synth* s, int channel);
+
+// Rendering (outputs are overwritten). synthRender mixes the reverb and
+// chorus return into its output; synthRenderChannels is dry, and
+// synthRenderChannelsWithReturn writes the return as [L frames][R frames]
+void synthRender(Synth* s, float* outL, float* outR, int frames);
+void synthRenderChannels(Synth* s, float* out, int frames);
+void synthRenderChannelsWithReturn(Synth* s, float* out, float* fxReturn, int frames);
+
+// Render threads in DSP_THREADS builds (0 = off); output does not depend on
+// the count
+int synthSetThreadCount(Synth* s, int threads);
+
+// Profiling (see SynthStats)
+SynthStats* synthGetStats(Synth* s);
+void synthResetStats(Synth* s);
+void synthSetProfiling(Synth* s, int on);
+
+int synthGetActiveVoiceCount(Synth* s);
+int synthGetRenderedVoiceCount(Synth* s);
+int synthGetChannelCount(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
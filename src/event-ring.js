@@ -0,0 +1,80 @@
+// event-ring.js
+//
+// Lock-free single-producer/single-consumer event ring over a
+// SharedArrayBuffer: midi-timer.worker.js writes note events, sf2-processor.js
+// drains them at the start of each process() call. No objects are created per
+// event on either side, so timing does not depend on GC or message delivery.
+//
+// Layout (Int32): header [write, read, overflows, capacity] followed by
+// `capacity` records of 4 words:
+//   frameLo, frameHi     absolute audio frame (frameHi = -1: apply now)
+//   type | channel << 8  type is an EVENT_RING_* code
+//   a | b << 8 | c << 16 noteOn: note, velocity; noteOff: note;
+//                        controllers: cc7, cc10, cc11
+// write/read are free-running counters; capacity is a power of two.
+// sf2-processor.js keeps its own copy of the reader and these constants
+// (it is loaded as a standalone worklet module), so keep them in sync.
+
+export const EVENT_RING_NOTE_ON = 0;
+export const EVENT_RING_NOTE_OFF = 1;
+export const EVENT_RING_ALL_NOTES_OFF = 2;
+export const EVENT_RING_CONTROLLERS = 3;
+
+const HEADER_WORDS = 4;
+const RECORD_WORDS = 4;
+const WRITE = 0;
+const READ = 1;
+const OVERFLOWS = 2;
+const CAPACITY = 3;
+
+export const EVENT_RING_DEFAULT_CAPACITY = 4096;
+
+export function isEventRingSupported() {
+  return typeof SharedArrayBuffer === "function" && globalThis.crossOriginIsolated === true;
+}
+
+// Returns a SharedArrayBuffer ring or null when cross-origin isolation is
+// unavailable (callers then keep using postMessage)
+export function createEventRing(capacity = EVENT_RING_DEFAULT_CAPACITY) {
+  if (!isEventRingSupported()) return null;
+  let cap = 1;
+  while (cap < capacity) cap <<= 1;
+  const sab = new SharedArrayBuffer((HEADER_WORDS + cap * RECORD_WORDS) * 4);
+  new Int32Array(sab)[CAPACITY] = cap;
+  return sab;
+}
+
+export class EventRingWriter {
+  constructor(sab) {
+    this.words = new Int32Array(sab);
+    this.mask = this.words[CAPACITY] - 1;
+  }
+
+  // Returns false (and counts an overflow) when the consumer is a full ring behind
+  push(frame, type, channel, a = 0, b = 0, c = 0) {
+    const words = this.words;
+    const write = Atomics.load(words, WRITE);
+    const read = Atomics.load(words, READ);
+    if (((write - read) | 0) > this.mask) {
+      Atomics.add(words, OVERFLOWS, 1);
+      return false;
+    }
+    const base = HEADER_WORDS + (write & this.mask) * RECORD_WORDS;
+    if (frame == null) {
+      words[base] = 0;
+      words[base + 1] = -1;
+    } else {
+      words[base] = frame | 0;
+      words[base + 1] = Math.floor(frame / 4294967296);
+    }
+    words[base + 2] = (type & 0xff) | ((channel & 0xff) << 8);
+    words[base + 3] = (a & 0xff) | ((b & 0xff) << 8) | ((c & 0xff) << 16);
+    // Publishes the record; the store orders it after the plain writes above
+    Atomics.store(words, WRITE, (write + 1) | 0);
+    return true;
+  }
+
+  get overflows() {
+    return Atomics.load(this.words, OVERFLOWS);
+  }
+}
@@ -0,0 +1,298 @@
+// midi-stream.js
+//
+// Playback events of a Standard MIDI File, decoded on demand straight from
+// the raw track bytes instead of materialised as one object per event. Every
+// track has a small decoder (byte position, tick, running status, bank
+// select state and its next playable event) and the stream merges them by
+// tick into a fixed-size window of typed arrays, refilled a chunk at a time,
+// so memory follows the chunk size rather than the song length.
+//
+// buildIndex() decodes the song once and snapshots every decoder each
+// CHECKPOINT_EVENTS events; seek() turns the time into a tick through the
+// tempo map, binary-searches those checkpoints by tick and decodes forward
+// from the nearest one. Without an index, seek() decodes from the start.
+import { segmentTickToSec, secToTick, tempoSegmentAt } from "./tempo-map.js";
+
+export const STREAM_NOTE_ON = 0;    // data1 = note, data2 = velocity
+export const STREAM_NOTE_OFF = 1;   // data1 = note
+export const STREAM_PROGRAM = 2;    // data1 = program, data2 = bank (MSB << 7 | LSB)
+
+const STREAM_CHUNK_EVENTS = 1024;
+const CHECKPOINT_EVENTS = 2048;
+const STATE_WORDS = 6; // per track: pos, tick, status, pending type, data1, data2
+const BANK_BYTES = 32; // per track: bank MSB then LSB for 16 channels
+const SEEK_TICK_EPSILON = 1e-6; // secToTick rounding at an event's exact time
+
+// Byte ranges of the MTrk payloads in `bytes`, as [start0, end0, start1, ...]
+export function findTrackRanges(bytes, trackCount, firstTrackPos) {
+  const ranges = new Uint32Array(trackCount * 2);
+  let pos = firstTrackPos;
+  for (let i = 0; i < trackCount; i += 1) {
+    const len = ((bytes[pos + 4] << 24) | (bytes[pos + 5] << 16) | (bytes[pos + 6] << 8) | bytes[pos + 7]) >>> 0;
+    const start = pos + 8;
+    ranges[i * 2] = start;
+    ranges[i * 2 + 1] = Math.min(bytes.length, start + len);
+    pos = start + len;
+  }
+  return ranges;
+}
+
+export class MidiEventStream {
+  // source: { bytes, trackRanges, tempoMap } (song.eventSource from
+  // parseMidiBuffer); tempoMap comes from tempo-map.js buildTempoMap
+  constructor(source, chunkEvents = STREAM_CHUNK_EVENTS) {
+    this.bytes = source.bytes;
+    this.ranges = source.trackRanges;
+    this.tempoMap = source.tempoMap;
+    this.trackCount = this.ranges.length / 2;
+
+    // Decoded window: slots [index, count) are still to be read
+    this.sec = new Float64Array(chunkEvents);
+    this.tick = new Uint32Array(chunkEvents);
+    this.track = new Uint16Array(chunkEvents);
+    this.type = new Uint8Array(chunkEvents);
+    this.channel = new Uint8Array(chunkEvents);
+    this.data1 = new Uint8Array(chunkEvents);
+    this.data2 = new Uint16Array(chunkEvents);
+    this.index = 0;
+    this.count = 0;
+
+    this.state = new Float64Array(this.trackCount * STATE_WORDS);
+    this.banks = new Uint8Array(this.trackCount * BANK_BYTES);
+    this.tempoIndex = 0; // tempo segment of the last merged tick
+    this.emitted = 0;    // events merged since the start of the song
+
+    this.checkpoints = [];
+    this.checkpointTicks = null;
+    this.recording = false;
+    this.rewind();
+  }
+
+  // Back to the first event of the song
+  rewind() {
+    this.banks.fill(0);
+    for (let t = 0; t < this.trackCount; t += 1) {
+      const s = t * STATE_WORDS;
+      this.state[s] = this.ranges[t * 2];
+      this.state[s + 1] = 0;
+      this.state[s + 2] = 0;
+      this.decodeNext(t);
+    }
+    this.tempoIndex = 0;
+    this.emitted = 0;
+    this.index = 0;
+    this.count = 0;
+  }
+
+  // Slot of the next event, decoding another chunk when the window is empty;
+  // -1 at the end of the song
+  peek() {
+    if (this.index >= this.count && !this.fill()) return -1;
+    return this.index;
+  }
+
+  advance() {
+    this.index += 1;
+  }
+
+  // Positions the stream on the first event at or after `sec`
+  seek(sec) {
+    this.seekTick(secToTick(this.tempoMap, sec) - SEEK_TICK_EPSILON);
+  }
+
+  // Positions the stream on the first event at or after `tick`
+  seekTick(tick) {
+    const ticks = this.checkpointTicks;
+    let k = -1;
+    if (ticks) {
+      let lo = 0;
+      let hi = ticks.length - 1;
+      while (lo <= hi) {
+        const mid = (lo + hi) >> 1;
+        if (ticks[mid] < tick) {
+          k = mid;
+          lo = mid + 1;
+        } else {
+          hi = mid - 1;
+        }
+      }
+    }
+    if (k >= 0) this.restore(this.checkpoints[k]);
+    else this.rewind();
+    for (;;) {
+      const slot = this.peek();
+      if (slot < 0 || this.tick[slot] >= tick) return;
+      this.advance();
+    }
+  }
+
+  // Decodes the whole song once, calling onEvent(slot) for every event, and
+  // records the seek checkpoints; leaves the stream rewound
+  buildIndex(onEvent) {
+    this.rewind();
+    this.checkpoints = [];
+    this.recording = true;
+    for (let slot = this.peek(); slot >= 0; slot = this.peek()) {
+      onEvent?.(slot);
+      this.advance();
+    }
+    this.recording = false;
+    this.checkpointTicks = Float64Array.from(this.checkpoints, (c) => c.tick);
+    this.rewind();
+  }
+
+  // Merged ticks never go back, so the current tempo segment usually still
+  // holds; otherwise it is looked up again
+  tickToSec(tick) {
+    const { ticks } = this.tempoMap;
+    let i = this.tempoIndex;
+    if (ticks[i] > tick || (i + 1 < ticks.length && ticks[i + 1] <= tick)) {
+      i = tempoSegmentAt(this.tempoMap, tick);
+      this.tempoIndex = i;
+    }
+    return segmentTickToSec(this.tempoMap, i, tick);
+  }
+
+  fill() {
+    const st = this.state;
+    let n = 0;
+    while (n < this.sec.length) {
+      // Track with the earliest pending event; ties go to the lower track
+      let best = -1;
+      let bestTick = Infinity;
+      for (let t = 0; t < this.trackCount; t += 1) {
+        const s = t * STATE_WORDS;
+        if (st[s + 3] >= 0 && st[s + 1] < bestTick) {
+          best = t;
+          bestTick = st[s + 1];
+        }
+      }
+      if (best < 0) break;
+      const sec = this.tickToSec(bestTick);
+      if (this.recording && this.emitted % CHECKPOINT_EVENTS === 0) this.checkpoints.push(this.snapshot(bestTick));
+      const s = best * STATE_WORDS;
+      this.sec[n] = sec;
+      this.tick[n] = bestTick;
+      this.track[n] = best;
+      this.type[n] = st[s + 3];
+      this.channel[n] = st[s + 2] & 0x0f;
+      this.data1[n] = st[s + 4];
+      this.data2[n] = st[s + 5];
+      n += 1;
+      this.emitted += 1;
+      this.decodeNext(best);
+    }
+    this.index = 0;
+    this.count = n;
+    return n > 0;
+  }
+
+  // Reads track t up to its next note or program event (pending type -1 at
+  // the end of the track). Bank select controllers are folded into the
+  // decoder so a program change carries the bank it selects.
+  decodeNext(t) {
+    const u8 = this.bytes;
+    const st = this.state;
+    const s = t * STATE_WORDS;
+    const end = this.ranges[t * 2 + 1];
+    const banks = t * BANK_BYTES;
+    let pos = st[s];
+    let tick = st[s + 1];
+    let runningStatus = st[s + 2];
+    let type = -1;
+    let data1 = 0;
+    let data2 = 0;
+
+    while (pos < end) {
+      let delta = 0;
+      for (let i = 0; i < 4; i += 1) {
+        const b = pos < end ? u8[pos] : 0;
+        pos += 1;
+        delta = (delta << 7) | (b & 0x7f);
+        if ((b & 0x80) === 0) break;
+      }
+      tick += delta >>> 0;
+      if (pos >= end) break;
+
+      let status = u8[pos++];
+      if (status < 0x80) {
+        pos -= 1;
+        status = runningStatus;
+      } else {
+        runningStatus = status;
+      }
+
+      if (status === 0xff || status === 0xf0 || status === 0xf7) {
+        const metaType = status === 0xff ? (pos < end ? u8[pos] : 0) : -1;
+        if (status === 0xff) pos += 1;
+        let len = 0;
+        for (let i = 0; i < 4; i += 1) {
+          const b = pos < end ? u8[pos] : 0;
+          pos += 1;
+          len = (len << 7) | (b & 0x7f);
+          if ((b & 0x80) === 0) break;
+        }
+        pos += len >>> 0;
+        if (metaType === 0x2f) pos = end;
+        continue;
+      }
+
+      const cmd = status & 0xf0;
+      const channel = status & 0x0f;
+      const d1 = pos < end ? u8[pos] & 0x7f : 0;
+      pos += 1;
+      let d2 = 0;
+      if (cmd !== 0xc0 && cmd !== 0xd0) {
+        d2 = pos < end ? u8[pos] & 0x7f : 0;
+        pos += 1;
+      }
+
+      if (cmd === 0x90 && d2 > 0) {
+        type = STREAM_NOTE_ON;
+        data1 = d1;
+        data2 = d2;
+        break;
+      }
+      if (cmd === 0x80 || cmd === 0x90) {
+        type = STREAM_NOTE_OFF;
+        data1 = d1;
+        break;
+      }
+      if (cmd === 0xc0) {
+        type = STREAM_PROGRAM;
+        data1 = d1;
+        data2 = (this.banks[banks + channel] << 7) | this.banks[banks + 16 + channel];
+        break;
+      }
+      if (cmd === 0xb0 && d1 === 0) this.banks[banks + channel] = d2;
+      if (cmd === 0xb0 && d1 === 32) this.banks[banks + 16 + channel] = d2;
+    }
+
+    st[s] = pos;
+    st[s + 1] = tick;
+    // The pending event's channel rides in the status word's low nibble
+    st[s + 2] = type >= 0 ? runningStatus : 0;
+    st[s + 3] = type;
+    st[s + 4] = data1;
+    st[s + 5] = data2;
+  }
+
+  snapshot(tick) {
+    return {
+      tick,
+      state: this.state.slice(),
+      banks: this.banks.slice(),
+      tempoIndex: this.tempoIndex,
+      emitted: this.emitted,
+    };
+  }
+
+  restore(checkpoint) {
+    this.state.set(checkpoint.state);
+    this.banks.set(checkpoint.banks);
+    this.tempoIndex = checkpoint.tempoIndex;
+    this.emitted = checkpoint.emitted;
+    this.index = 0;
+    this.count = 0;
+  }
+}
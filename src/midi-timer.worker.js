@@ -1,3 +1,19 @@
+import {
+  EventRingWriter,
+  EVENT_RING_NOTE_ON,
+  EVENT_RING_NOTE_OFF,
+  EVENT_RING_ALL_NOTES_OFF,
+  EVENT_RING_CONTROLLERS,
+} from "./event-ring.js";
+import {
+  MidiEventStream,
+  STREAM_NOTE_ON,
+  STREAM_NOTE_OFF,
+  STREAM_PROGRAM,
+  findTrackRanges,
+} from "./midi-stream.js";
+import { buildTempoMap, tickToSec } from "./tempo-map.js";
+
 function readVarLen(u8, posRef) {
   let v = 0;
   for (let i = 0; i < 4; i += 1) {
@@ -20,6 +36,8 @@ function ascii(u8, start, len) {
   return new TextDecoder("ascii").decode(u8.subarray(start, start + len));
 }
 
+// Track names, meta text, tempo and time signature changes and the last
+// event tick; note and program events are decoded later by MidiEventStream
 function parseTrackBytes(trackU8) {
   const events = [];
   let trackName = "";
@@ -33,6 +51,7 @@ function parseTrackBytes(trackU8) {
   };
   const posRef = { pos: 0 };
   let tick = 0;
+  let maxTick = 0;
   let runningStatus = 0;
   let seq = 0;
 
@@ -67,11 +86,13 @@ function parseTrackBytes(trackU8) {
         const microPerQuarter =
           (trackU8[dataStart] << 16) | (trackU8[dataStart + 1] << 8) | trackU8[dataStart + 2];
         events.push({ seq: seq++, tick, type: "tempo", microPerQuarter });
+        maxTick = tick;
       }
       if (metaType === 0x58 && len >= 2) {
         const numerator = trackU8[dataStart] || 4;
         const denominator = 2 ** (trackU8[dataStart + 1] || 2);
         events.push({ seq: seq++, tick, type: "timeSig", numerator, denominator });
+        maxTick = tick;
       }
       continue;
     }
@@ -83,59 +104,17 @@ function parseTrackBytes(trackU8) {
     }
 
     const cmd = status & 0xf0;
-    const channel = status & 0x0f;
-    const d1 = trackU8[posRef.pos++] ?? 0;
-    let d2 = 0;
-    if (cmd !== 0xc0 && cmd !== 0xd0) d2 = trackU8[posRef.pos++] ?? 0;
-
-    if (cmd === 0x90 && d2 > 0) {
-      events.push({ seq: seq++, tick, type: "noteOn", note: d1 & 0x7f, velocity: d2 & 0x7f, channel });
-    } else if (cmd === 0x80 || (cmd === 0x90 && d2 === 0)) {
-      events.push({ seq: seq++, tick, type: "noteOff", note: d1 & 0x7f, channel });
-    } else if (cmd === 0xb0) {
-      events.push({ seq: seq++, tick, type: "cc", cc: d1 & 0x7f, value: d2 & 0x7f, channel });
-    } else if (cmd === 0xc0) {
-      events.push({ seq: seq++, tick, type: "program", program: d1 & 0x7f, channel });
-    }
-  }
-
-  return { trackName, instrumentName, events, meta };
-}
-
-function buildTempoMap(allEvents, division) {
-  const tempos = allEvents
-    .filter((e) => e.type === "tempo")
-    .map((e) => ({ tick: e.tick, microPerQuarter: e.microPerQuarter }))
-    .sort((a, b) => a.tick - b.tick);
-  if (!tempos.length || tempos[0].tick !== 0) tempos.unshift({ tick: 0, microPerQuarter: 500000 });
-  const compact = [];
-  for (const t of tempos) {
-    if (compact.length && compact[compact.length - 1].tick === t.tick) compact[compact.length - 1] = t;
-    else compact.push(t);
-  }
-  const segments = [];
-  let startSec = 0;
-  for (let i = 0; i < compact.length; i += 1) {
-    const cur = compact[i];
-    const next = compact[i + 1];
-    segments.push({ tick: cur.tick, startSec, microPerQuarter: cur.microPerQuarter });
-    if (next) {
-      const dticks = next.tick - cur.tick;
-      startSec += (dticks * cur.microPerQuarter) / 1000000 / division;
-    }
+    posRef.pos += cmd === 0xc0 || cmd === 0xd0 ? 1 : 2;
+    // Notes, controllers and program changes count towards the song length
+    if (cmd === 0x80 || cmd === 0x90 || cmd === 0xb0 || cmd === 0xc0) maxTick = tick;
   }
-  return segments;
-}
 
-function tickToSec(segments, division, tick) {
-  let seg = segments[0];
-  for (let i = 1; i < segments.length; i += 1) {
-    if (segments[i].tick > tick) break;
-    seg = segments[i];
-  }
-  return seg.startSec + ((tick - seg.tick) * seg.microPerQuarter) / 1000000 / division;
+  return { trackName, instrumentName, events, meta, maxTick };
 }
 
+// Returns { song, stream }: the song summary posted to the page (its
+// eventSource lets other threads build their own MidiEventStream) and the
+// indexed stream this worker plays from
 function parseMidiBuffer(buffer) {
   const u8 = new Uint8Array(buffer);
   if (ascii(u8, 0, 4) !== "MThd") throw new Error("Invalid MIDI header");
@@ -158,71 +137,53 @@ function parseMidiBuffer(buffer) {
   }
 
   const allEvents = parsedTracks.flatMap((t) => t.events);
-  const tempoMap = buildTempoMap(allEvents, division);
-  let maxTick = 0;
-
-  const tracks = parsedTracks.map((track, idx) => {
-    const notes = [];
-    const playEvents = [];
-    const active = new Map();
-    const bankMsb = new Uint8Array(16);
-    const bankLsb = new Uint8Array(16);
-    const sorted = [...track.events].sort((a, b) => (a.tick - b.tick) || (a.seq - b.seq));
-
-    for (const e of sorted) {
-      const sec = tickToSec(tempoMap, division, e.tick);
-      maxTick = Math.max(maxTick, e.tick);
-      if (e.type === "cc") {
-        if (e.cc === 0) bankMsb[e.channel] = e.value;
-        if (e.cc === 32) bankLsb[e.channel] = e.value;
-        continue;
-      }
-      if (e.type === "program") {
-        const bank = ((bankMsb[e.channel] & 0x7f) << 7) | (bankLsb[e.channel] & 0x7f);
-        playEvents.push({ sec, type: "program", channel: e.channel, program: e.program, bank, seq: e.seq });
-        continue;
-      }
-      if (e.type === "noteOn") {
-        const key = `${e.channel}:${e.note}`;
-        const stack = active.get(key) ?? [];
-        stack.push({ startSec: sec, velocity: e.velocity, note: e.note, channel: e.channel });
-        active.set(key, stack);
-        playEvents.push({
-          sec,
-          type: "noteOn",
-          channel: e.channel,
-          note: e.note,
-          velocity: e.velocity,
-          seq: e.seq,
-        });
-        continue;
-      }
-      if (e.type === "noteOff") {
-        const key = `${e.channel}:${e.note}`;
-        const stack = active.get(key);
-        const start = stack?.pop();
-        if (start) {
-          notes.push({
-            note: e.note,
-            velocity: start.velocity,
-            channel: e.channel,
-            startSec: start.startSec,
-            durationSec: Math.max(0.01, sec - start.startSec),
-          });
-        }
-        playEvents.push({ sec, type: "noteOff", channel: e.channel, note: e.note, seq: e.seq });
-      }
+  const tempoMap = buildTempoMap(allEvents.filter((e) => e.type === "tempo"), division);
+  const maxTick = parsedTracks.reduce((max, t) => Math.max(max, t.maxTick), 0);
+
+  // Playback reads the file bytes through a MidiEventStream; this one pass
+  // builds its seek index and the per-track notes and program changes
+  const eventSource = { bytes: u8, trackRanges: findTrackRanges(u8, ntrks, 8 + headerLen), tempoMap };
+  const stream = new MidiEventStream(eventSource);
+  const notes = parsedTracks.map(() => []);
+  const programs = parsedTracks.map(() => []);
+  const active = parsedTracks.map(() => new Map());
+  stream.buildIndex((slot) => {
+    const t = stream.track[slot];
+    const sec = stream.sec[slot];
+    const channel = stream.channel[slot];
+    const type = stream.type[slot];
+    if (type === STREAM_PROGRAM) {
+      programs[t].push({ sec, channel, program: stream.data1[slot], bank: stream.data2[slot] });
+      return;
+    }
+    const note = stream.data1[slot];
+    const key = (channel << 7) | note;
+    if (type === STREAM_NOTE_ON) {
+      const stack = active[t].get(key) ?? [];
+      stack.push({ startSec: sec, velocity: stream.data2[slot] });
+      active[t].set(key, stack);
+      return;
+    }
+    const start = active[t].get(key)?.pop();
+    if (start) {
+      notes[t].push({
+        note,
+        velocity: start.velocity,
+        channel,
+        startSec: start.startSec,
+        durationSec: Math.max(0.01, sec - start.startSec),
+      });
     }
-
-    return {
-      index: idx,
-      name: track.trackName || `Track ${idx + 1}`,
-      instrumentName: track.instrumentName || "",
-      notes: notes.sort((a, b) => a.startSec - b.startSec),
-      playEvents: playEvents.sort((a, b) => (a.sec - b.sec) || (a.seq - b.seq)),
-    };
   });
 
+  const tracks = parsedTracks.map((track, idx) => ({
+    index: idx,
+    name: track.trackName || `Track ${idx + 1}`,
+    instrumentName: track.instrumentName || "",
+    notes: notes[idx].sort((a, b) => a.startSec - b.startSec),
+    programs: programs[idx],
+  }));
+
   const timeSigEvents = allEvents
     .filter((e) => e.type === "timeSig")
     .sort((a, b) => (a.tick - b.tick) || (a.seq - b.seq));
@@ -233,7 +194,7 @@ function parseMidiBuffer(buffer) {
       .sort((a, b) => (a.tick - b.tick) || (a.seq - b.seq))[0]?.microPerQuarter ?? 500000;
   const barTicks = Math.max(1, primaryTimeSig.numerator * division * (4 / primaryTimeSig.denominator));
   const totalBars = Math.max(1, maxTick / barTicks);
-  const durationSec = tickToSec(tempoMap, division, maxTick);
+  const durationSec = tickToSec(tempoMap, maxTick);
   const title =
     parsedTracks.find((track) => track.trackName)?.trackName ||
     parsedTracks.find((track) => track.meta.textEvents.length)?.meta.textEvents[0] ||
@@ -243,11 +204,12 @@ function parseMidiBuffer(buffer) {
   const markerCount = parsedTracks.reduce((count, track) => count + track.meta.markers.length, 0);
   const cueCount = parsedTracks.reduce((count, track) => count + track.meta.cues.length, 0);
   const copyright = parsedTracks.find((track) => track.meta.copyright)?.meta.copyright || "";
-  return {
+  const song = {
     format,
     division,
     durationSec,
     tracks,
+    eventSource,
     totalBars,
     bpm: Math.round(60000000 / primaryTempo),
     timeSig: `${primaryTimeSig.numerator}/${primaryTimeSig.denominator}`,
@@ -267,9 +229,11 @@ function parseMidiBuffer(buffer) {
       totalBars: Math.round(totalBars * 100) / 100,
     },
   };
+  return { song, stream };
 }
 
 let song = null;
+let stream = null; // MidiEventStream over song.eventSource
 let ports = new Map();
 let trackState = [];
 let timer = null;
@@ -277,20 +241,70 @@ let playing = false;
 let startPerf = 0;
 let startSec = 0;
 let lastTickEmit = 0;
+// Audio-clock anchor: song time startSec sounds at AudioContext time
+// audioStart. When the main thread provides it, note events carry the exact
+// frame they are due and the processor renders them sample-accurately, so
+// the lookahead only has to cover timer jitter, not define the timing.
+let audioStart = null;
+let audioSampleRate = 0;
+const LOOKAHEAD_SEC = 0.1;
+
+function setAudioClock(msg) {
+  const ok = Number.isFinite(msg.audioTime) && Number.isFinite(msg.sampleRate) && msg.sampleRate > 0;
+  audioStart = ok ? msg.audioTime : null;
+  audioSampleRate = ok ? msg.sampleRate : 0;
+}
+
+// Absolute frame (AudioWorklet currentFrame timebase) for a song time, or undefined
+function eventFrame(sec) {
+  if (audioStart == null) return undefined;
+  return Math.round((audioStart + (sec - startSec)) * audioSampleRate);
+}
 
 function clearTimer() {
   if (timer != null) clearInterval(timer);
   timer = null;
 }
 
+// Note and controller traffic goes through the part's shared event ring when
+// the page is cross-origin isolated; postMessage is the fallback, also used
+// for a record the ring had no room for (counted in its overflow word)
+function sendNoteOn(state, note, velocity, frame) {
+  if (state.ring?.push(frame, EVENT_RING_NOTE_ON, state.channel, note, velocity)) return;
+  state.port.postMessage({ type: "noteOn", channel: state.channel, note, velocity, frame });
+}
+
+function sendNoteOff(state, note, frame) {
+  if (state.ring?.push(frame, EVENT_RING_NOTE_OFF, state.channel, note)) return;
+  state.port.postMessage({ type: "noteOff", channel: state.channel, note, frame });
+}
+
+function sendAllNotesOff(state) {
+  if (state.ring?.push(null, EVENT_RING_ALL_NOTES_OFF, state.channel)) return;
+  state.port.postMessage({ type: "allNotesOff", channel: state.channel });
+}
+
+function ringOverflows() {
+  let total = 0;
+  for (const rec of ports.values()) total += rec.ring?.overflows ?? 0;
+  return total;
+}
+
 function stopNotes() {
   for (const state of trackState) {
     if (!state?.port) continue;
-    state.port.postMessage({ type: "allNotesOff" });
+    sendAllNotesOff(state);
     state.active.clear();
   }
 }
 
+// Tracks share part processors (16 channels each); returns each port once
+function uniquePorts() {
+  const out = new Set();
+  for (const rec of ports.values()) out.add(rec.port);
+  return out;
+}
+
 function pauseInternal() {
   if (!playing) return;
   const nowSec = startSec + (performance.now() - startPerf) / 1000;
@@ -303,45 +317,85 @@ function pauseInternal() {
 function setTrackPreset(payload) {
   const state = trackState[payload.trackIndex];
   if (!state?.port) return;
-  state.port.postMessage({ type: "setPreset", regions: payload.regions ?? [] });
+  state.port.postMessage({ type: "setPreset", channel: state.channel, regions: payload.regions ?? null });
   state.override = !!payload.override;
   state.presetIndex = payload.presetIndex ?? null;
 }
 
+function setTrackControllers(payload) {
+  const state = trackState[payload.trackIndex];
+  if (!state?.port) return;
+  const full = [payload.cc7Volume, payload.cc10Pan, payload.cc11Expression].every(Number.isFinite);
+  if (full && state.ring?.push(
+    null, EVENT_RING_CONTROLLERS, state.channel, payload.cc7Volume, payload.cc10Pan, payload.cc11Expression,
+  )) return;
+  state.port.postMessage({
+    type: "setControllers",
+    channel: state.channel,
+    cc7Volume: payload.cc7Volume,
+    cc10Pan: payload.cc10Pan,
+    cc11Expression: payload.cc11Expression,
+  });
+}
+
+// Effects send level of a track's channel (0..1), e.g. 0 while it is muted
+// so its reverb and chorus go quiet along with it
+function setTrackSends(payload) {
+  const state = trackState[payload.trackIndex];
+  if (!state?.port) return;
+  state.port.postMessage({ type: "setSends", channel: state.channel, reverb: payload.reverb, chorus: payload.chorus });
+}
+
+function setControlInterval(payload) {
+  for (const port of uniquePorts()) {
+    port.postMessage({ type: "setControlInterval", frames: payload.frames });
+  }
+}
+
+function setInterpolation(payload) {
+  for (const port of uniquePorts()) {
+    port.postMessage({ type: "setInterpolation", quality: payload.quality });
+  }
+}
+
+function setSampleBank(payload) {
+  for (const port of uniquePorts()) {
+    port.postMessage({ type: "setSampleBank", bankId: payload.bankId ?? null, smpl: payload.smpl });
+  }
+}
+
 function runTick() {
   if (!playing || !song) return;
   const nowSec = startSec + (performance.now() - startPerf) / 1000;
-  const lookahead = nowSec + 0.03;
+  const lookahead = nowSec + LOOKAHEAD_SEC;
 
-  for (let i = 0; i < song.tracks.length; i += 1) {
-    const track = song.tracks[i];
+  for (let slot = stream.peek(); slot >= 0 && stream.sec[slot] <= lookahead; slot = stream.peek()) {
+    stream.advance();
+    const i = stream.track[slot];
     const state = trackState[i];
     if (!state?.port) continue;
-    while (state.nextEventIndex < track.playEvents.length) {
-      const ev = track.playEvents[state.nextEventIndex];
-      if (ev.sec > lookahead) break;
-      if (ev.type === "program") {
-        if (!state.override) {
-          self.postMessage({
-            type: "programChangeRequest",
-            trackIndex: i,
-            program: ev.program,
-            bank: ev.bank,
-          });
-        }
-      } else if (ev.type === "noteOn") {
-        state.port.postMessage({ type: "noteOn", note: ev.note, velocity: ev.velocity });
-        state.active.add(`${ev.channel}:${ev.note}`);
-      } else if (ev.type === "noteOff") {
-        state.port.postMessage({ type: "noteOff", note: ev.note });
-        state.active.delete(`${ev.channel}:${ev.note}`);
+    const type = stream.type[slot];
+    const note = stream.data1[slot];
+    if (type === STREAM_PROGRAM) {
+      if (!state.override) {
+        self.postMessage({
+          type: "programChangeRequest",
+          trackIndex: i,
+          program: stream.data1[slot],
+          bank: stream.data2[slot],
+        });
       }
-      state.nextEventIndex += 1;
+    } else if (type === STREAM_NOTE_ON) {
+      sendNoteOn(state, note, stream.data2[slot], eventFrame(stream.sec[slot]));
+      state.active.add(`${stream.channel[slot]}:${note}`);
+    } else if (type === STREAM_NOTE_OFF) {
+      sendNoteOff(state, note, eventFrame(stream.sec[slot]));
+      state.active.delete(`${stream.channel[slot]}:${note}`);
     }
   }
 
   if (nowSec - lastTickEmit > 0.09) {
-    self.postMessage({ type: "tick", sec: nowSec });
+    self.postMessage({ type: "tick", sec: nowSec, ringOverflows: ringOverflows() });
     lastTickEmit = nowSec;
   }
 
@@ -358,13 +412,14 @@ self.onmessage = (event) => {
   if (msg.type === "loadMidi") {
     try {
       pauseInternal();
-      song = parseMidiBuffer(msg.midiData);
+      ({ song, stream } = parseMidiBuffer(msg.midiData));
       trackState = (song.tracks ?? []).map((t) => ({
-        nextEventIndex: 0,
         active: new Set(),
         override: false,
         presetIndex: null,
-        port: ports.get(t.index) ?? null,
+        port: ports.get(t.index)?.port ?? null,
+        ring: ports.get(t.index)?.ring ?? null,
+        channel: ports.get(t.index)?.channel ?? 0,
       }));
       self.postMessage({ type: "songLoaded", song });
     } catch (err) {
@@ -374,11 +429,25 @@ self.onmessage = (event) => {
   }
 
   if (msg.type === "attachPorts") {
-    for (const rec of msg.ports ?? []) {
-      ports.set(rec.trackIndex, rec.port);
+    // msg.ports holds one port per part processor; msg.tracks maps each
+    // track to a part and the synth channel it plays on inside that part.
+    // msg.rings (optional) holds each part's SharedArrayBuffer event ring.
+    ports = new Map();
+    const writers = (msg.rings ?? []).map((sab) => (sab ? new EventRingWriter(sab) : null));
+    for (const rec of msg.tracks ?? []) {
+      const port = msg.ports?.[rec.part];
+      if (port) ports.set(rec.trackIndex, { port, ring: writers[rec.part] ?? null, channel: rec.channel ?? 0 });
     }
+    // The processors' once-a-second engine stats are relayed to the page
+    (msg.ports ?? []).forEach((port, part) => {
+      port.onmessage = (event) => {
+        if (event.data?.type === "stats") self.postMessage({ type: "dspStats", part, stats: event.data });
+      };
+    });
     for (let i = 0; i < trackState.length; i += 1) {
-      trackState[i].port = ports.get(i) ?? null;
+      trackState[i].port = ports.get(i)?.port ?? null;
+      trackState[i].ring = ports.get(i)?.ring ?? null;
+      trackState[i].channel = ports.get(i)?.channel ?? 0;
     }
     return;
   }
@@ -388,19 +457,39 @@ self.onmessage = (event) => {
     return;
   }
 
+  if (msg.type === "setTrackControllers") {
+    setTrackControllers(msg);
+    return;
+  }
+
+  if (msg.type === "setTrackSends") {
+    setTrackSends(msg);
+    return;
+  }
+
+  if (msg.type === "setControlInterval") {
+    setControlInterval(msg);
+    return;
+  }
+
+  if (msg.type === "setInterpolation") {
+    setInterpolation(msg);
+    return;
+  }
+
+  if (msg.type === "setSampleBank") {
+    setSampleBank(msg);
+    return;
+  }
+
   if (msg.type === "play") {
     if (!song) return;
     const sec = Math.max(0, Math.min(song.durationSec, msg.startSec ?? 0));
     startSec = sec;
     startPerf = performance.now();
-    for (let i = 0; i < song.tracks.length; i += 1) {
-      const track = song.tracks[i];
-      const idx = track.playEvents.findIndex((e) => e.sec >= sec);
-      const state = trackState[i];
-      if (!state) continue;
-      state.nextEventIndex = idx >= 0 ? idx : track.playEvents.length;
-      state.active.clear();
-    }
+    setAudioClock(msg);
+    stream.seek(sec);
+    for (const state of trackState) state.active.clear();
     lastTickEmit = sec;
     clearTimer();
     timer = setInterval(runTick, 5);
@@ -417,16 +506,10 @@ self.onmessage = (event) => {
     if (!song) return;
     const sec = Math.max(0, Math.min(song.durationSec, msg.sec ?? 0));
     stopNotes();
-    for (let i = 0; i < song.tracks.length; i += 1) {
-      const track = song.tracks[i];
-      const idx = track.playEvents.findIndex((e) => e.sec >= sec);
-      const state = trackState[i];
-      if (!state) continue;
-      state.nextEventIndex = idx >= 0 ? idx : track.playEvents.length;
-      state.active.clear();
-    }
+    stream.seek(sec);
     startSec = sec;
     startPerf = performance.now();
+    setAudioClock(msg);
     self.postMessage({ type: "tick", sec });
   }
 };
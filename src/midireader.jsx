@@ -1,4 +1,7 @@
 import { useEffect, useMemo, useRef, useState } from "react";
+import { createEventRing } from "./event-ring.js";
+import { OFFLINE_SAMPLE_RATE, offlineFrameCount, renderSongParallel } from "./offline-render-pool.js";
+import { wavHeader } from "./wav.js";
 
 function fmtTime(sec) {
   const s = Math.max(0, sec | 0);
@@ -8,6 +11,11 @@ function fmtTime(sec) {
 }
 
 const DEFAULT_TRACK_CC = { cc7Volume: 100, cc10Pan: 64, cc11Expression: 127 };
+const PART_CHANNELS = 16; // synth channels per sf2-processor node
+const PART_MAX_VOICES = 128; // voice budget shared by a part's channels
+// Audio-clock lead for the first scheduled event after play/seek; notes are
+// timestamped against ctx.currentTime + this and rendered sample-accurately
+const SCHEDULE_LEAD_SEC = 0.05;
 
 function clampCc(value) {
   return Math.max(0, Math.min(127, Number(value) | 0));
@@ -108,12 +116,16 @@ function resolveOrchestraPan(...labels) {
 
 export default function MidiReader({
   sf2Ready,
+  sampleBank,
+  controlInterval,
+  interpolation,
   ensureAudioInfrastructure,
   getRegionsForPreset,
   resolvePresetIndex,
   fallbackPresetIndex,
   presetOptions = [],
   onError,
+  onDspStats,
 }) {
   const [song, setSong] = useState(null);
   const [songName, setSongName] = useState("");
@@ -126,6 +138,7 @@ export default function MidiReader({
   const [trackPresetOverrides, setTrackPresetOverrides] = useState({});
   const [trackCcControls, setTrackCcControls] = useState({});
   const [trackMixState, setTrackMixState] = useState({});
+  const [exportStatus, setExportStatus] = useState(null); // { sec, durationSec, realtimeFactor, done }
 
   const viewportRef = useRef(null);
   const playheadRef = useRef(null);
@@ -137,15 +150,19 @@ export default function MidiReader({
   const dragStateRef = useRef({ active: false, startX: 0, startLeft: 0 });
   const isSeekingRef = useRef(false);
   const onErrorRef = useRef(onError);
+  const onDspStatsRef = useRef(onDspStats);
   const trackPresetOverridesRef = useRef({});
   const trackCcControlsRef = useRef({});
   const trackMixStateRef = useRef({});
   const resolvePresetRef = useRef(resolvePresetIndex);
   const getRegionsRef = useRef(getRegionsForPreset);
+  const sampleBankRef = useRef(sampleBank);
   const fallbackPresetRef = useRef(fallbackPresetIndex);
   const durationRef = useRef(0.01);
   const contentWRef = useRef(1000);
   const presetOptionMapRef = useRef(new Map());
+  const audioCtxRef = useRef(null);
+  const presetRequestRef = useRef({}); // trackIndex -> token of the latest preset request
 
   const timelineW = 1000;
   const trackH = 108;
@@ -187,7 +204,7 @@ export default function MidiReader({
     const out = {};
     if (!song?.tracks?.length) return out;
     for (const track of song.tracks) {
-      const programEvent = track.playEvents.find((e) => e.type === "program");
+      const programEvent = track.programs[0];
       if (!programEvent) continue;
       const presetIndex = resolvePresetIndex(programEvent.program, programEvent.bank);
       if (presetIndex != null && presetIndex >= 0) out[track.index] = presetIndex;
@@ -198,6 +215,9 @@ export default function MidiReader({
   useEffect(() => {
     onErrorRef.current = onError;
   }, [onError]);
+  useEffect(() => {
+    onDspStatsRef.current = onDspStats;
+  }, [onDspStats]);
   useEffect(() => {
     trackPresetOverridesRef.current = trackPresetOverrides;
   }, [trackPresetOverrides]);
@@ -213,6 +233,29 @@ export default function MidiReader({
   useEffect(() => {
     getRegionsRef.current = getRegionsForPreset;
   }, [getRegionsForPreset]);
+  useEffect(() => {
+    if (sampleBankRef.current === sampleBank) return;
+    sampleBankRef.current = sampleBank;
+    // Track ports live in the worker once attached; it forwards the new bank
+    if (workerRef.current && portsAttachedRef.current) {
+      workerRef.current.postMessage({
+        type: "setSampleBank",
+        bankId: sampleBank?.id ?? null,
+        smpl: sampleBank?.smpl,
+      });
+    }
+  }, [sampleBank]);
+  useEffect(() => {
+    // New part nodes pick the value up from processorOptions
+    if (workerRef.current && portsAttachedRef.current && Number.isFinite(controlInterval)) {
+      workerRef.current.postMessage({ type: "setControlInterval", frames: controlInterval });
+    }
+  }, [controlInterval]);
+  useEffect(() => {
+    if (workerRef.current && portsAttachedRef.current && Number.isFinite(interpolation)) {
+      workerRef.current.postMessage({ type: "setInterpolation", quality: interpolation });
+    }
+  }, [interpolation]);
   useEffect(() => {
     fallbackPresetRef.current = fallbackPresetIndex;
   }, [fallbackPresetIndex]);
@@ -233,12 +276,19 @@ export default function MidiReader({
     line.style.transform = `translateX(${x}px)`;
   };
 
+  // Tells the timer worker which AudioContext time the song position maps to
+  const audioClockAnchor = () => {
+    const ctx = audioCtxRef.current;
+    if (!ctx || ctx.state !== "running") return {};
+    return { audioTime: ctx.currentTime + SCHEDULE_LEAD_SEC, sampleRate: ctx.sampleRate };
+  };
+
   const seekToSeconds = (nextSec) => {
     const safeDuration = Math.max(0.01, durationRef.current);
     const sec = Math.max(0, Math.min(safeDuration, Number(nextSec) || 0));
     updatePlayhead(sec);
     setSongTime(sec);
-    workerRef.current?.postMessage({ type: "seek", sec });
+    workerRef.current?.postMessage({ type: "seek", sec, ...audioClockAnchor() });
     return sec;
   };
 
@@ -288,49 +338,61 @@ export default function MidiReader({
     for (let i = 0; i < songData.tracks.length; i += 1) {
       const track = songData.tracks[i];
       const rec = trackNodesRef.current[i];
-      if (!rec?.node) continue;
+      if (!rec?.node || !workerRef.current) continue;
       const cc = getTrackCc(track.index, controls);
-      rec.node.port.postMessage({ type: "setControllers", ...cc });
+      // Node ports belong to the timer worker once attached; it adds the channel
+      workerRef.current.postMessage({ type: "setTrackControllers", trackIndex: i, ...cc });
     }
   };
 
+  const isTrackAudible = (songData, track, mix = trackMixStateRef.current) => {
+    const anySolo = songData.tracks.some((t) => !!mix?.[t.index]?.solo);
+    const muted = !!mix?.[track.index]?.mute;
+    const solo = !!mix?.[track.index]?.solo;
+    const cc = getTrackCc(track.index);
+    const ccSilent = cc.cc7Volume === 0 || cc.cc11Expression === 0;
+    return (anySolo ? solo : !muted) && !ccSilent;
+  };
+
   const applyTrackMuteSolo = (songData, mix = trackMixStateRef.current) => {
     if (!songData?.tracks?.length) return;
-    const anySolo = songData.tracks.some((track) => !!mix?.[track.index]?.solo);
     for (let i = 0; i < songData.tracks.length; i += 1) {
       const track = songData.tracks[i];
       const rec = trackNodesRef.current[i];
       if (!rec?.gain) continue;
-      const muted = !!mix?.[track.index]?.mute;
-      const solo = !!mix?.[track.index]?.solo;
-      const cc = getTrackCc(track.index);
-      const ccSilent = cc.cc7Volume === 0 || cc.cc11Expression === 0;
-      const audible = (anySolo ? solo : !muted) && !ccSilent;
+      const audible = isTrackAudible(songData, track, mix);
       rec.gain.gain.setTargetAtTime(audible ? 1 : 0, rec.gain.context.currentTime, 0.01);
+      // The shared reverb/chorus return bypasses the track gain, so the
+      // track's sends follow it
+      const level = audible ? 1 : 0;
+      workerRef.current?.postMessage({ type: "setTrackSends", trackIndex: i, reverb: level, chorus: level });
     }
   };
 
+  const getTrackPan = (track, overrides) => {
+    const overridePreset = overrides?.[track.index];
+    const defaultPreset = trackDefaultPresetMap[track.index];
+    const effectivePreset =
+      overridePreset != null
+        ? overridePreset
+        : defaultPreset != null
+          ? defaultPreset
+          : fallbackPresetIndex;
+    const preset = presetOptionMapRef.current.get(effectivePreset);
+    return resolveOrchestraPan(
+      track.instrumentName,
+      track.name,
+      preset?.name
+    ) ?? 0;
+  };
+
   const applyTrackPanning = (songData, overrides) => {
     if (!songData?.tracks?.length) return;
     for (let i = 0; i < songData.tracks.length; i += 1) {
       const track = songData.tracks[i];
       const rec = trackNodesRef.current[i];
       if (!rec?.panner) continue;
-      const overridePreset = overrides?.[track.index];
-      const defaultPreset = trackDefaultPresetMap[track.index];
-      const effectivePreset =
-        overridePreset != null
-          ? overridePreset
-          : defaultPreset != null
-            ? defaultPreset
-            : fallbackPresetIndex;
-      const preset = presetOptionMapRef.current.get(effectivePreset);
-      const pan = resolveOrchestraPan(
-        track.instrumentName,
-        track.name,
-        preset?.name
-      );
-      rec.panner.pan.setValueAtTime(pan ?? 0, rec.panner.context.currentTime);
+      rec.panner.pan.setValueAtTime(getTrackPan(track, overrides), rec.panner.context.currentTime);
     }
   };
 
@@ -379,19 +441,16 @@ export default function MidiReader({
         setIsPlaying(false);
         return;
       }
+      if (msg.type === "dspStats") {
+        onDspStatsRef.current?.(`part${msg.part}`, msg.stats);
+        return;
+      }
       if (msg.type === "programChangeRequest") {
         const presetIndex =
           trackPresetOverridesRef.current[msg.trackIndex] != null
             ? trackPresetOverridesRef.current[msg.trackIndex]
             : resolvePresetRef.current(msg.program, msg.bank) ?? fallbackPresetRef.current;
-        const regions = getRegionsRef.current(presetIndex);
-        worker.postMessage({
-          type: "setTrackPreset",
-          trackIndex: msg.trackIndex,
-          presetIndex,
-          override: trackPresetOverridesRef.current[msg.trackIndex] != null,
-          regions,
-        });
+        postTrackPreset(msg.trackIndex, presetIndex, trackPresetOverridesRef.current[msg.trackIndex] != null);
         return;
       }
       if (msg.type === "error") {
@@ -532,14 +591,7 @@ export default function MidiReader({
     for (const track of song.tracks) {
       const overridePreset = trackPresetOverrides[track.index];
       if (overridePreset == null) continue;
-      const regions = getRegionsForPreset(overridePreset);
-      workerRef.current.postMessage({
-        type: "setTrackPreset",
-        trackIndex: track.index,
-        presetIndex: overridePreset,
-        override: true,
-        regions,
-      });
+      postTrackPreset(track.index, overridePreset, true);
     }
     applyTrackPanning(song, trackPresetOverrides);
   }, [trackPresetOverrides, song, getRegionsForPreset]);
@@ -563,43 +615,214 @@ export default function MidiReader({
     if (!processorOptions?.wasmBinary || !processorOptions?.glueCode) {
       throw new Error("AudioWorklet WASM data is not ready");
     }
+    // One multitimbral processor ("part") per 16 tracks: each track plays on
+    // its own synth channel and per-channel outputs keep the mixer strips;
+    // one more output carries the part's reverb and chorus return
+    const partNodes = [];
+    const partRings = [];
     const trackNodes = [];
     for (let i = 0; i < song.tracks.length; i += 1) {
-      const node = new AudioWorkletNode(ctx, "sf2-processor", {
-        numberOfInputs: 0,
-        numberOfOutputs: 1,
-        outputChannelCount: [2],
-        processorOptions,
-      });
+      const part = Math.floor(i / PART_CHANNELS);
+      const channel = i % PART_CHANNELS;
+      if (channel === 0) {
+        const outputs = Math.min(PART_CHANNELS, song.tracks.length - i);
+        // Shared event ring from the timer worker (null without cross-origin isolation)
+        const eventRing = createEventRing();
+        const node = new AudioWorkletNode(ctx, "sf2-processor", {
+          numberOfInputs: 0,
+          numberOfOutputs: outputs + 1,
+          outputChannelCount: new Array(outputs + 1).fill(2),
+          processorOptions: {
+            ...processorOptions,
+            perChannelOutputs: true,
+            effectsReturn: true,
+            maxVoices: PART_MAX_VOICES,
+            eventRing,
+          },
+        });
+        node.connect(analyser, outputs);
+        partRings.push(eventRing);
+        // Load the bank before the port is transferred; presets only carry offsets
+        const bank = sampleBankRef.current;
+        node.port.postMessage({ type: "setSampleBank", bankId: bank?.id ?? null, smpl: bank?.smpl });
+        partNodes.push(node);
+      }
+      const node = partNodes[part];
       const panner = new StereoPannerNode(ctx, { pan: 0 });
       const gain = ctx.createGain();
       gain.gain.setValueAtTime(1, ctx.currentTime);
-      node.connect(panner);
+      node.connect(panner, channel);
       panner.connect(gain);
       gain.connect(analyser);
-      trackNodes.push({ node, panner, gain });
+      trackNodes.push({ node, part, channel, panner, gain });
     }
     trackNodesRef.current = trackNodes;
 
-    const ports = trackNodes.map((rec, index) => ({ trackIndex: index, port: rec.node.port }));
-    workerRef.current.postMessage({ type: "attachPorts", ports }, ports.map((p) => p.port));
+    const ports = partNodes.map((node) => node.port);
+    const tracks = trackNodes.map((rec, index) => ({ trackIndex: index, part: rec.part, channel: rec.channel }));
+    workerRef.current.postMessage({ type: "attachPorts", ports, tracks, rings: partRings }, ports);
     portsAttachedRef.current = true;
 
     for (const track of song.tracks) {
       const overridePreset = trackPresetOverrides[track.index];
       const presetIndex = overridePreset ?? fallbackPresetIndex;
-      const regions = getRegionsForPreset(presetIndex);
-      workerRef.current.postMessage({
-        type: "setTrackPreset",
+      postTrackPreset(track.index, presetIndex, overridePreset != null);
+    }
+    applyTrackPanning(song, trackPresetOverrides);
+    applyTrackControllers(song, trackCcControlsRef.current);
+    applyTrackMuteSolo(song, trackMixStateRef.current);
+  }
+
+  // Region tables are built in the SoundFont worker, so they arrive
+  // asynchronously; a newer request for the same track supersedes one still
+  // in flight. Only touches refs, so the timer worker's handler can call it.
+  function postTrackPreset(trackIndex, presetIndex, override) {
+    const token = {};
+    presetRequestRef.current[trackIndex] = token;
+    const isCurrent = () => presetRequestRef.current[trackIndex] === token && workerRef.current;
+    getRegionsRef.current(presetIndex).then(
+      (regions) => {
+        if (!isCurrent()) return;
+        workerRef.current.postMessage({ type: "setTrackPreset", trackIndex, presetIndex, override, regions });
+      },
+      (err) => {
+        if (isCurrent()) setSongError(err instanceof Error ? err.message : String(err));
+      }
+    );
+  }
+
+  // Offline export options mirroring the live graph: initial preset, program
+  // changes, controllers, orchestra pan and mute/solo per track
+  async function buildOfflineTracks() {
+    const presets = {};
+    const addPreset = (presetIndex) => {
+      if (presetIndex != null && !(presetIndex in presets)) presets[presetIndex] = getRegionsForPreset(presetIndex);
+    };
+    const tracks = song.tracks.map((track) => {
+      const overridePreset = trackPresetOverrides[track.index];
+      const presetIndex = overridePreset ?? fallbackPresetIndex;
+      addPreset(presetIndex);
+      const programs = track.programs.map((e) => ({
+        sec: e.sec,
+        presetIndex: resolvePresetIndex(e.program, e.bank) ?? fallbackPresetIndex,
+      }));
+      for (const change of programs) addPreset(change.presetIndex);
+      return {
         trackIndex: track.index,
         presetIndex,
         override: overridePreset != null,
-        regions,
+        programs,
+        cc: getTrackCc(track.index),
+        pan: getTrackPan(track, trackPresetOverrides),
+        gain: isTrackAudible(song, track) ? 1 : 0,
+      };
+    });
+    const indices = Object.keys(presets);
+    const regions = await Promise.all(indices.map((index) => presets[index]));
+    indices.forEach((index, i) => {
+      presets[index] = regions[i];
+    });
+    return { tracks, presets };
+  }
+
+  // Streams to disk through the File System Access API when available,
+  // otherwise collects the chunks into a Blob download. `dir` is a directory
+  // handle (stems) or null to ask for a single file.
+  async function openWavSink(fileName, dir = null) {
+    let handle = null;
+    if (dir) {
+      handle = await dir.getFileHandle(fileName, { create: true });
+    } else if (typeof window.showSaveFilePicker === "function") {
+      handle = await window.showSaveFilePicker({
+        suggestedName: fileName,
+        types: [{ description: "WAV audio", accept: { "audio/wav": [".wav"] } }],
       });
     }
-    applyTrackPanning(song, trackPresetOverrides);
-    applyTrackControllers(song, trackCcControlsRef.current);
-    applyTrackMuteSolo(song, trackMixStateRef.current);
+    if (handle) {
+      const writable = await handle.createWritable();
+      return { write: (buf) => writable.write(buf), close: () => writable.close(), abort: () => writable.abort() };
+    }
+    const parts = [];
+    return {
+      write: (buf) => parts.push(buf),
+      close: () => {
+        const url = URL.createObjectURL(new Blob(parts, { type: "audio/wav" }));
+        const a = document.createElement("a");
+        a.href = url;
+        a.download = fileName;
+        a.click();
+        setTimeout(() => URL.revokeObjectURL(url), 0);
+      },
+      abort: () => {
+        parts.length = 0;
+      },
+    };
+  }
+
+  // Renders offline across a worker pool (one engine per worker, tracks split
+  // by note count) into one mixed WAV, or one WAV per track with `stems`
+  async function onExportWav(stems = false) {
+    if (!song || !sf2Ready || (exportStatus && !exportStatus.done)) return;
+    const safeName = (name) => name.replace(/\.(mid|midi)$/i, "").replace(/[\\/:*?"<>|]+/g, "_");
+    const baseName = safeName(songTitle || "song");
+    const sinks = new Map(); // trackIndex (or "mix") -> sink
+    const header = () => wavHeader(OFFLINE_SAMPLE_RATE, 2, offlineFrameCount(song));
+    let dir = null;
+    try {
+      if (!stems) {
+        sinks.set("mix", await openWavSink(`${baseName}.wav`));
+      } else if (typeof window.showDirectoryPicker === "function") {
+        dir = await window.showDirectoryPicker({ mode: "readwrite" });
+      }
+    } catch {
+      return; // save dialog cancelled
+    }
+    try {
+      const { processorOptions } = await ensureAudioInfrastructure();
+      const { tracks, presets } = await buildOfflineTracks();
+      const bank = sampleBankRef.current;
+      setExportStatus({ sec: 0, durationSec: song.durationSec, realtimeFactor: 0, done: false });
+      if (!stems) await sinks.get("mix").write(header());
+      const stemSink = async (trackIndex) => {
+        let sink = sinks.get(trackIndex);
+        if (!sink) {
+          const track = song.tracks[trackIndex];
+          const label = safeName(formatTrackInlineName(track) || `Track ${trackIndex + 1}`);
+          sink = await openWavSink(`${baseName} - ${String(trackIndex + 1).padStart(2, "0")} ${label}.wav`, dir);
+          sinks.set(trackIndex, sink);
+          await sink.write(header());
+        }
+        return sink;
+      };
+      const result = await renderSongParallel(
+        song,
+        {
+          wasmBinary: processorOptions.wasmBinary,
+          glueCode: processorOptions.glueCode,
+          basePath: processorOptions.basePath,
+          controlInterval: processorOptions.controlInterval,
+          interpolation: processorOptions.interpolation,
+          sampleBank: bank ? { id: bank.id, smpl: bank.smpl } : null,
+          presets,
+          // Stems carry every track regardless of mute/solo
+          tracks: stems ? tracks.map((t) => ({ ...t, gain: 1 })) : tracks,
+        },
+        {
+          stems,
+          onMixChunk: (pcm) => sinks.get("mix").write(pcm),
+          onStemChunk: async (trackIndex, pcm) => (await stemSink(trackIndex)).write(pcm),
+          onProgress: (progress) => setExportStatus({ ...progress, done: false }),
+        }
+      );
+      for (const sink of sinks.values()) await sink.close();
+      setExportStatus({ ...result, sec: result.durationSec, done: true });
+    } catch (err) {
+      for (const sink of sinks.values()) await sink.abort?.();
+      setExportStatus(null);
+      const msg = err instanceof Error ? err.message : String(err);
+      setSongError(msg);
+      onError?.(msg);
+    }
   }
 
   async function onPlayPause() {
@@ -620,7 +843,8 @@ export default function MidiReader({
           throw new Error("Failed to resume audio: " + resumeMsg);
         }
       }
-      workerRef.current.postMessage({ type: "play", startSec: songTime });
+      audioCtxRef.current = ctx;
+      workerRef.current.postMessage({ type: "play", startSec: songTime, ...audioClockAnchor() });
       setIsPlaying(true);
       setSongError("");
     } catch (err) {
@@ -682,14 +906,7 @@ export default function MidiReader({
     setTrackPresetOverrides((prev) => ({ ...prev, [trackIndex]: nextPreset }));
     if (!workerRef.current || !portsAttachedRef.current) return;
     const presetIndex = nextPreset ?? fallbackPresetIndex;
-    const regions = getRegionsForPreset(presetIndex);
-    workerRef.current.postMessage({
-      type: "setTrackPreset",
-      trackIndex,
-      presetIndex,
-      override: nextPreset != null,
-      regions,
-    });
+    postTrackPreset(trackIndex, presetIndex, nextPreset != null);
     applyTrackPanning(song, { ...trackPresetOverridesRef.current, [trackIndex]: nextPreset });
   }
 
@@ -701,7 +918,9 @@ export default function MidiReader({
     trackCcControlsRef.current = nextAll;
     setTrackCcControls(nextAll);
     const rec = trackNodesRef.current[trackIndex];
-    if (rec?.node) rec.node.port.postMessage({ type: "setControllers", ...nextTrack });
+    if (rec?.node && workerRef.current) {
+      workerRef.current.postMessage({ type: "setTrackControllers", trackIndex, ...nextTrack });
+    }
     applyTrackMuteSolo(song, trackMixStateRef.current);
   }
 
@@ -813,6 +1032,29 @@ export default function MidiReader({
         >
           MIDI Info
         </button>
+        <button
+          type="button"
+          onClick={() => onExportWav(false)}
+          disabled={!song || !sf2Ready || (exportStatus && !exportStatus.done)}
+          title="Render the song offline to a WAV file"
+        >
+          Export WAV
+        </button>
+        <button
+          type="button"
+          onClick={() => onExportWav(true)}
+          disabled={!song || !sf2Ready || (exportStatus && !exportStatus.done)}
+          title="Render one WAV file per track"
+        >
+          Export Stems
+        </button>
+        {exportStatus && (
+          <span className="chip">
+            {exportStatus.done
+              ? `Exported ${fmtTime(exportStatus.durationSec)} at ${exportStatus.realtimeFactor.toFixed(1)}x realtime (${exportStatus.workers} workers)`
+              : `Rendering ${Math.round((100 * exportStatus.sec) / Math.max(0.01, exportStatus.durationSec))}% · ${exportStatus.realtimeFactor.toFixed(1)}x`}
+          </span>
+        )}
       </div>
       {showMidiInfoModal && song && (
         <div className="modalBackdrop" onClick={() => setShowMidiInfoModal(false)}>
@@ -0,0 +1,131 @@
+// offline-render-pool.js
+//
+// Parallel offline rendering: a song's tracks are split across a pool of
+// offline-render workers, each with its own instance of the DSP engine (the
+// sample bank is shared memory when the page is cross-origin isolated, else
+// copied once per worker). Chunks come back in lock-step by index and are
+// either summed into one mix or passed through as per-track stems.
+import { floatToPcm16 } from "./wav.js";
+
+export const OFFLINE_SAMPLE_RATE = 48000;
+export const OFFLINE_TAIL_SEC = 2;
+const OFFLINE_BLOCK_FRAMES = 512;
+const OFFLINE_CHUNK_SEC = 1;
+const MAX_CHUNKS_AHEAD = 4;
+
+export function offlineFrameCount(song, sampleRate = OFFLINE_SAMPLE_RATE, tailSec = OFFLINE_TAIL_SEC) {
+  return Math.ceil((Math.max(0, song?.durationSec ?? 0) + tailSec) * sampleRate);
+}
+
+// Greedy longest-first split by note count, the main driver of render cost
+export function partitionTracks(song, tracks, workerCount) {
+  const noteCount = new Map((song.tracks ?? []).map((t) => [t.index, t.notes?.length ?? 0]));
+  const bins = Array.from({ length: Math.max(1, workerCount) }, () => ({ load: 0, tracks: [] }));
+  const order = [...tracks].sort((a, b) => (noteCount.get(b.trackIndex) ?? 0) - (noteCount.get(a.trackIndex) ?? 0));
+  for (const track of order) {
+    let best = bins[0];
+    for (const bin of bins) if (bin.load < best.load) best = bin;
+    best.tracks.push(track);
+    best.load += 1 + (noteCount.get(track.trackIndex) ?? 0);
+  }
+  return bins.filter((bin) => bin.tracks.length).map((bin) => bin.tracks);
+}
+
+// Renders `song` with options as for renderSongOffline (tracks, presets, DSP
+// module, sample bank, ...). With stems, onStemChunk(trackIndex, Int16Array)
+// receives each track's interleaved 16-bit PCM; otherwise onMixChunk(Int16Array)
+// receives the summed mix. Both may return promises; chunks are delivered in
+// order. Returns { frames, durationSec, wallSec, realtimeFactor, workers }.
+export async function renderSongParallel(song, options, {
+  workers = globalThis.navigator?.hardwareConcurrency || 4,
+  stems = false,
+  onMixChunk,
+  onStemChunk,
+  onProgress,
+} = {}) {
+  const tracks = options.tracks ?? [];
+  const groups = tracks.length ? partitionTracks(song, tracks, Math.min(workers, tracks.length)) : [[]];
+  const renderOptions = {
+    ...options,
+    stems,
+    sampleRate: options.sampleRate ?? OFFLINE_SAMPLE_RATE,
+    tailSec: options.tailSec ?? OFFLINE_TAIL_SEC,
+    blockFrames: OFFLINE_BLOCK_FRAMES,
+    chunkSec: OFFLINE_CHUNK_SEC,
+  };
+  const t0 = performance.now();
+  const pool = groups.map(() => new Worker(new URL("./offline-render.worker.js", import.meta.url), { type: "module" }));
+  const progress = groups.map(() => 0);
+  const pending = new Map(); // chunk index -> { sum, count }
+  let nextIndex = 0;
+  let output = Promise.resolve(); // serializes sink writes
+
+  const ackAll = (index) => {
+    for (const worker of pool) worker.postMessage({ type: "ack", index });
+  };
+
+  // Mix mode: a chunk is emitted once every worker has delivered it
+  const addMixChunk = (index, mix) => {
+    let entry = pending.get(index);
+    if (!entry) {
+      entry = { sum: mix, count: 0 };
+      pending.set(index, entry);
+    } else {
+      for (let i = 0; i < mix.length; i++) entry.sum[i] += mix[i];
+    }
+    entry.count += 1;
+    while (pending.get(nextIndex)?.count === pool.length) {
+      const index = nextIndex++;
+      const { sum } = pending.get(index);
+      pending.delete(index);
+      output = output.then(() => onMixChunk?.(floatToPcm16(sum))).then(() => ackAll(index));
+    }
+  };
+
+  const addStemChunk = (worker, group, index, buffers) => {
+    output = output
+      .then(async () => {
+        for (let t = 0; t < group.length; t++) {
+          await onStemChunk?.(group[t].trackIndex, floatToPcm16(new Float32Array(buffers[t])));
+        }
+      })
+      .then(() => worker.postMessage({ type: "ack", index }));
+  };
+
+  try {
+    await Promise.all(pool.map((worker, w) => new Promise((resolve, reject) => {
+      worker.onmessage = (event) => {
+        const msg = event.data;
+        if (msg.type === "chunk") {
+          if (stems) addStemChunk(worker, groups[w], msg.index, msg.buffers);
+          else addMixChunk(msg.index, new Float32Array(msg.buffers[0]));
+        } else if (msg.type === "progress") {
+          progress[w] = msg.sec;
+          const sec = Math.min(...progress);
+          const wallSec = (performance.now() - t0) / 1000;
+          onProgress?.({ sec, durationSec: msg.durationSec, realtimeFactor: sec / Math.max(wallSec, 1e-9) });
+        } else if (msg.type === "done") {
+          progress[w] = msg.durationSec;
+          resolve();
+        } else if (msg.type === "error") {
+          reject(new Error(msg.message || "Offline render failed"));
+        }
+      };
+      worker.onerror = (err) => reject(new Error(err.message || "Offline render worker failed"));
+      worker.postMessage({
+        type: "render",
+        song,
+        options: { ...renderOptions, tracks: groups[w] },
+        maxAhead: MAX_CHUNKS_AHEAD,
+      });
+    })));
+    await output;
+  } finally {
+    for (const worker of pool) worker.terminate();
+  }
+
+  const wallSec = (performance.now() - t0) / 1000;
+  const frames = offlineFrameCount(song, renderOptions.sampleRate, renderOptions.tailSec);
+  const durationSec = frames / renderOptions.sampleRate;
+  return { frames, durationSec, wallSec, realtimeFactor: durationSec / Math.max(wallSec, 1e-9), workers: pool.length };
+}
@@ -0,0 +1,49 @@
+import { renderSongOffline } from "./offline-renderer.js";
+
+// One offline render worker: renders the tracks it is given with
+// renderSongOffline and posts interleaved float chunks ("chunk", buffers
+// transferred), "progress" and "done". The pool acknowledges each chunk
+// index once it has been consumed; rendering pauses while more than
+// maxAhead chunks are unacknowledged so memory stays bounded when workers
+// run at different speeds.
+let acked = -1;
+let wake = null;
+
+function waitForCredit(index, maxAhead) {
+  if (index - acked <= maxAhead) return null;
+  return new Promise((resolve) => {
+    wake = () => {
+      if (index - acked > maxAhead) return;
+      wake = null;
+      resolve();
+    };
+  });
+}
+
+self.onmessage = async (event) => {
+  const msg = event.data;
+  if (msg.type === "ack") {
+    acked = Math.max(acked, msg.index);
+    wake?.();
+    return;
+  }
+  if (msg.type !== "render") return;
+  const maxAhead = msg.maxAhead ?? 4;
+  acked = -1;
+  try {
+    const result = await renderSongOffline(
+      msg.song,
+      msg.options ?? {},
+      (chunk) => {
+        const arrays = chunk.stems ?? [chunk.mix];
+        const buffers = arrays.map((a) => (a.byteLength === a.buffer.byteLength ? a : a.slice()).buffer);
+        self.postMessage({ type: "chunk", index: chunk.index, frames: chunk.frames, buffers }, buffers);
+        return waitForCredit(chunk.index, maxAhead);
+      },
+      (progress) => self.postMessage({ type: "progress", ...progress })
+    );
+    self.postMessage({ type: "done", ...result });
+  } catch (err) {
+    self.postMessage({ type: "error", message: err instanceof Error ? err.message : String(err) });
+  }
+};
@@ -0,0 +1,230 @@
+// offline-renderer.js
+//
+// Faster-than-realtime rendering of a parsed song through the same engine the
+// AudioWorklet uses. sf2-processor.js is loaded into this (worker) scope with
+// stand-ins for the worklet globals it relies on (AudioWorkletProcessor,
+// registerProcessor, sampleRate, currentFrame) and its process() is called
+// directly, block after block, with events stamped with their exact frame.
+// Nothing waits on an audio clock, so a song renders as fast as the CPU allows.
+
+import { MidiEventStream, STREAM_NOTE_ON, STREAM_NOTE_OFF } from "./midi-stream.js";
+
+const PART_CHANNELS = 16; // synth channels per processor, as in MidiReader
+const OFFLINE_MAX_VOICES = 256; // per part; no realtime budget to protect
+
+let processorClassPromise = null;
+
+function loadProcessorClass() {
+  if (!processorClassPromise) {
+    processorClassPromise = (async () => {
+      let registered = null;
+      globalThis.currentFrame = 0;
+      globalThis.AudioWorkletProcessor ??= class {
+        constructor() {
+          this.port = { postMessage() {}, onmessage: null };
+        }
+      };
+      globalThis.registerProcessor = (name, cls) => {
+        registered = cls;
+      };
+      await import("./sf2-processor.js");
+      if (!registered) throw new Error("sf2-processor.js did not register a processor");
+      return registered;
+    })();
+  }
+  return processorClassPromise;
+}
+
+// StereoPannerNode's equal-power law for a stereo input, plus the track gain
+function panGains(pan) {
+  const p = Math.max(-1, Math.min(1, pan ?? 0));
+  const x = (p <= 0 ? p + 1 : p) * 0.5 * Math.PI;
+  return { left: p <= 0, cos: Math.cos(x), sin: Math.sin(x) };
+}
+
+const CENTER_PAN = panGains(0);
+
+// Adds a panned track block into an interleaved stereo buffer at `offset` frames
+function mixTrack(out, offset, inL, inR, pan, gain, frames) {
+  if (!gain) return;
+  let o = offset * 2;
+  if (pan.left) {
+    for (let i = 0; i < frames; i++, o += 2) {
+      out[o] += gain * (inL[i] + inR[i] * pan.cos);
+      out[o + 1] += gain * inR[i] * pan.sin;
+    }
+  } else {
+    for (let i = 0; i < frames; i++, o += 2) {
+      out[o] += gain * inL[i] * pan.cos;
+      out[o + 1] += gain * (inR[i] + inL[i] * pan.sin);
+    }
+  }
+}
+
+// Renders `song` (from parseMidiBuffer) and hands interleaved stereo float
+// chunks of about chunkSec to `await onChunk({ index, frames, mix | stems })`:
+// `mix` is the sum of all tracks plus the engine's reverb and chorus return,
+// `stems` one array per entry in `tracks` (dry: the return belongs to no
+// single track).
+// onChunk may return a promise to apply backpressure. onProgress is
+// throttled to onProgressSec of wall time. Options:
+//   wasmBinary, glueCode, basePath   DSP module, as in processorOptions
+//   sampleBank                       { id, smpl } from createSampleBank
+//   presets                          { [presetIndex]: packed region table }
+//   tracks                           [{ trackIndex, presetIndex, override,
+//                                       programs: [{ sec, presetIndex }],
+//                                       cc: { cc7Volume, cc10Pan, cc11Expression },
+//                                       pan, gain }]
+//   stems, sampleRate, blockFrames, tailSec, chunkSec, controlInterval, interpolation
+// Workers rendering different tracks of one song must share song, sampleRate,
+// blockFrames, tailSec and chunkSec so their chunks line up.
+// Returns { frames, durationSec, wallSec, realtimeFactor }.
+export async function renderSongOffline(song, options, onChunk, onProgress) {
+  const {
+    wasmBinary, glueCode, basePath, sampleBank, presets = {}, tracks = [],
+    stems = false, sampleRate = 48000, blockFrames = 512, tailSec = 2, controlInterval, interpolation,
+    chunkSec = 1, onProgressSec = 0.25,
+  } = options;
+  const Processor = await loadProcessorClass();
+  globalThis.sampleRate = sampleRate;
+  globalThis.currentFrame = 0;
+
+  // One processor per 16 tracks, each track on its own channel/output
+  const parts = [];
+  for (let p = 0; p * PART_CHANNELS < tracks.length; p++) {
+    const proc = new Processor({
+      processorOptions: {
+        wasmBinary, glueCode, basePath, perChannelOutputs: true, effectsReturn: !stems,
+        maxVoices: OFFLINE_MAX_VOICES, controlInterval, interpolation, statsInterval: 0,
+      },
+    });
+    await proc.initPromise;
+    if (proc.initError) throw proc.initError;
+    proc.onMsg({ type: "setSampleBank", bankId: sampleBank?.id ?? null, smpl: sampleBank?.smpl });
+    const channels = Math.min(PART_CHANNELS, tracks.length - p * PART_CHANNELS);
+    // One more output for the effects return after the channels
+    const outputs = Array.from({ length: channels + (stems ? 0 : 1) }, () => [
+      new Float32Array(blockFrames),
+      new Float32Array(blockFrames),
+    ]);
+    parts.push({ proc, outputs, states: [] });
+  }
+
+  // Note events are decoded from the song's MIDI bytes a chunk at a time and
+  // routed by track; tracks rendered by other workers are skipped
+  const stream = new MidiEventStream(song.eventSource);
+  const stateByTrack = new Map();
+  const states = tracks.map((t, i) => {
+    const part = parts[Math.floor(i / PART_CHANNELS)];
+    const channel = i % PART_CHANNELS;
+    const state = {
+      part,
+      channel,
+      programs: t.override ? [] : [...(t.programs ?? [])].sort((a, b) => a.sec - b.sec),
+      nextProgram: 0,
+      pan: panGains(t.pan),
+      gain: t.gain ?? 1,
+    };
+    part.states.push(state);
+    part.proc.onMsg({ type: "setPreset", channel, regions: presets[t.presetIndex] ?? null });
+    if (t.cc) part.proc.onMsg({ type: "setControllers", channel, ...t.cc });
+    // The return skips the track gain, so the sends carry it (muted tracks send nothing)
+    const sends = Math.max(0, Math.min(1, state.gain));
+    part.proc.onMsg({ type: "setSends", channel, reverb: sends, chorus: sends });
+    stateByTrack.set(t.trackIndex, state);
+    return state;
+  });
+
+  const durationSec = Math.max(0, song.durationSec ?? 0) + tailSec;
+  const totalFrames = Math.ceil(durationSec * sampleRate);
+  const chunkFrames = Math.max(blockFrames, Math.round(chunkSec * sampleRate / blockFrames) * blockFrames);
+  const newChunk = () => (stems
+    ? states.map(() => new Float32Array(chunkFrames * 2))
+    : [new Float32Array(chunkFrames * 2)]);
+  let buffers = newChunk();
+  let chunkOffset = 0; // frames written into the current chunk
+  let chunkIndex = 0;
+
+  const t0 = performance.now();
+  let lastProgress = t0;
+  for (let frame = 0; frame < totalFrames; frame += blockFrames) {
+    const frames = Math.min(blockFrames, totalFrames - frame);
+    const blockEnd = frame + frames;
+
+    // Deliver the notes due in this block; the engine places them exactly
+    for (let slot = stream.peek(); slot >= 0; slot = stream.peek()) {
+      const evFrame = Math.round(stream.sec[slot] * sampleRate);
+      if (evFrame >= blockEnd) break;
+      stream.advance();
+      const state = stateByTrack.get(stream.track[slot]);
+      if (!state) continue;
+      const { proc } = state.part;
+      const note = stream.data1[slot];
+      if (stream.type[slot] === STREAM_NOTE_ON) {
+        proc.onMsg({ type: "noteOn", channel: state.channel, note, velocity: stream.data2[slot], frame: evFrame });
+      } else if (stream.type[slot] === STREAM_NOTE_OFF) {
+        proc.onMsg({ type: "noteOff", channel: state.channel, note, frame: evFrame });
+      }
+    }
+
+    // Program changes are not engine events, so a part renders up to the
+    // next change's frame, swaps the preset and carries on from there; a
+    // change lands before notes at its own frame
+    for (const part of parts) {
+      if (frames !== blockFrames) {
+        part.outputs = part.outputs.map(() => [new Float32Array(frames), new Float32Array(frames)]);
+      }
+      for (let start = 0; start < frames;) {
+        let end = frames;
+        for (const state of part.states) {
+          while (state.nextProgram < state.programs.length) {
+            const at = Math.round(state.programs[state.nextProgram].sec * sampleRate) - frame;
+            if (at > start) {
+              end = Math.min(end, at);
+              break;
+            }
+            const change = state.programs[state.nextProgram++];
+            part.proc.onMsg({ type: "setPreset", channel: state.channel, regions: presets[change.presetIndex] ?? null });
+          }
+        }
+        globalThis.currentFrame = frame + start;
+        part.proc.process([], start === 0 && end === frames
+          ? part.outputs
+          : part.outputs.map(([l, r]) => [l.subarray(start, end), r.subarray(start, end)]));
+        start = end;
+      }
+    }
+    for (let t = 0; t < states.length; t++) {
+      const state = states[t];
+      const [l, r] = state.part.outputs[state.channel];
+      mixTrack(buffers[stems ? t : 0], chunkOffset, l, r, state.pan, state.gain, frames);
+    }
+    if (!stems) {
+      for (const part of parts) {
+        const [l, r] = part.outputs[part.outputs.length - 1];
+        mixTrack(buffers[0], chunkOffset, l, r, CENTER_PAN, 1, frames);
+      }
+    }
+
+    chunkOffset += frames;
+    if (chunkOffset === chunkFrames || blockEnd === totalFrames) {
+      const out = buffers.map((buf) => (chunkOffset === chunkFrames ? buf : buf.subarray(0, chunkOffset * 2)));
+      await onChunk(stems
+        ? { index: chunkIndex, frames: chunkOffset, stems: out }
+        : { index: chunkIndex, frames: chunkOffset, mix: out[0] });
+      chunkIndex += 1;
+      buffers = newChunk();
+      chunkOffset = 0;
+    }
+
+    const now = performance.now();
+    if (onProgress && now - lastProgress >= onProgressSec * 1000) {
+      lastProgress = now;
+      const renderedSec = blockEnd / sampleRate;
+      onProgress({ sec: renderedSec, durationSec, realtimeFactor: renderedSec / ((now - t0) / 1000) });
+    }
+  }
+
+  const wallSec = (performance.now() - t0) / 1000;
+  return { frames: totalFrames, durationSec, wallSec, realtimeFactor: durationSec / Math.max(wallSec, 1e-9) };
+}
@@ -0,0 +1,83 @@
+// preset-cache.js
+//
+// Built region tables keyed by (bank, program), shared by every track that
+// plays the program and evicted least-recently-used once the tables held
+// exceed maxBytes. Entries are promises, so concurrent requests for a
+// program that is still being built in the parser worker share one build.
+// A table's cost is its packed column bytes; the sample data it references
+// stays in the sample bank either way.
+export const PRESET_CACHE_DEFAULT_BYTES = 4 * 1024 * 1024;
+
+function tableBytes(table) {
+  return (table?.ints?.byteLength ?? 0) + (table?.floats?.byteLength ?? 0);
+}
+
+export class PresetCache {
+  constructor({ maxBytes = PRESET_CACHE_DEFAULT_BYTES } = {}) {
+    this.maxBytes = maxBytes;
+    this.entries = new Map(); // key -> { promise, bytes }, oldest first
+    this.bytes = 0;
+    this.hits = 0;
+    this.misses = 0;
+    this.evictions = 0;
+  }
+
+  // Resolves to the table for `key`, calling build() -> Promise<table> on a miss
+  get(key, build) {
+    const entry = this.entries.get(key);
+    if (entry) {
+      this.hits++;
+      // Re-inserting moves the key to the most-recently-used end
+      this.entries.delete(key);
+      this.entries.set(key, entry);
+      return entry.promise;
+    }
+    this.misses++;
+    const created = { promise: null, bytes: 0 };
+    created.promise = build().then(
+      (table) => {
+        if (this.entries.get(key) === created) {
+          created.bytes = tableBytes(table);
+          this.bytes += created.bytes;
+          this.evict(key);
+        }
+        return table;
+      },
+      (err) => {
+        // Not cached, so the next request retries
+        if (this.entries.get(key) === created) this.entries.delete(key);
+        throw err;
+      }
+    );
+    this.entries.set(key, created);
+    return created.promise;
+  }
+
+  // Drops least-recently-used entries until the cap holds; `keep` (the entry
+  // just built) and builds still in flight stay
+  evict(keep) {
+    for (const [key, entry] of this.entries) {
+      if (this.bytes <= this.maxBytes) break;
+      if (key === keep || !entry.bytes) continue;
+      this.entries.delete(key);
+      this.bytes -= entry.bytes;
+      this.evictions++;
+    }
+  }
+
+  clear() {
+    this.entries.clear();
+    this.bytes = 0;
+  }
+
+  stats() {
+    return {
+      entries: this.entries.size,
+      bytes: this.bytes,
+      maxBytes: this.maxBytes,
+      hits: this.hits,
+      misses: this.misses,
+      evictions: this.evictions,
+    };
+  }
+}
@@ -0,0 +1,65 @@
+// sf2-client.js
+//
+// Main-thread handle on sf2-parser.worker.js, which owns the parsed SoundFont
+// so that loading a bank or building a preset's regions never blocks React.
+// load() resolves to a lightweight view of the bank for the UI:
+//   { info, pdta, sdta: { smpl }, sharedSamples }
+// regions() resolves to a preset's packed region table (packRegions) and
+// preview() to its first region with Float32 sample data. Replies are matched
+// to requests by id; a load() rejects anything still pending for the previous
+// bank.
+export function createSf2Client() {
+  const worker = new Worker(new URL("./sf2-parser.worker.js", import.meta.url), { type: "module" });
+  const pending = new Map(); // id -> { resolve, reject }
+  let nextId = 1;
+
+  function rejectAll(message) {
+    for (const req of pending.values()) req.reject(new Error(message));
+    pending.clear();
+  }
+
+  worker.onmessage = (event) => {
+    const msg = event.data;
+    const req = pending.get(msg.id);
+    if (!req) return;
+    pending.delete(msg.id);
+    if (msg.type === "error") req.reject(new Error(msg.message));
+    else req.resolve(msg);
+  };
+  worker.onerror = (event) => {
+    rejectAll(event.message || "SoundFont worker error");
+  };
+
+  function request(msg, transfer = []) {
+    const id = nextId++;
+    return new Promise((resolve, reject) => {
+      pending.set(id, { resolve, reject });
+      worker.postMessage({ ...msg, id }, transfer);
+    });
+  }
+
+  return {
+    // Takes ownership of u8.buffer (transferred to the worker)
+    async load(u8) {
+      rejectAll("SoundFont replaced");
+      const buffer = u8.byteOffset === 0 && u8.byteLength === u8.buffer.byteLength
+        ? u8.buffer
+        : u8.slice().buffer;
+      const { info, pdta, smpl, shared } = await request({ type: "load", buffer }, [buffer]);
+      return { info, pdta, sdta: { smpl }, sharedSamples: shared };
+    },
+
+    async regions(presetIndex, options = {}) {
+      return (await request({ type: "regions", presetIndex, options })).table;
+    },
+
+    async preview(presetIndex) {
+      return (await request({ type: "preview", presetIndex })).region;
+    },
+
+    terminate() {
+      rejectAll("SoundFont worker terminated");
+      worker.terminate();
+    },
+  };
+}
@@ -9,6 +9,16 @@
  * Then provides helpers to:
  *  - getPreset(presetIndex)
  *  - buildRegionsForPreset(presetIndex, options) -> regions suitable for AudioWorklet
+ *    (decodeToFloat32: false references sdta.smpl by offset instead of copying samples)
+ *  - packRegions(regions) -> packed column table the engine loads in one call
+ *
+ * Parsing only indexes: smpl stays a view into the file and pdta records are
+ * small, so load time does not grow with the amount of sample data. Sample
+ * work happens on demand per sample range and is cached on the sf2 object:
+ * the peak-normalization gain is computed the first time a region uses the
+ * range, and Float32 data (decodeToFloat32) is converted in one pass the
+ * first time region.sample.dataL/dataR is read, into a cache bounded to
+ * DECODED_CACHE_BYTES (least recently read ranges go first).
  *
  * Notes:
  *  - SF2 generators are in SoundFont "generator operators". We parse raw gen records.
@@ -67,6 +77,11 @@ export function parseSF2(u8) {
 
     validatePDTA(sf2.pdta);
 
+    // Lazy per-range caches (see decodeSampleData)
+    sf2.rangeGains = new Map(); // "start:end" -> gain
+    sf2.decodedSamples = new Map(); // "start:end:normalize" -> Float32Array, oldest read first
+    sf2.decodedBytes = 0;
+
     // Public helpers attached
     sf2.getPreset = (presetIndex) => getPreset(sf2.pdta, presetIndex);
     sf2.buildRegionsForPreset = (presetIndex, options = {}) =>
@@ -448,6 +463,68 @@ function buildRegionsForPreset(sf2, presetIndex, options = {}) {
     return regions;
 }
 
+/**
+ * Packed region table: the engine's per-region fields with every default
+ * resolved, as two column-major arrays (column c of region i at
+ * [c * count + i]) that dsp.c loads with one synthLoadRegions call. Offsets,
+ * ranges and loop points are exact integers, so they live in the Int32 columns.
+ * Column order must match REGION_COL_* / REGION_FCOL_* in dsp.h.
+ */
+export const REGION_INT_COLUMNS = [
+    "keyLo", "keyHi", "velLo", "velHi",
+    "offsetL", "length", "offsetR", "lengthR",
+    "loopStart", "loopEnd", "sampleModes", "rootKey", "exclusiveClass",
+];
+export const REGION_FLOAT_COLUMNS = [
+    "gainL", "gainR", "sampleRate",
+    "scaleTuning", "coarseTune", "fineTune",
+    "attenuationCb", "pan",
+    "volDelayTc", "volAttackTc", "volHoldTc", "volDecayTc", "volSustainCb", "volReleaseTc",
+    "modDelayTc", "modAttackTc", "modHoldTc", "modDecayTc", "modSustain", "modReleaseTc",
+    "initialFilterFcCents", "modEnvToFilterFcCents", "modLfoToFilterFcCents",
+    "modLfoDelayTc", "modLfoFreqCents", "modLfoToPitchCents",
+    "vibLfoDelayTc", "vibLfoFreqCents", "vibLfoToPitchCents",
+    "chorusSend", "reverbSend",
+];
+
+/**
+ * Packs regions built with decodeToFloat32: false into { count, ints, floats }.
+ * Regions without sample data in the bank are dropped.
+ */
+export function packRegions(regions) {
+    const playable = regions.filter((r) => r.sample?.smplOffset != null && r.sample.end > 0);
+    const count = playable.length;
+    const ints = new Int32Array(REGION_INT_COLUMNS.length * count);
+    const floats = new Float32Array(REGION_FLOAT_COLUMNS.length * count);
+
+    for (let i = 0; i < count; i++) {
+        const r = playable[i];
+        const s = r.sample;
+        const row = [
+            r.keyRange[0], r.keyRange[1], r.velRange[0], r.velRange[1],
+            s.smplOffset, s.end, s.smplOffsetR ?? -1, s.smplOffsetR != null ? s.lengthR : 0,
+            s.loopStart, s.loopEnd, r.sampleModes, r.overridingRootKey ?? r.originalKey, r.exclusiveClass,
+        ];
+        for (let c = 0; c < row.length; c++) ints[c * count + i] = row[c];
+
+        const frow = [
+            s.gain, s.gainR, s.sampleRate || 44100,
+            r.scaleTuning, r.coarseTune, r.fineTune,
+            r.initialAttenuationCb, r.pan,
+            r.volEnv.delayTc, r.volEnv.attackTc, r.volEnv.holdTc,
+            r.volEnv.decayTc, r.volEnv.sustainCb, r.volEnv.releaseTc,
+            r.modEnv.delayTc, r.modEnv.attackTc, r.modEnv.holdTc,
+            r.modEnv.decayTc, r.modEnv.sustain, r.modEnv.releaseTc,
+            r.initialFilterFcCents, r.modEnvToFilterFcCents, r.modLfoToFilterFcCents,
+            r.modLfoDelayTc, r.modLfoFreqCents, r.modLfoToPitchCents,
+            r.vibLfoDelayTc, r.vibLfoFreqCents, r.vibLfoToPitchCents,
+            r.chorusSend, r.reverbSend,
+        ];
+        for (let c = 0; c < frow.length; c++) floats[c * count + i] = frow[c];
+    }
+    return { count, ints, floats };
+}
+
 function getInstrument(pdta, instIndex) {
     const inst = pdta.inst;
     const last = inst.length - 1;
@@ -538,9 +615,10 @@ function makeRegionFromMerged(sf2, g, opts) {
     loopEnd = clampU32(loopEnd, 0, smplI16.length);
     if (end <= start) return null;
 
-    // Decode to Float32 for WebAudio (recommended)
-    // We do per-region extraction (copy) because regions are independent.
-    const { dataL, dataR } = decodeSampleData(sf2, sh, { start, end }, opts);
+    // Either decode to per-region Float32 copies (previews/WebAudio) or reference the
+    // shared smpl chunk by offset (engine path, converted on the fly).
+    const decoded = decodeSampleData(sf2, sampleID, { start, end }, opts);
+    const length = end - start;
 
     // Ranges
     const keyRange = g[Gen.keyRange] != null ? unpackRange(g[Gen.keyRange]) : [0, 127];
@@ -586,13 +664,12 @@ function makeRegionFromMerged(sf2, g, opts) {
         velRange,
 
         sample: {
-            dataL,
-            dataR,
+            ...decoded.fields,
             sampleRate: sh.sampleRate,
             start: 0,
-            end: dataL.length,
-            loopStart: Math.max(0, Math.min(loopStart - start, dataL.length)),
-            loopEnd: Math.max(0, Math.min(loopEnd - start, dataL.length)),
+            end: length,
+            loopStart: Math.max(0, Math.min(loopStart - start, length)),
+            loopEnd: Math.max(0, Math.min(loopEnd - start, length)),
         },
         sampleModes: g[Gen.sampleModes] ?? 0,
 
@@ -622,8 +699,14 @@ function makeRegionFromMerged(sf2, g, opts) {
         vibLfoToPitchCents: g[Gen.vibLfoToPitch] ?? 0,
 
         exclusiveClass: g[Gen.exclusiveClass] ?? 0,
+
+        // Effects sends, 0.1% units (0..1000)
+        chorusSend: Math.max(0, Math.min(1000, g[Gen.chorusEffectsSend] ?? 0)),
+        reverbSend: Math.max(0, Math.min(1000, g[Gen.reverbEffectsSend] ?? 0)),
     };
 
+    if (decoded.lazyData) decoded.lazyData(region.sample);
+
     // Basic loop sanity: if loop points invalid, disable loop
     if (!(region.sample.loopEnd > region.sample.loopStart + 1)) {
         region.sampleModes = 0;
@@ -640,9 +723,10 @@ function computeAddressOffset(g, fineOp, coarseOp) {
     return fine + coarse * 32768;
 }
 
-function decodeSampleData(sf2, sh, range, opts) {
+function decodeSampleData(sf2, sampleID, range, opts) {
     const { sdta, pdta } = sf2;
     const { decodeToFloat32, normalize, includeStereoLinks } = opts;
+    const sh = pdta.shdr[sampleID];
 
     const start = range.start;
     const end = range.end;
@@ -658,47 +742,96 @@ function decodeSampleData(sf2, sh, range, opts) {
         if (other && other.sampleRate === sh.sampleRate) linked = other;
     }
 
-    if (!decodeToFloat32) {
-        // You can also keep Int16 and convert in worklet; Float32 is more convenient.
-        // Here we still return Float32 to match the worklet code you already have.
-        throw new Error("decodeToFloat32=false not implemented in this minimal parser");
+    // Try to infer stereo pair: use linked sample's start/end as given by its shdr
+    // BUT region offsets are not mirrored here; real SF2 uses separate zones for L/R.
+    // This is "best effort".
+    let rangeR = null;
+    if (linked) {
+        const sR = clampU32(linked.start, 0, sdta.smpl.length);
+        const eR = clampU32(linked.end, 0, sdta.smpl.length);
+        if (eR > sR) rangeR = { start: sR, end: eR };
     }
 
-    const dataL = int16ToFloat32(sdta.smpl, start, end, normalize);
+    const gainL = normalize ? rangeGain(sf2, start, end) : 1;
+    const gainR = rangeR && normalize ? rangeGain(sf2, rangeR.start, rangeR.end) : 1;
 
-    let dataR = null;
-    if (linked) {
-        // Try to infer stereo pair: use linked sample's start/end as given by its shdr
-        // BUT region offsets are not mirrored here; real SF2 uses separate zones for L/R.
-        // This is "best effort".
-        const startR = linked.start;
-        const endR = linked.end;
-        const sR = clampU32(startR, 0, sdta.smpl.length);
-        const eR = clampU32(endR, 0, sdta.smpl.length);
-        if (eR > sR) dataR = int16ToFloat32(sdta.smpl, sR, eR, normalize);
+    if (!decodeToFloat32) {
+        // Zero-copy: offsets into sdta.smpl plus the range's normalization gain
+        return {
+            fields: {
+                smplOffset: start,
+                gain: gainL,
+                smplOffsetR: rangeR ? rangeR.start : null,
+                lengthR: rangeR ? rangeR.end - rangeR.start : 0,
+                gainR,
+            },
+        };
     }
 
-    return { dataL, dataR };
+    // Float32 copies are only made when dataL/dataR is first read
+    return {
+        fields: {},
+        // Non-enumerable so posting regions to the worklet (which reads the
+        // int16 bank by offset) does not decode them
+        lazyData(sample) {
+            Object.defineProperty(sample, "dataL", {
+                enumerable: false,
+                configurable: true,
+                get: () => decodedSample(sf2, start, end, gainL, normalize),
+            });
+            Object.defineProperty(sample, "dataR", {
+                enumerable: false,
+                configurable: true,
+                get: () => (rangeR ? decodedSample(sf2, rangeR.start, rangeR.end, gainR, normalize) : null),
+            });
+        },
+    };
 }
 
-function int16ToFloat32(i16, start, end, normalize) {
-    const n = end - start;
-    const out = new Float32Array(n);
+// Gain that maps a range's peak to full scale (int16 / 32768 * gain). Zones
+// that select a quieter part of a sample are normalized to their own peak;
+// scanned once per range and cached, so program changes never rescan.
+function rangeGain(sf2, start, end) {
+    const key = `${start}:${end}`;
+    const cached = sf2.rangeGains.get(key);
+    if (cached !== undefined) return cached;
+    const smpl = sf2.sdta.smpl;
+    let peak = 0;
+    for (let i = start; i < end; i++) {
+        const v = Math.abs(smpl[i]);
+        if (v > peak) peak = v;
+    }
+    const gain = peak > 0 ? 32768 / peak : 1;
+    sf2.rangeGains.set(key, gain);
+    return gain;
+}
 
-    if (!normalize) {
-        for (let i = 0; i < n; i++) out[i] = i16[start + i] / 32768;
+// Float32 copies kept per parsed font; reading a range again moves it to the
+// back of the Map, and the front is evicted past the limit
+const DECODED_CACHE_BYTES = 64 * 1024 * 1024;
+
+// One-pass int16 -> float conversion with a precomputed gain, cached by range
+function decodedSample(sf2, start, end, gain, normalize) {
+    const key = `${start}:${end}:${normalize ? 1 : 0}`;
+    const cache = sf2.decodedSamples;
+    let out = cache.get(key);
+    if (out) {
+        cache.delete(key);
+        cache.set(key, out);
         return out;
     }
-
-    // Peak normalize to [-1,1] if sample isn't already near full scale
-    let peak = 0;
-    for (let i = 0; i < n; i++) {
-        const v = Math.abs(i16[start + i]);
-        if (v > peak) peak = v;
+    const i16 = sf2.sdta.smpl;
+    const scale = gain / 32768;
+    out = new Float32Array(end - start);
+    for (let i = 0; i < out.length; i++) out[i] = i16[start + i] * scale;
+    if (out.byteLength > DECODED_CACHE_BYTES) return out;
+    sf2.decodedBytes += out.byteLength;
+    for (const [oldKey, old] of cache) {
+        if (sf2.decodedBytes <= DECODED_CACHE_BYTES) break;
+        cache.delete(oldKey);
+        sf2.decodedBytes -= old.byteLength;
     }
-    const denom = peak > 0 ? peak : 32768;
-    const scale = denom / 32768; // convert peak to 1.0 then map to float
-    for (let i = 0; i < n; i++) out[i] = (i16[start + i] / 32768) / scale;
+    cache.set(key, out);
     return out;
 }
 
@@ -0,0 +1,64 @@
+import { packRegions, parseSF2 } from "./sf2-parser.js";
+
+// Hosts parseSF2 off the UI thread. The worker keeps the parsed bank and
+// answers by request id:
+//   load    { buffer }               -> loaded { info, pdta, smpl, shared }
+//   regions { presetIndex, options } -> regions { table } (packRegions output)
+//   preview { presetIndex }          -> preview { region } (first region with
+//                                       Float32 data, for the sample player)
+// The file buffer comes in transferred. smpl goes back as a SharedArrayBuffer
+// view on cross-origin isolated pages (the worklets then map the same memory),
+// otherwise as a transferred copy. Region tables reference smpl by offset,
+// carry no sample data and are transferred, as is preview Float32 data.
+let sf2 = null;
+
+const PREVIEW_OPTIONS = { decodeToFloat32: true, normalize: false, includeStereoLinks: false };
+
+function shareSamples(smpl) {
+  if (!smpl?.length) return { smpl: null, shared: false };
+  if (typeof SharedArrayBuffer === "function" && self.crossOriginIsolated) {
+    const shared = new Int16Array(new SharedArrayBuffer(smpl.byteLength));
+    shared.set(smpl);
+    return { smpl: shared, shared: true };
+  }
+  return { smpl: smpl.slice(), shared: false };
+}
+
+function handle(msg) {
+  if (msg.type === "load") {
+    sf2 = null;
+    const parsed = parseSF2(new Uint8Array(msg.buffer));
+    const { smpl, shared } = shareSamples(parsed.sdta.smpl);
+    sf2 = parsed;
+    const transfer = shared || !smpl ? [] : [smpl.buffer];
+    return [{ type: "loaded", info: parsed.info, pdta: parsed.pdta, smpl, shared }, transfer];
+  }
+  if (!sf2) throw new Error("No SoundFont loaded");
+  if (msg.type === "regions") {
+    const options = { ...msg.options, decodeToFloat32: false };
+    const table = packRegions(sf2.buildRegionsForPreset(msg.presetIndex, options));
+    return [{ type: "regions", table }, [table.ints.buffer, table.floats.buffer]];
+  }
+  if (msg.type === "preview") {
+    const region = sf2
+      .buildRegionsForPreset(msg.presetIndex, PREVIEW_OPTIONS)
+      .find((r) => r.sample?.dataL?.length > 0);
+    if (!region) return [{ type: "preview", region: null }, []];
+    // dataL/dataR are lazy, non-enumerable and cached here; send own copies
+    const dataL = region.sample.dataL.slice();
+    const dataR = region.sample.dataR?.slice() ?? null;
+    const sample = { ...region.sample, dataL, dataR };
+    return [{ type: "preview", region: { ...region, sample } }, dataR ? [dataL.buffer, dataR.buffer] : [dataL.buffer]];
+  }
+  throw new Error(`Unknown message type: ${msg.type}`);
+}
+
+self.onmessage = (event) => {
+  const msg = event.data;
+  try {
+    const [reply, transfer] = handle(msg);
+    self.postMessage({ ...reply, id: msg.id }, transfer);
+  } catch (err) {
+    self.postMessage({ type: "error", id: msg.id, message: err instanceof Error ? err.message : String(err) });
+  }
+};
@@ -6,392 +6,249 @@
 // The WASM module is loaded and initialized from binary data passed to the processor.
 
 // ---------- WASM Integration ----------
+// Every processor in an AudioContext shares this global scope, so the module
+// (and its heap) is instantiated once and shared by all Sf2Processor nodes.
 let dspModule = null;
 let dspReady = false;
+let dspInitPromise = null;
 
 // Initialize WASM module from binary data
 async function initWasmFromBinary(wasmBinary, glueCode, basePath) {
     if (dspReady && dspModule) {
-        return; // Already initialized
+        return dspModule; // Already initialized
+    }
+    if (dspInitPromise) {
+        return dspInitPromise; // Another processor is already instantiating it
     }
     
     if (!wasmBinary || !glueCode) {
         throw new Error('WASM binary and glue code are required');
     }
     
-    // Evaluate glue and get the Emscripten factory (typically DSPModule).
-    // Some glue builds do not expose a top-level "Module" symbol.
-    const createFactory = new Function(
-        `${glueCode}
-        return (typeof DSPModule === "function")
-            ? DSPModule
-            : (typeof Module === "function" ? Module : null);`
-    );
-    const moduleFactory = createFactory();
-    if (typeof moduleFactory !== "function") {
-        throw new Error("WASM glue did not expose a callable module factory");
-    }
-
-    // Initialize the module with the binary
-    dspModule = await moduleFactory({
-        wasmBinary: wasmBinary,
-        locateFile: (path) => {
-            if (basePath) {
-                return basePath + '/' + path;
+    dspInitPromise = (async () => {
+        // Evaluate glue and get the Emscripten factory (typically DSPModule).
+        // Some glue builds do not expose a top-level "Module" symbol.
+        const createFactory = new Function(
+            `${glueCode}
+            return (typeof DSPModule === "function")
+                ? DSPModule
+                : (typeof Module === "function" ? Module : null);`
+        );
+        const moduleFactory = createFactory();
+        if (typeof moduleFactory !== "function") {
+            throw new Error("WASM glue did not expose a callable module factory");
+        }
+
+        // Initialize the module with the binary
+        dspModule = await moduleFactory({
+            wasmBinary: wasmBinary,
+            locateFile: (path) => {
+                if (basePath) {
+                    return basePath + '/' + path;
+                }
+                return path;
             }
-            return path;
-        }
+        });
+        
+        dspReady = true;
+        return dspModule;
+    })();
+    dspInitPromise.catch(() => {
+        dspInitPromise = null; // Allow a later processor to retry
     });
-    
-    dspReady = true;
-    return dspModule;
+    return dspInitPromise;
 }
 
-// Utility functions - WASM only
-function centsToRatio(c) {
+function requireDsp() {
     if (!dspReady || !dspModule) {
         throw new Error('WASM module not initialized');
     }
-    return dspModule._centsToRatio(c ?? 0);
+    return dspModule;
 }
 
-function cbAttenToLin(cb) {
-    if (!dspReady || !dspModule) {
-        throw new Error('WASM module not initialized');
-    }
-    return dspModule._cbAttenToLin(cb ?? 0);
+// ---------- Sample bank ----------
+// The raw SF2 smpl chunk gets a heap block per soundfont; regions reference it
+// by offset and the engine converts int16 on the fly. Banks are keyed by the
+// main thread's bankId and reference counted, so every track processor maps
+// the same copy and a program change never moves samples.
+// The block is filled lazily: a preset's sample ranges are copied in the
+// first time it is loaded, so attaching a 100+ MB bank costs nothing up front.
+// When the page is cross-origin isolated, smpl arrives as an Int16Array over
+// a SharedArrayBuffer and the postMessage itself copies nothing.
+const sampleBanks = new Map(); // bankId -> { ptr, length, refs, smpl, loaded }
+
+function allocateSampleBank(smpl) {
+    const dsp = requireDsp();
+    const ptr = dsp._dspMalloc(smpl.length * 2);
+    if (!ptr) {
+        throw new Error('Failed to allocate WASM sample bank');
+    }
+    return { ptr, length: smpl.length, smpl, loaded: new Set() };
 }
 
-function velToLin(vel, curve = 2.0) {
-    if (!dspReady || !dspModule) {
-        throw new Error('WASM module not initialized');
+function acquireSampleBank(bankId, smpl) {
+    let bank = sampleBanks.get(bankId);
+    if (!bank) {
+        if (!smpl?.length) return null;
+        bank = { ...allocateSampleBank(smpl), refs: 0 };
+        sampleBanks.set(bankId, bank);
     }
-    return dspModule._velToLin(vel, curve);
+    bank.refs++;
+    return bank;
 }
 
-function fcCentsToHz(fcCents) {
-    if (!dspReady || !dspModule) {
-        throw new Error('WASM module not initialized');
-    }
-    return dspModule._fcCentsToHz(fcCents ?? 13500);
+function uploadSampleRange(bank, offset, length) {
+    if (offset == null || offset < 0 || length <= 0) return;
+    const key = `${offset}:${length}`;
+    if (bank.loaded.has(key)) return;
+    const end = Math.min(bank.length, offset + length);
+    // Re-read the heap view: it is replaced whenever linear memory grows
+    dspModule.HEAP16.set(bank.smpl.subarray(offset, end), (bank.ptr >> 1) + offset);
+    bank.loaded.add(key);
 }
 
-function timecentsToSeconds(tc) {
-    if (!dspReady || !dspModule) {
-        throw new Error('WASM module not initialized');
+// Copies the sample data a preset plays into the bank's heap block
+function uploadRegionSamples(bank, table) {
+    const { count, ints } = table;
+    for (let i = 0; i < count; i++) {
+        uploadSampleRange(bank, ints[REGION_COL_OFFSET_L * count + i], ints[REGION_COL_LENGTH * count + i]);
+        uploadSampleRange(bank, ints[REGION_COL_OFFSET_R * count + i], ints[REGION_COL_LENGTH_R * count + i]);
     }
-    return dspModule._timecentsToSeconds(tc ?? 0);
 }
 
-// ---------- WASM Wrapper Classes ----------
-// These classes use WASM only - no fallback
-
-class VolEnvWasm {
-    constructor(sr) {
-        this.sr = sr;
-        this.ptr = null;
-        
-        if (!dspReady || !dspModule) {
-            throw new Error('WASM module not initialized');
-        }
-        
-        this.ptr = dspModule._volEnvCreate(sr);
-        if (!this.ptr) {
-            throw new Error('Failed to create WASM VolEnv');
-        }
-    }
-    
-    setFromSf2(params) {
-        if (!this.ptr || !dspModule) {
-            throw new Error('WASM module not available');
-        }
-        
-        const delayTc = params.delayTc ?? -12000;
-        const attackTc = params.attackTc ?? -12000;
-        const holdTc = params.holdTc ?? -12000;
-        const decayTc = params.decayTc ?? -12000;
-        const sustainCb = params.sustainCb ?? 0;
-        const releaseTc = params.releaseTc ?? 0;
-        
-        dspModule._volEnvSetFromSf2(this.ptr, delayTc, attackTc, holdTc, decayTc, sustainCb, releaseTc);
-    }
-    
-    noteOn() {
-        if (!this.ptr || !dspModule) {
-            throw new Error('WASM module not available');
-        }
-        dspModule._volEnvNoteOn(this.ptr);
-    }
-    
-    noteOff() {
-        if (!this.ptr || !dspModule) {
-            throw new Error('WASM module not available');
-        }
-        dspModule._volEnvNoteOff(this.ptr);
-    }
-    
-    next() {
-        if (!this.ptr || !dspModule) {
-            throw new Error('WASM module not available');
-        }
-        return dspModule._volEnvNext(this.ptr);
-    }
-    
-    get level() {
-        return 0; // Not available in WASM-only mode
-    }
-    
-    get stage() {
-        return 'unknown'; // Not available in WASM-only mode
-    }
+function releaseSampleBank(bankId) {
+    const bank = sampleBanks.get(bankId);
+    if (!bank) return;
+    if (--bank.refs > 0) return;
+    dspModule._dspFree(bank.ptr);
+    sampleBanks.delete(bankId);
 }
 
-class ModEnvWasm {
-    constructor(sr) {
-        this.sr = sr;
-        this.ptr = null;
-        
-        if (!dspReady || !dspModule) {
-            throw new Error('WASM module not initialized');
-        }
-        
-        this.ptr = dspModule._modEnvCreate(sr);
-        if (!this.ptr) {
-            throw new Error('Failed to create WASM ModEnv');
-        }
-    }
-    
-    setFromSf2(params) {
-        if (!this.ptr || !dspModule) {
-            throw new Error('WASM module not available');
-        }
-        
-        const delayTc = params.delayTc ?? -12000;
-        const attackTc = params.attackTc ?? -12000;
-        const holdTc = params.holdTc ?? -12000;
-        const decayTc = params.decayTc ?? -12000;
-        const sustain = params.sustain ?? 0;
-        const releaseTc = params.releaseTc ?? 0;
-        
-        dspModule._modEnvSetFromSf2(this.ptr, delayTc, attackTc, holdTc, decayTc, sustain, releaseTc);
-    }
-    
-    noteOn() {
-        if (!this.ptr || !dspModule) {
-            throw new Error('WASM module not available');
-        }
-        dspModule._modEnvNoteOn(this.ptr);
-    }
-    
-    noteOff() {
-        if (!this.ptr || !dspModule) {
-            throw new Error('WASM module not available');
-        }
-        dspModule._modEnvNoteOff(this.ptr);
-    }
-    
-    next() {
-        if (!this.ptr || !dspModule) {
-            throw new Error('WASM module not available');
-        }
-        return dspModule._modEnvNext(this.ptr);
-    }
-    
-    get level() {
-        return 0; // Not available in WASM-only mode
-    }
-    
-    get stage() {
-        return 'unknown'; // Not available in WASM-only mode
+// ---------- Regions ----------
+// Presets arrive as packed region tables from sf2-parser.js packRegions:
+// { count, ints, floats }, column-major with every default resolved. The
+// column counts and the sample columns read above must match dsp.c.
+const REGION_INT_COLUMNS = 13;
+const REGION_FLOAT_COLUMNS = 31;
+const REGION_COL_OFFSET_L = 4;
+const REGION_COL_LENGTH = 5;
+const REGION_COL_OFFSET_R = 6;
+const REGION_COL_LENGTH_R = 7;
+const EMPTY_REGION_TABLE = { count: 0, ints: new Int32Array(0), floats: new Float32Array(0) };
+
+// Heap staging area for tables, grown as needed and shared by all processors
+let regionScratch = { ptr: 0, bytes: 0 };
+
+// Copies a packed table into the heap and loads it into one channel's region
+// table with a single engine call (which also compiles its key/velocity index).
+function loadRegions(synthPtr, channel, table) {
+    const dsp = requireDsp();
+    const { count, ints, floats } = table;
+    const intBytes = REGION_INT_COLUMNS * count * 4;
+    const bytes = intBytes + REGION_FLOAT_COLUMNS * count * 4;
+    if (bytes > regionScratch.bytes) {
+        if (regionScratch.ptr) dsp._dspFree(regionScratch.ptr);
+        const ptr = dsp._dspMalloc(bytes);
+        regionScratch = { ptr, bytes: ptr ? bytes : 0 };
+    }
+    const ptr = regionScratch.ptr;
+    if (count > 0 && !ptr) {
+        throw new Error('Failed to allocate WASM region table');
+    }
+    if (count > 0) {
+        dsp.HEAP32.set(ints, ptr >> 2);
+        dsp.HEAPF32.set(floats, (ptr + intBytes) >> 2);
+    }
+    if (!dsp._synthLoadRegions(synthPtr, channel, ptr, ptr + intBytes, count)) {
+        throw new Error('Failed to allocate WASM region table');
     }
 }
 
-class LFOWasm {
-    constructor(sr) {
-        this.sr = sr;
-        this.ptr = null;
-        
-        if (!dspReady || !dspModule) {
-            throw new Error('WASM module not initialized');
-        }
-        
-        this.ptr = dspModule._lfoCreate(sr);
-        if (!this.ptr) {
-            throw new Error('Failed to create WASM LFO');
-        }
-    }
-    
-    set(freqHz, delaySec) {
-        if (!this.ptr || !dspModule) {
-            throw new Error('WASM module not available');
-        }
-        dspModule._lfoSet(this.ptr, freqHz ?? 0, delaySec ?? 0);
-    }
-    
-    next() {
-        if (!this.ptr || !dspModule) {
-            throw new Error('WASM module not available');
-        }
-        return dspModule._lfoNext(this.ptr);
-    }
-}
-
-class TwoPoleLPFWasm {
-    constructor(sr) {
-        this.sr = sr;
-        this.ptr = null;
-        
-        if (!dspReady || !dspModule) {
-            throw new Error('WASM module not initialized');
-        }
-        
-        this.ptr = dspModule._lpfCreate(sr);
-        if (!this.ptr) {
-            throw new Error('Failed to create WASM LPF');
-        }
-    }
-    
-    setCutoffHz(hz) {
-        if (!this.ptr || !dspModule) {
-            throw new Error('WASM module not available');
-        }
-        dspModule._lpfSetCutoffHz(this.ptr, hz ?? 1000);
-    }
-    
-    processL(x) {
-        if (!this.ptr || !dspModule) {
-            throw new Error('WASM module not available');
-        }
-        return dspModule._lpfProcessL(this.ptr, x);
-    }
-    
-    processR(x) {
-        if (!this.ptr || !dspModule) {
-            throw new Error('WASM module not available');
-        }
-        return dspModule._lpfProcessR(this.ptr, x);
-    }
-}
-
-// ---------- Utility Functions ----------
-
-function panToGains(pan) {
-    // SF2 pan: -500..+500
-    const p = Math.max(-500, Math.min(500, pan ?? 0)) / 500; // -1..+1
-    const angle = (p + 1) * 0.25 * Math.PI; // 0..pi/2
-    return { gL: Math.cos(angle), gR: Math.sin(angle) };
-}
-
-function balanceToGains(balance) {
-    const p = Math.max(-1, Math.min(1, balance ?? 0));
-    const angle = (p + 1) * 0.25 * Math.PI;
-    return { gL: Math.cos(angle), gR: Math.sin(angle) };
+// ---------- Processor ----------
+// One processor is a 16-channel multitimbral synth: channel is a field on
+// setPreset/noteOn/noteOff/allNotesOff/setControllers (default 0), all
+// channels share one voice budget and are mixed by a single render call.
+// With processorOptions.perChannelOutputs, output N carries channel N instead;
+// adding effectsReturn makes the last output the shared reverb and chorus
+// return, which belongs to no channel (without it those outputs are dry).
+// setSends { channel, reverb, chorus } scales a channel's effects sends (0..1).
+const SYNTH_CHANNELS = 16;
+
+function clampChannel(channel) {
+    const c = channel | 0;
+    return c < 0 ? 0 : (c >= SYNTH_CHANNELS ? SYNTH_CHANNELS - 1 : c);
 }
 
-// ---------- Pitch ----------
-function regionBaseRate(region, midiNote, outSr) {
-    const root = (region.overridingRootKey ?? region.originalKey ?? 60);
-    const scale = (region.scaleTuning ?? 100);
-    const keyTrackCents = (midiNote - root) * scale;
-    const tuneCents = (region.coarseTune ?? 0) * 100 + (region.fineTune ?? 0);
-    const totalCents = keyTrackCents + tuneCents;
-
-    const srRatio = (region.sample.sampleRate ?? outSr) / outSr;
-    return centsToRatio(totalCents) * srRatio;
+function clampCc(value) {
+    return Math.max(0, Math.min(127, value | 0));
 }
 
-// ---------- Sample read (linear interpolation) ----------
-function readSampleMono(data, pos) {
-    const i = pos | 0;
-    const f = pos - i;
-    const a = data[i] ?? 0;
-    const b = data[i + 1] ?? 0;
-    return a + (b - a) * f;
+// ---------- Timed events ----------
+// noteOn/noteOff/allNotesOff/setControllers may carry `frame`, an absolute
+// audio-clock frame (the currentFrame timebase). They wait here until their
+// quantum renders and are then queued in the engine at their offset inside
+// it, so timing does not depend on when the message happened to arrive.
+const SYNTH_EVENT_NOTE_ON = 0;
+const SYNTH_EVENT_NOTE_OFF = 1;
+const SYNTH_EVENT_ALL_NOTES_OFF = 2;
+const SYNTH_EVENT_CONTROLLERS = 3;
+
+const TIMED_TYPES = new Set(["noteOn", "noteOff", "allNotesOff", "setControllers"]);
+
+// Shared-memory event ring written by midi-timer.worker.js (layout and writer
+// in event-ring.js; this file has no imports, so the reader lives here).
+// Records go straight into the engine queue with their offset from
+// currentFrame; future ones carry over inside the engine, so the ring is
+// drained completely unless that queue fills up.
+const RING_HEADER_WORDS = 4;
+const RING_RECORD_WORDS = 4;
+const RING_WRITE = 0;
+const RING_READ = 1;
+const RING_CAPACITY = 3;
+
+// ---------- Stats ----------
+// The engine's SynthStats (dsp.h): doubles in this order. Every statsInterval
+// seconds of audio (processorOptions, default 1, 0 = off) the processor reads
+// them, resets them and posts a summary:
+//   { type: "stats", seconds, blocks, load, loadPeak, eventLoad, voiceLoad,
+//     mixLoad, effectLoad, voicesAvg, voicesPeak, voicesStolen, voicesCut,
+//     eventsQueuedPeak, eventsRejected }
+// Loads are render time over audio time (1 = the whole quantum budget); they
+// are null when the scope has no performance clock to time the stages with.
+const SYNTH_STATS_FIELDS = [
+    "blocks", "frames", "voicesPeak", "voicesSum", "voicesStolen", "voicesCut",
+    "eventsQueuedPeak", "eventsRejected", "renderSeconds", "eventSeconds",
+    "voiceSeconds", "mixSeconds", "loadPeak", "effectSeconds",
+];
+
+function readStats(synthPtr) {
+    // Re-read the heap view: it is replaced whenever linear memory grows
+    const base = dspModule._synthGetStats(synthPtr) >> 3;
+    const heap = dspModule.HEAPF64;
+    const stats = {};
+    SYNTH_STATS_FIELDS.forEach((name, i) => {
+        stats[name] = heap[base + i];
+    });
+    return stats;
 }
 
-// ---------- Voice ----------
-function makeVoice(region, note, velocity, outSr) {
-    const sample = region.sample;
-    const start = sample.start ?? 0;
-    const end = sample.end ?? sample.dataL.length;
-    const loopStart = sample.loopStart ?? start;
-    const loopEnd = sample.loopEnd ?? end;
-
-    const sampleModes = region.sampleModes ?? 0;
-    const looping = sampleModes === 1 || sampleModes === 3;
-    const loopUntilReleaseThenTail = sampleModes === 3;
-
-    const baseRate = regionBaseRate(region, note, outSr);
-
-    const panG = panToGains(region.pan ?? 0);
-    const velGain = velToLin(velocity, 2.0);
-    const attenGain = cbAttenToLin(region.initialAttenuationCb ?? 0);
-    const baseGain = velGain * attenGain;
-
-    const v = {
-        note,
-        velocity,
-        region,
-
-        // playback
-        pos: start,
-        baseRate,
-        rate: baseRate,
-
-        // loop data in frames
-        start,
-        end,
-        loopStart,
-        loopEnd,
-        looping,
-        loopUntilReleaseThenTail,
-        inReleaseTail: false,
-
-        // sample buffers
-        dataL: sample.dataL,
-        dataR: sample.dataR, // null => mono
-
-        // gains
-        baseGain,
-        regionPanPos: Math.max(-500, Math.min(500, region.pan ?? 0)) / 500,
-        panL: panG.gL,
-        panR: panG.gR,
-
-        // mod - using WASM-only classes
-        volEnv: new VolEnvWasm(outSr),
-        modEnv: new ModEnvWasm(outSr),
-        modLfo: new LFOWasm(outSr),
-        vibLfo: new LFOWasm(outSr),
-        lpf: new TwoPoleLPFWasm(outSr),
-
-        exclusiveClass: region.exclusiveClass ?? 0,
-        finished: false,
-    };
-
-    v.volEnv.setFromSf2(region.volEnv ?? {});
-    v.modEnv.setFromSf2(region.modEnv ?? {});
-
-    const modLfoHz = centsToRatio(region.modLfoFreqCents ?? 0); // starter mapping
-    const vibLfoHz = centsToRatio(region.vibLfoFreqCents ?? 0);
-    v.modLfo.set(modLfoHz, timecentsToSeconds(region.modLfoDelayTc ?? -12000));
-    v.vibLfo.set(vibLfoHz, timecentsToSeconds(region.vibLfoDelayTc ?? -12000));
-
-    // initial filter cutoff
-    v.lpf.setCutoffHz(fcCentsToHz(region.initialFilterFcCents ?? 13500));
-
-    v.volEnv.noteOn();
-    v.modEnv.noteOn();
-    return v;
+function insertTimed(queue, msg) {
+    // Stable insert by frame; the worker sends in order so this is usually a push
+    let i = queue.length;
+    while (i > 0 && queue[i - 1].frame > msg.frame) i--;
+    queue.splice(i, 0, msg);
 }
 
-// ---------- Processor ----------
 class Sf2Processor extends AudioWorkletProcessor {
     constructor(options) {
         super(options);
         
         // Initialize WASM from the options
         const processorOptions = options?.processorOptions || {};
-        const { wasmBinary, glueCode, basePath } = processorOptions;
+        const {
+            wasmBinary, glueCode, basePath, perChannelOutputs, effectsReturn, maxVoices, controlInterval,
+            interpolation, eventRing, statsInterval,
+        } = processorOptions;
         
         // Initialize WASM synchronously - this will throw if it fails
         if (wasmBinary && glueCode) {
@@ -417,16 +274,46 @@ class Sf2Processor extends AudioWorkletProcessor {
             throw new Error('WASM binary and glue code must be provided in processorOptions');
         }
         
-        this.regions = []; // current preset regions
-        this.voices = [];
-        this.maxVoices = 64;
-        this.cc7Volume = 100;
-        this.cc10Pan = 64;
-        this.cc11Expression = 127;
+        this.synth = 0; // WASM Synth: voice pool, region table and mixer
+        this.sampleBankId = null; // key into the shared sampleBanks registry
+        this.maxVoices = Number.isFinite(maxVoices) ? maxVoices | 0 : 64; // global budget
+        this.perChannelOutputs = !!perChannelOutputs;
+        this.effectsReturn = this.perChannelOutputs && !!effectsReturn; // last output: reverb/chorus return
+        this.controlInterval = Number.isFinite(controlInterval) ? controlInterval | 0 : 16; // frames per modulation update
+        this.interpolation = Number.isFinite(interpolation) ? interpolation | 0 : 2; // 0 linear .. 3 sinc16
+        this.controllers = Array.from({ length: SYNTH_CHANNELS }, () => ({
+            cc7Volume: 100,
+            cc10Pan: 64,
+            cc11Expression: 127,
+        }));
+        this.mixPtr = 0; // heap scratch: [L frames][R frames], or one pair per channel
+        this.mixFrames = 0;
+        this.timedEvents = []; // messages with a future `frame`, sorted
+        this.ringWords = eventRing instanceof SharedArrayBuffer ? new Int32Array(eventRing) : null;
+        this.ringMask = this.ringWords ? this.ringWords[RING_CAPACITY] - 1 : 0;
+        const interval = Number.isFinite(statsInterval) ? Math.max(0, statsInterval) : 1;
+        this.statsPeriod = Math.round(interval * sampleRate); // frames between summaries, 0 = off
+        this.statsFrames = 0;
+        // emscripten_get_now needs performance.now, which not every worklet scope has
+        this.statsTimed = this.statsPeriod > 0 && typeof globalThis.performance?.now === "function";
 
         this.port.onmessage = (e) => this.onMsg(e.data);
     }
 
+    ensureSynth() {
+        if (!this.synth) {
+            this.synth = requireDsp()._synthCreate(sampleRate);
+            if (!this.synth) {
+                throw new Error('Failed to create WASM Synth');
+            }
+            dspModule._synthSetMaxVoices(this.synth, this.maxVoices);
+            dspModule._synthSetControlInterval(this.synth, this.controlInterval);
+            dspModule._synthSetInterpolation(this.synth, this.interpolation);
+            dspModule._synthSetProfiling(this.synth, this.statsTimed ? 1 : 0);
+        }
+        return this.synth;
+    }
+
     onMsg(msg) {
         if (this.initError) {
             return;
@@ -436,178 +323,253 @@ class Sf2Processor extends AudioWorkletProcessor {
             return;
         }
 
-        if (msg.type === "setPreset") {
-            this.regions = msg.regions ?? [];
-            // Optional: clear current voices
-            this.voices.length = 0;
+        const synth = this.ensureSynth();
+
+        if (Number.isFinite(msg.frame) && TIMED_TYPES.has(msg.type)) {
+            insertTimed(this.timedEvents, msg);
+            return;
         }
 
-        if (msg.type === "noteOn") {
-            const note = msg.note | 0;
-            const velocity = msg.velocity | 0;
+        if (msg.type === "setSampleBank" && msg.bankId !== this.sampleBankId) {
+            // Detaches (and silences) the synth before the old bank can be freed
+            dspModule._synthSetSampleBank(synth, 0, 0);
+            if (this.sampleBankId != null) releaseSampleBank(this.sampleBankId);
+            const bank = msg.bankId != null ? acquireSampleBank(msg.bankId, msg.smpl) : null;
+            this.sampleBankId = bank ? msg.bankId : null;
+            if (bank) {
+                dspModule._synthSetSampleBank(synth, bank.ptr, bank.length);
+            }
+        }
 
-            const matching = this.pickRegions(note, velocity);
-            if (!matching.length) return;
+        const channel = clampChannel(msg.channel ?? 0);
 
-            // exclusiveClass choke
-            for (const r of matching) {
-                const excl = r.exclusiveClass ?? 0;
-                if (excl) this.chokeExclusive(excl);
-            }
+        if (msg.type === "setPreset") {
+            const table = msg.regions ?? EMPTY_REGION_TABLE;
+            const bank = sampleBanks.get(this.sampleBankId);
+            if (bank) uploadRegionSamples(bank, table);
+            loadRegions(synth, channel, table);
+        }
 
-            // allocate voices (layering allowed)
-            for (const r of matching) {
-                this.ensurePolyphony();
-                this.voices.push(makeVoice(r, note, velocity, sampleRate));
-            }
+        if (msg.type === "noteOn") {
+            dspModule._synthNoteOn(synth, channel, msg.note | 0, msg.velocity | 0);
         }
 
         if (msg.type === "noteOff") {
-            const note = msg.note | 0;
-            for (const v of this.voices) {
-                if (v.note === note) {
-                    v.volEnv.noteOff();
-                    v.modEnv.noteOff();
-
-                    // if sampleModes == 3: stop looping on release, play tail to end
-                    if (v.loopUntilReleaseThenTail) v.inReleaseTail = true;
-                }
-            }
+            dspModule._synthNoteOff(synth, channel, msg.note | 0);
         }
 
         if (msg.type === "allNotesOff") {
-            for (const v of this.voices) {
-                v.volEnv.noteOff();
-                v.modEnv.noteOff();
-                if (v.loopUntilReleaseThenTail) v.inReleaseTail = true;
-            }
+            // Without a channel field every channel is released (and pending
+            // timed events for it are dropped, e.g. on pause or seek)
+            this.dropTimedEvents(msg.channel == null ? -1 : channel);
+            dspModule._synthAllNotesOff(synth, msg.channel == null ? -1 : channel);
         }
 
-        if (msg.type === "setControllers") {
-            if (Number.isFinite(msg.cc7Volume)) {
-                this.cc7Volume = Math.max(0, Math.min(127, msg.cc7Volume | 0));
-            }
-            if (Number.isFinite(msg.cc10Pan)) {
-                this.cc10Pan = Math.max(0, Math.min(127, msg.cc10Pan | 0));
-            }
-            if (Number.isFinite(msg.cc11Expression)) {
-                this.cc11Expression = Math.max(0, Math.min(127, msg.cc11Expression | 0));
-            }
+        if (msg.type === "setControlInterval" && Number.isFinite(msg.frames)) {
+            this.controlInterval = msg.frames | 0;
+            dspModule._synthSetControlInterval(synth, this.controlInterval);
         }
-    }
 
-    pickRegions(note, velocity) {
-        const out = [];
-        for (const r of this.regions) {
-            const [kl, kh] = r.keyRange ?? [0, 127];
-            const [vl, vh] = r.velRange ?? [0, 127];
-            if (note >= kl && note <= kh && velocity >= vl && velocity <= vh) out.push(r);
+        if (msg.type === "setInterpolation" && Number.isFinite(msg.quality)) {
+            this.interpolation = msg.quality | 0;
+            dspModule._synthSetInterpolation(synth, this.interpolation);
         }
-        return out;
-    }
 
-    chokeExclusive(excl) {
-        for (const v of this.voices) {
-            if (v.exclusiveClass === excl) {
-                v.volEnv.noteOff();
-                v.modEnv.noteOff();
-                if (v.loopUntilReleaseThenTail) v.inReleaseTail = true;
-            }
+        if (msg.type === "setControllers") {
+            const cc = this.updateControllers(channel, msg);
+            dspModule._synthSetControllers(synth, channel, cc.cc7Volume, cc.cc10Pan, cc.cc11Expression);
         }
-    }
 
-    ensurePolyphony() {
-        if (this.voices.length < this.maxVoices) return;
-
-        // steal oldest voice
-        this.voices.splice(0, 1);
+        if (msg.type === "setSends") {
+            const reverb = Number.isFinite(msg.reverb) ? msg.reverb : 1;
+            const chorus = Number.isFinite(msg.chorus) ? msg.chorus : 1;
+            dspModule._synthSetChannelSends(synth, channel, reverb, chorus);
+        }
     }
 
-    advancePos(v) {
-        v.pos += v.rate;
-
-        // If we are in "release tail" mode, disable looping
-        const effectiveLooping = v.looping && !v.inReleaseTail;
+    updateControllers(channel, msg) {
+        const cc = this.controllers[channel];
+        if (Number.isFinite(msg.cc7Volume)) cc.cc7Volume = clampCc(msg.cc7Volume);
+        if (Number.isFinite(msg.cc10Pan)) cc.cc10Pan = clampCc(msg.cc10Pan);
+        if (Number.isFinite(msg.cc11Expression)) cc.cc11Expression = clampCc(msg.cc11Expression);
+        return cc;
+    }
 
-        if (effectiveLooping) {
-            if (v.pos >= v.loopEnd) {
-                const loopLen = v.loopEnd - v.loopStart;
-                if (loopLen > 1) {
-                    v.pos = v.loopStart + (v.pos - v.loopStart) % loopLen;
-                } else {
-                    v.pos = v.loopStart;
-                }
-            }
+    dropTimedEvents(channel) {
+        dspModule._synthClearEvents(this.synth, channel);
+        if (channel < 0) {
+            this.timedEvents.length = 0;
         } else {
-            if (v.pos >= v.end) v.finished = true;
+            this.timedEvents = this.timedEvents.filter((ev) => clampChannel(ev.channel ?? 0) !== channel);
+        }
+    }
+
+    // Hands the events that fall inside [currentFrame, currentFrame + frames)
+    // to the engine; late ones land at offset 0
+    scheduleTimedEvents(frames) {
+        const queue = this.timedEvents;
+        const end = currentFrame + frames;
+        let n = 0;
+        while (n < queue.length && queue[n].frame < end) {
+            const msg = queue[n++];
+            const offset = Math.max(0, msg.frame - currentFrame) | 0;
+            const channel = clampChannel(msg.channel ?? 0);
+            let type = SYNTH_EVENT_NOTE_ON;
+            let a = 0;
+            let b = 0;
+            let c = 0;
+            if (msg.type === "noteOn") {
+                a = msg.note | 0;
+                b = msg.velocity | 0;
+            } else if (msg.type === "noteOff") {
+                type = SYNTH_EVENT_NOTE_OFF;
+                a = msg.note | 0;
+            } else if (msg.type === "allNotesOff") {
+                type = SYNTH_EVENT_ALL_NOTES_OFF;
+            } else {
+                type = SYNTH_EVENT_CONTROLLERS;
+                const cc = this.updateControllers(channel, msg);
+                a = cc.cc7Volume;
+                b = cc.cc10Pan;
+                c = cc.cc11Expression;
+            }
+            const target = type === SYNTH_EVENT_ALL_NOTES_OFF && msg.channel == null ? -1 : channel;
+            if (!dspModule._synthScheduleEvent(this.synth, offset, type, target, a, b, c)) {
+                // Engine queue full: fall back to quantum-accurate timing
+                const { frame, ...immediate } = msg;
+                this.onMsg(immediate);
+            }
         }
+        if (n) queue.splice(0, n);
+    }
+
+    drainEventRing() {
+        const words = this.ringWords;
+        const synth = this.synth;
+        const write = Atomics.load(words, RING_WRITE);
+        let read = Atomics.load(words, RING_READ);
+        while (read !== write) {
+            const base = RING_HEADER_WORDS + (read & this.ringMask) * RING_RECORD_WORDS;
+            const immediate = words[base + 1] === -1;
+            const head = words[base + 2];
+            const data = words[base + 3];
+            const type = head & 0xff;
+            const channelByte = (head >> 8) & 0xff;
+            const channel = channelByte === 0xff ? -1 : clampChannel(channelByte);
+            const a = data & 0xff;
+            const b = (data >> 8) & 0xff;
+            const c = (data >> 16) & 0xff;
+
+            if (immediate && type === SYNTH_EVENT_ALL_NOTES_OFF) {
+                // Pause/seek: also cancels what is still queued for the channel
+                this.dropTimedEvents(channel);
+                dspModule._synthAllNotesOff(synth, channel);
+            } else {
+                const frame = immediate ? currentFrame : words[base + 1] * 4294967296 + (words[base] >>> 0);
+                const offset = Math.max(0, frame - currentFrame) | 0;
+                // Engine queue full: leave the rest in the ring for the next quantum
+                if (!dspModule._synthScheduleEvent(synth, offset, type, channel, a, b, c)) break;
+                if (type === SYNTH_EVENT_CONTROLLERS && channel >= 0) {
+                    const cc = this.controllers[channel];
+                    cc.cc7Volume = a;
+                    cc.cc10Pan = b;
+                    cc.cc11Expression = c;
+                }
+            }
+            read = (read + 1) | 0;
+        }
+        Atomics.store(words, RING_READ, read);
+    }
+
+    postStats() {
+        const st = readStats(this.synth);
+        dspModule._synthResetStats(this.synth);
+        const seconds = st.frames / sampleRate;
+        const share = (x) => (this.statsTimed && seconds > 0 ? x / seconds : null);
+        this.port.postMessage({
+            type: "stats",
+            seconds,
+            blocks: st.blocks,
+            load: share(st.renderSeconds),
+            loadPeak: this.statsTimed ? st.loadPeak : null,
+            eventLoad: share(st.eventSeconds),
+            voiceLoad: share(st.voiceSeconds),
+            mixLoad: share(st.mixSeconds),
+            effectLoad: share(st.effectSeconds),
+            voicesAvg: st.blocks > 0 ? st.voicesSum / st.blocks : 0,
+            voicesPeak: st.voicesPeak,
+            voicesStolen: st.voicesStolen,
+            voicesCut: st.voicesCut,
+            eventsQueuedPeak: st.eventsQueuedPeak,
+            eventsRejected: st.eventsRejected,
+        });
+    }
+
+    ensureMixBuffer(frames) {
+        if (this.mixPtr && this.mixFrames >= frames) return;
+        if (this.mixPtr) dspModule._dspFree(this.mixPtr);
+        const pairs = this.perChannelOutputs ? SYNTH_CHANNELS + (this.effectsReturn ? 1 : 0) : 1;
+        this.mixPtr = dspModule._dspMalloc(frames * pairs * 2 * 4);
+        this.mixFrames = frames;
     }
 
     process(inputs, outputs) {
-        const outL = outputs[0][0];
-        const outR = outputs[0][1];
-        outL.fill(0);
-        outR.fill(0);
-
-        const volumeMul = (this.cc7Volume / 127) * (this.cc11Expression / 127);
-        const ccPanPos = (this.cc10Pan - 64) / 63;
-
-        for (let i = 0; i < outL.length; i++) {
-            let sumL = 0;
-            let sumR = 0;
-
-            for (let vi = this.voices.length - 1; vi >= 0; vi--) {
-                const v = this.voices[vi];
-                if (v.finished) {
-                    this.voices.splice(vi, 1);
-                    continue;
-                }
-
-                // --- Mod sources ---
-                const modEnv = v.modEnv.next(); // 0..1
-                const modLfo = v.modLfo.next(); // -1..1
-                const vibLfo = v.vibLfo.next(); // -1..1
-
-                // --- Pitch modulation (cents) ---
-                const r = v.region;
-                const pitchCents =
-                    vibLfo * (r.vibLfoToPitchCents ?? 0) +
-                    modLfo * (r.modLfoToPitchCents ?? 0);
-
-                v.rate = v.baseRate * centsToRatio(pitchCents);
-
-                // --- Read sample (stereo if provided; else mono) ---
-                const sL = readSampleMono(v.dataL, v.pos);
-                const sR = v.dataR ? readSampleMono(v.dataR, v.pos) : sL;
-
-                // --- Filter cutoff modulation ---
-                const fcCents =
-                    (r.initialFilterFcCents ?? 13500) +
-                    modEnv * (r.modEnvToFilterFcCents ?? 0) +
-                    modLfo * (r.modLfoToFilterFcCents ?? 0);
-
-                v.lpf.setCutoffHz(fcCentsToHz(fcCents));
-
-                const fL = v.lpf.processL(sL);
-                const fR = v.lpf.processR(sR);
+        if (!this.synth) {
+            for (const output of outputs) {
+                for (const channelData of output) channelData.fill(0);
+            }
+            return true;
+        }
 
-                // --- Volume envelope & gain ---
-                const env = v.volEnv.next();
-                const g = v.baseGain * env * volumeMul;
-                const mixPan = Math.max(-1, Math.min(1, v.regionPanPos + ccPanPos));
-                const panG = balanceToGains(mixPan);
+        const frames = outputs[0][0].length;
+        if (this.statsPeriod > 0) {
+            if (this.statsFrames >= this.statsPeriod) {
+                this.postStats();
+                this.statsFrames = 0;
+            }
+            this.statsFrames += frames;
+        }
+        this.ensureMixBuffer(frames);
+        if (this.ringWords) this.drainEventRing();
+        if (this.timedEvents.length) this.scheduleTimedEvents(frames);
 
-                sumL += fL * g * panG.gL;
-                sumR += fR * g * panG.gR;
+        if (!this.perChannelOutputs) {
+            const ptrL = this.mixPtr;
+            const ptrR = this.mixPtr + frames * 4;
 
-                // --- Advance position (looping/tail) ---
-                this.advancePos(v);
-            }
+            // One WASM call per quantum: voices are mixed inside the engine
+            dspModule._synthRender(this.synth, ptrL, ptrR, frames);
 
-            outL[i] = sumL;
-            outR[i] = sumR;
+            // Re-read the heap view: it is replaced whenever linear memory grows
+            const heap = dspModule.HEAPF32;
+            outputs[0][0].set(heap.subarray(ptrL >> 2, (ptrL >> 2) + frames));
+            outputs[0][1].set(heap.subarray(ptrR >> 2, (ptrR >> 2) + frames));
+            return true;
         }
 
+        // Still one render call; each channel lands in its own stereo pair, and
+        // the effects return in the pair after the last channel
+        const returnPtr = this.mixPtr + SYNTH_CHANNELS * 2 * frames * 4;
+        if (this.effectsReturn) {
+            dspModule._synthRenderChannelsWithReturn(this.synth, this.mixPtr, returnPtr, frames);
+        } else {
+            dspModule._synthRenderChannels(this.synth, this.mixPtr, frames);
+        }
+        const heap = dspModule.HEAPF32;
+        const base = this.mixPtr >> 2;
+        const channelOutputs = this.effectsReturn ? outputs.length - 1 : outputs.length;
+        const count = Math.min(channelOutputs, SYNTH_CHANNELS);
+        for (let c = 0; c < count; c++) {
+            const offL = base + c * 2 * frames;
+            outputs[c][0].set(heap.subarray(offL, offL + frames));
+            outputs[c][1].set(heap.subarray(offL + frames, offL + 2 * frames));
+        }
+        if (this.effectsReturn && outputs.length > 0) {
+            const ret = outputs[outputs.length - 1];
+            const offL = returnPtr >> 2;
+            ret[0].set(heap.subarray(offL, offL + frames));
+            ret[1].set(heap.subarray(offL + frames, offL + 2 * frames));
+        }
         return true;
     }
 }
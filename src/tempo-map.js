@@ -0,0 +1,74 @@
+// tempo-map.js
+//
+// Tick <-> seconds conversion for a Standard MIDI File. The map is plain
+// typed arrays (one entry per tempo segment: start tick, cumulative start
+// seconds, microseconds per quarter) so it survives postMessage, and both
+// directions are a binary search over it, so files with thousands of tempo
+// changes convert in O(log n) per lookup.
+
+// tempos: [{ tick, microPerQuarter }] in file order (any track); later
+// changes at the same tick win. 120 BPM applies until the first change.
+export function buildTempoMap(tempos, division) {
+  const sorted = [...tempos].sort((a, b) => a.tick - b.tick);
+  if (!sorted.length || sorted[0].tick !== 0) sorted.unshift({ tick: 0, microPerQuarter: 500000 });
+  const compact = [];
+  for (const t of sorted) {
+    if (compact.length && compact[compact.length - 1].tick === t.tick) compact[compact.length - 1] = t;
+    else compact.push(t);
+  }
+  const n = compact.length;
+  const map = {
+    division,
+    ticks: new Float64Array(n),
+    secs: new Float64Array(n),
+    microPerQuarter: new Float64Array(n),
+  };
+  let startSec = 0;
+  for (let i = 0; i < n; i += 1) {
+    const cur = compact[i];
+    map.ticks[i] = cur.tick;
+    map.secs[i] = startSec;
+    map.microPerQuarter[i] = cur.microPerQuarter;
+    if (i + 1 < n) startSec += ((compact[i + 1].tick - cur.tick) * cur.microPerQuarter) / 1000000 / division;
+  }
+  return map;
+}
+
+// Index of the segment containing `tick` (the last one starting at or before it)
+export function tempoSegmentAt(map, tick) {
+  const { ticks } = map;
+  let lo = 0;
+  let hi = ticks.length - 1;
+  while (lo < hi) {
+    const mid = (lo + hi + 1) >> 1;
+    if (ticks[mid] <= tick) lo = mid;
+    else hi = mid - 1;
+  }
+  return lo;
+}
+
+export function segmentTickToSec(map, i, tick) {
+  return map.secs[i] + ((tick - map.ticks[i]) * map.microPerQuarter[i]) / 1000000 / map.division;
+}
+
+export function tickToSec(map, tick) {
+  return segmentTickToSec(map, tempoSegmentAt(map, tick), tick);
+}
+
+// Inverse of tickToSec: the earliest (fractional) tick that sounds at `sec`
+export function secToTick(map, sec) {
+  const { secs } = map;
+  let lo = 0;
+  let hi = secs.length - 1;
+  // First segment whose start is at or past sec, falling back to the last
+  // one starting before it; zero-length segments resolve to their start
+  while (lo < hi) {
+    const mid = (lo + hi + 1) >> 1;
+    if (secs[mid] < sec) lo = mid;
+    else hi = mid - 1;
+  }
+  if (lo + 1 < secs.length && secs[lo + 1] <= sec) lo += 1;
+  const micro = map.microPerQuarter[lo];
+  if (sec <= secs[lo] || micro <= 0) return map.ticks[lo];
+  return map.ticks[lo] + ((sec - secs[lo]) * 1000000 * map.division) / micro;
+}
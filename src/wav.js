@@ -0,0 +1,37 @@
+// wav.js
+//
+// 16-bit PCM WAV helpers for the offline export: the 44-byte header (written
+// first, so the file can be streamed) and float -> int16 conversion.
+
+export function wavHeader(sampleRate, channels, frames) {
+  const bytesPerFrame = channels * 2;
+  const dataBytes = frames * bytesPerFrame;
+  const view = new DataView(new ArrayBuffer(44));
+  const tag = (offset, text) => {
+    for (let i = 0; i < 4; i++) view.setUint8(offset + i, text.charCodeAt(i));
+  };
+  tag(0, "RIFF");
+  view.setUint32(4, 36 + dataBytes, true);
+  tag(8, "WAVE");
+  tag(12, "fmt ");
+  view.setUint32(16, 16, true);
+  view.setUint16(20, 1, true); // PCM
+  view.setUint16(22, channels, true);
+  view.setUint32(24, sampleRate, true);
+  view.setUint32(28, sampleRate * bytesPerFrame, true);
+  view.setUint16(32, bytesPerFrame, true);
+  view.setUint16(34, 16, true);
+  tag(36, "data");
+  view.setUint32(40, dataBytes, true);
+  return view.buffer;
+}
+
+// Interleaved float samples -> clipped int16
+export function floatToPcm16(samples) {
+  const pcm = new Int16Array(samples.length);
+  for (let i = 0; i < samples.length; i++) {
+    const s = Math.max(-1, Math.min(1, samples[i]));
+    pcm[i] = s < 0 ? s * 0x8000 : s * 0x7fff;
+  }
+  return pcm;
+}
@@ -0,0 +1,57 @@
+/**
+ * Native tests of src/dsp.c
+ * Compiles every tests/native/*.c with the host C compiler and runs it; a
+ * test passes when it exits 0 without printing FAIL. CMakeLists.txt runs the
+ * same programs under ctest.
+ */
+
+const { execFileSync, spawnSync } = require('child_process');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+
+const CC = process.env.CC || 'cc';
+const hasCompiler = spawnSync(CC, ['--version'], { stdio: 'ignore' }).status === 0;
+const describeIfCc = hasCompiler ? describe : describe.skip;
+
+const root = path.join(__dirname, '..');
+const nativeDir = path.join(__dirname, 'native');
+
+// Builds for the tests that need more than `cc -O2 <test>.c -lm`, run in
+// order; `args` gets the test's scratch directory
+const builds = {
+  'c-api': [{ flags: ['-I', path.join(root, 'src'), path.join(root, 'src', 'dsp.c')] }],
+  'thread-render': [{ flags: ['-DDSP_THREADS', '-pthread'] }],
+  // The double build writes the reference the float32 build is checked against
+  'precision-drift': [
+    { name: 'drift-double', args: (dir) => [path.join(dir, 'reference.bin')] },
+    { name: 'drift-float', flags: ['-DDSP_FLOAT32'], args: (dir) => [path.join(dir, 'reference.bin')] },
+  ],
+};
+
+const tests = fs.readdirSync(nativeDir)
+  .filter((file) => file.endsWith('.c'))
+  .map((file) => path.basename(file, '.c'))
+  .sort();
+
+describeIfCc('DSP native tests', () => {
+  for (const name of tests) {
+    test(name, () => {
+      const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'gbk-dsp-'));
+      for (const build of builds[name] || [{}]) {
+        const exe = path.join(dir, build.name || name);
+        execFileSync(CC, [
+          '-O2',
+          path.join(nativeDir, `${name}.c`),
+          ...(build.flags || []),
+          '-o', exe,
+          '-lm',
+        ]);
+
+        const result = spawnSync(exe, build.args ? build.args(dir) : [], { encoding: 'utf-8' });
+        expect(result.stdout).not.toContain('FAIL');
+        expect(result.status).toBe(0);
+      }
+    }, 60000);
+  }
+});
@@ -0,0 +1,103 @@
+// C API check for the native library: drives the engine through dsp.h only,
+// the way a headless renderer links it, loading a packed region table and
+// scheduling a note at a frame offset. Built and run by tests/dsp-native.test.js
+// (and by ctest against libdsp):
+//   cc -O2 -I src tests/native/c-api.c src/dsp.c -lm
+#include <string.h>
+#include "dsp.h"
+#include "test-util.h"
+
+#define FRAMES 256
+#define SINE 4800 // 24 whole 200 Hz cycles, so the loop is seamless
+#define OFFSET 100
+
+static int16_t sine[SINE];
+static float outL[FRAMES], outR[FRAMES];
+static float channels[SYNTH_CHANNELS * 2 * FRAMES];
+static float fxReturn[2 * FRAMES];
+
+static float peak(const float* x, int from, int to) {
+    float p = 0.0f;
+    for (int i = from; i < to; i++) p = fabsf(x[i]) > p ? fabsf(x[i]) : p;
+    return p;
+}
+
+// One full-range region: a looping 200 Hz sine with instant attack and a
+// short release, with the given reverb send (0.1% units)
+static void loadTable(Synth* s, int channel, float reverbSend) {
+    int32_t ints[REGION_INT_COLUMNS] = {0};
+    float floats[REGION_FLOAT_COLUMNS] = {0};
+    ints[REGION_COL_KEY_HI] = 127;
+    ints[REGION_COL_VEL_HI] = 127;
+    ints[REGION_COL_LENGTH] = SINE;
+    ints[REGION_COL_OFFSET_R] = -1;
+    ints[REGION_COL_LOOP_START] = 0;
+    ints[REGION_COL_LOOP_END] = SINE;
+    ints[REGION_COL_SAMPLE_MODES] = 1;
+    ints[REGION_COL_ROOT_KEY] = 60;
+    floats[REGION_FCOL_GAIN_L] = 1.0f;
+    floats[REGION_FCOL_GAIN_R] = 1.0f;
+    floats[REGION_FCOL_SAMPLE_RATE] = (float)SR;
+    floats[REGION_FCOL_SCALE_TUNING] = 100.0f;
+    for (int k = 0; k < 6; k++) {
+        floats[REGION_FCOL_VOL_ENV + k] = -12000.0f;
+        floats[REGION_FCOL_MOD_ENV + k] = -12000.0f;
+    }
+    floats[REGION_FCOL_VOL_ENV + 4] = 0.0f;
+    floats[REGION_FCOL_MOD_ENV + 4] = 0.0f;
+    floats[REGION_FCOL_FILTER_FC] = 13500.0f;
+    floats[REGION_FCOL_MOD_LFO_DELAY] = -12000.0f;
+    floats[REGION_FCOL_VIB_LFO_DELAY] = -12000.0f;
+    floats[REGION_FCOL_REVERB_SEND] = reverbSend;
+    check("packed table loads", synthLoadRegions(s, channel, ints, floats, 1));
+}
+
+int main(void) {
+    for (int i = 0; i < SINE; i++) sine[i] = (int16_t)(16000.0 * sin(2.0 * M_PI * 200.0 * i / SR));
+
+    Synth* s = synthCreate(SR);
+    synthSetSampleBank(s, sine, SINE);
+    synthSetInterpolation(s, INTERP_HERMITE);
+    loadTable(s, 0, 0.0f);
+    check("channel count matches the header", synthGetChannelCount() == SYNTH_CHANNELS);
+
+    check("event queued", synthScheduleEvent(s, OFFSET, SYNTH_EVENT_NOTE_ON, 0, 60, 127, 0));
+    synthRender(s, outL, outR, FRAMES);
+    check("silent before the event offset", peak(outL, 0, OFFSET) == 0.0f && peak(outR, 0, OFFSET) == 0.0f);
+    check("note sounds from the event offset", peak(outL, OFFSET, FRAMES) > 0.1f);
+    check("one voice active", synthGetActiveVoiceCount(s) == 1);
+    check("one voice rendered", synthGetRenderedVoiceCount(s) == 1);
+    check("event queue drained", synthGetPendingEventCount(s) == 0);
+
+    memset(channels, 0, sizeof channels);
+    synthRenderChannels(s, channels, FRAMES);
+    check("channel 0 carries the note", peak(channels, 0, 2 * FRAMES) > 0.1f);
+    check("other channels silent", peak(channels, 2 * FRAMES, SYNTH_CHANNELS * 2 * FRAMES) == 0.0f);
+
+    synthNoteOff(s, 0, 60);
+    for (int b = 0; b < (int)SR / FRAMES; b++) synthRender(s, outL, outR, FRAMES);
+    check("released voice finishes", synthGetActiveVoiceCount(s) == 0);
+    synthDestroy(s);
+
+    // Reverb send: the return comes in its own pair, the channels stay dry
+    s = synthCreate(SR);
+    synthSetSampleBank(s, sine, SINE);
+    loadTable(s, 0, 500.0f);
+    synthNoteOn(s, 0, 60, 127);
+    float fxPeak = 0.0f;
+    for (int b = 0; b < 8; b++) {
+        synthRenderChannelsWithReturn(s, channels, fxReturn, FRAMES);
+        float p = peak(fxReturn, 0, 2 * FRAMES);
+        fxPeak = p > fxPeak ? p : fxPeak;
+    }
+    check("effects return carries the reverb", fxPeak > 1.0e-3f);
+    check("other channels still silent", peak(channels, 2 * FRAMES, SYNTH_CHANNELS * 2 * FRAMES) == 0.0f);
+    synthSetChannelSends(s, 0, 0.0, 0.0);
+    synthAllSoundOff(s);
+    synthNoteOn(s, 0, 60, 127);
+    synthRenderChannelsWithReturn(s, channels, fxReturn, FRAMES);
+    check("channel send 0 leaves the return silent", peak(fxReturn, 0, 2 * FRAMES) == 0.0f);
+    synthDestroy(s);
+
+    return testResult();
+}
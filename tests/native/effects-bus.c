@@ -0,0 +1,218 @@
+// Effects bus check for dsp.c: regions without sends must render exactly
+// dry, reverb and chorus sends must add a return that outlasts the voices and
+// then goes idle, channel send levels must scale it, and the per-channel
+// render's pairs plus its return must add up to synthRender. Built and run by
+// tests/dsp-native.test.js:
+//   cc -O2 tests/native/effects-bus.c -lm
+#include "../../src/dsp.c"
+#include "test-util.h"
+
+#define FRAMES 128
+
+static float outL[FRAMES], outR[FRAMES];
+static float dryL[FRAMES], dryR[FRAMES];
+
+// One looping region on channels 0 and 1 with the given sends (0.1% units)
+static Synth* sendSynth(double chorusSend, double reverbSend) {
+    Synth* s = makeSynth(2, 0, -12000, -12000, 0, -3000);
+    for (int c = 0; c < 2; c++) regionSetEffects(synthGetRegion(s, c, 0), chorusSend, reverbSend);
+    return s;
+}
+
+static double peakOf(const float* l, const float* r, int n) {
+    double peak = 0.0;
+    for (int i = 0; i < n; i++) peak = fmax(peak, fmax(fabs(l[i]), fabs(r[i])));
+    return peak;
+}
+
+// Plays a chord for `noteBlocks` blocks, releases it and renders `blocks`
+// in all; returns the output peak once the voices are gone (-1 if they never
+// finish)
+static double renderChord(Synth* s, int noteBlocks, int blocks) {
+    double tail = -1.0;
+    for (int b = 0; b < blocks; b++) {
+        if (b == 0) {
+            synthNoteOn(s, 0, 60, 100);
+            synthNoteOn(s, 1, 67, 100);
+        }
+        if (b == noteBlocks) synthAllNotesOff(s, -1);
+        synthRender(s, outL, outR, FRAMES);
+        if (synthGetActiveVoiceCount(s) == 0 && b > noteBlocks) tail = fmax(tail, peakOf(outL, outR, FRAMES));
+    }
+    return tail;
+}
+
+int main(void) {
+    fillBank(0.0);
+
+    // No sends: bit-identical to the engine without effects and never woken
+    {
+        Synth* a = sendSynth(0, 0);
+        Synth* b = sendSynth(0, 0);
+        int same = 1;
+        for (int blk = 0; blk < 200; blk++) {
+            if (blk == 0) {
+                synthNoteOn(a, 0, 60, 100);
+                synthNoteOn(b, 0, 60, 100);
+            }
+            if (blk == 100) {
+                synthNoteOff(a, 0, 60);
+                synthNoteOff(b, 0, 60);
+            }
+            synthRender(a, outL, outR, FRAMES);
+            synthRenderScheduled(b, dryL, dryR, NULL, NULL, FRAMES, 0);
+            same &= memcmp(outL, dryL, sizeof outL) == 0 && memcmp(outR, dryR, sizeof outR) == 0;
+        }
+        check("no sends: output is exactly dry", same);
+        check("no sends: effects stay idle", a->fx.idle);
+        synthDestroy(a);
+        synthDestroy(b);
+    }
+
+    // Packed tables carry the sends
+    {
+        Synth* s = synthCreate(SR);
+        int32_t ints[REGION_INT_COLUMNS] = {0};
+        float floats[REGION_FLOAT_COLUMNS] = {0};
+        ints[REGION_COL_KEY_HI] = 127;
+        ints[REGION_COL_VEL_HI] = 127;
+        ints[REGION_COL_LENGTH] = BANK;
+        ints[REGION_COL_OFFSET_R] = -1;
+        floats[REGION_FCOL_CHORUS_SEND] = 250.0f;
+        floats[REGION_FCOL_REVERB_SEND] = 400.0f;
+        synthLoadRegions(s, 0, ints, floats, 1);
+        Region* r = synthGetRegion(s, 0, 0);
+        check("packed table: chorus and reverb send columns", r->chorusSend == 250.0 && r->reverbSend == 400.0);
+        synthDestroy(s);
+    }
+
+    // Reverb: a tail after the voices, which then dies out and goes idle
+    const int noteBlocks = 40;
+    {
+        Synth* s = sendSynth(0, 1000);
+        double tail = renderChord(s, noteBlocks, 120);
+        check("reverb: voices finish", tail >= 0.0);
+        check("reverb: tail outlasts the voices", tail > 1.0e-3);
+        for (int b = 0; b < (int)(8.0 * SR / FRAMES) && !s->fx.idle; b++) synthRender(s, outL, outR, FRAMES);
+        check("reverb: goes idle once the tail dies out", s->fx.idle);
+        synthRender(s, outL, outR, FRAMES);
+        check("reverb: idle output is silent", peakOf(outL, outR, FRAMES) == 0.0);
+        synthDestroy(s);
+    }
+
+    // Chorus: audible while the chord plays, idle soon after it ends
+    {
+        Synth* s = sendSynth(1000, 0);
+        Synth* dry = sendSynth(0, 0);
+        double wet = 0.0;
+        for (int b = 0; b < noteBlocks; b++) {
+            if (b == 0) {
+                synthNoteOn(s, 0, 60, 100);
+                synthNoteOn(dry, 0, 60, 100);
+            }
+            synthRender(s, outL, outR, FRAMES);
+            synthRender(dry, dryL, dryR, FRAMES);
+            for (int i = 0; i < FRAMES; i++) wet = fmax(wet, fabs(outL[i] - dryL[i]));
+        }
+        check("chorus: return is there", wet > 1.0e-3);
+        synthAllNotesOff(s, -1);
+        for (int b = 0; b < (int)(1.0 * SR / FRAMES) && !s->fx.idle; b++) synthRender(s, outL, outR, FRAMES);
+        check("chorus: goes idle within a second of release", s->fx.idle);
+        synthDestroy(s);
+        synthDestroy(dry);
+    }
+
+    // Channel send level 0 removes the return; half the level, half the return
+    {
+        Synth* dry = sendSynth(0, 0);
+        Synth* muted = sendSynth(500, 1000);
+        Synth* full = sendSynth(500, 1000);
+        Synth* half = sendSynth(500, 1000);
+        synthSetChannelSends(muted, 0, 0.0, 0.0);
+        synthSetChannelSends(muted, 1, 0.0, 0.0);
+        synthSetChannelSends(half, 0, 0.5, 0.5);
+        synthSetChannelSends(half, 1, 0.5, 0.5);
+        int same = 1;
+        double worst = 0.0;
+        double wet = 0.0;
+        for (int b = 0; b < 80; b++) {
+            Synth* all[4] = { dry, muted, full, half };
+            for (int k = 0; k < 4; k++) {
+                if (b == 0) {
+                    synthNoteOn(all[k], 0, 60, 100);
+                    synthNoteOn(all[k], 1, 67, 100);
+                }
+            }
+            static float fullL[FRAMES], fullR[FRAMES], halfL[FRAMES], halfR[FRAMES];
+            synthRender(dry, dryL, dryR, FRAMES);
+            synthRender(muted, outL, outR, FRAMES);
+            same &= memcmp(outL, dryL, sizeof outL) == 0 && memcmp(outR, dryR, sizeof outR) == 0;
+            synthRender(full, fullL, fullR, FRAMES);
+            synthRender(half, halfL, halfR, FRAMES);
+            for (int i = 0; i < FRAMES; i++) {
+                double wetFull = fullL[i] - dryL[i];
+                double wetHalf = halfL[i] - dryL[i];
+                worst = fmax(worst, fabs(wetHalf - 0.5 * wetFull));
+                wet = fmax(wet, fabs(wetFull));
+            }
+        }
+        check("channel sends 0: output is exactly dry", same);
+        check("channel sends: return is there", wet > 1.0e-3);
+        check("channel sends 0.5: half the return", worst < 1.0e-5);
+        synthDestroy(dry);
+        synthDestroy(muted);
+        synthDestroy(full);
+        synthDestroy(half);
+    }
+
+    // Per-channel pairs + return == the mixed render, for odd block sizes too
+    {
+        Synth* mixed = sendSynth(300, 700);
+        Synth* split = sendSynth(300, 700);
+        const int sizes[] = { 128, 37, 300, 1 };
+        double worst = 0.0;
+        double wet = 0.0;
+        static float bigL[300], bigR[300], bigChannels[SYNTH_CHANNELS * 2 * 300], bigReturn[600];
+        for (int b = 0; b < 400; b++) {
+            int n = sizes[b % 4];
+            if (b == 0) {
+                synthNoteOn(mixed, 0, 60, 100);
+                synthNoteOn(split, 0, 60, 100);
+                synthNoteOn(mixed, 1, 64, 90);
+                synthNoteOn(split, 1, 64, 90);
+            }
+            if (b == 200) {
+                synthAllNotesOff(mixed, -1);
+                synthAllNotesOff(split, -1);
+            }
+            synthRender(mixed, bigL, bigR, n);
+            synthRenderChannelsWithReturn(split, bigChannels, bigReturn, n);
+            for (int i = 0; i < n; i++) {
+                double l = bigReturn[i];
+                double r = bigReturn[n + i];
+                for (int c = 0; c < SYNTH_CHANNELS; c++) {
+                    l += bigChannels[(size_t)(2 * c) * n + i];
+                    r += bigChannels[(size_t)(2 * c + 1) * n + i];
+                }
+                worst = fmax(worst, fmax(fabs(l - bigL[i]), fabs(r - bigR[i])));
+                wet = fmax(wet, fmax(fabs(bigReturn[i]), fabs(bigReturn[n + i])));
+            }
+        }
+        check("per-channel: return is there", wet > 1.0e-3);
+        check("per-channel: pairs + return match synthRender", worst < 1.0e-5);
+        synthDestroy(mixed);
+        synthDestroy(split);
+    }
+
+    // All sound off silences the tails
+    {
+        Synth* s = sendSynth(1000, 1000);
+        renderChord(s, noteBlocks, noteBlocks + 2);
+        synthAllSoundOff(s);
+        synthRender(s, outL, outR, FRAMES);
+        check("all sound off: silent at once", peakOf(outL, outR, FRAMES) == 0.0 && s->fx.idle);
+        synthDestroy(s);
+    }
+
+    return testResult();
+}
@@ -0,0 +1,246 @@
+// Accuracy check for the fast-math section of dsp.c against the libm
+// reference functions. Built and run by tests/dsp-native.test.js:
+//   cc -O2 tests/native/fastmath-accuracy.c -lm
+#include <stdio.h>
+#include "../../src/dsp.c"
+
+static int failures = 0;
+
+// The mod envelope level is dsp_real_t, so a float32 build only holds it to
+// single precision
+#ifdef DSP_FLOAT32
+#define MOD_ENV_LIMIT 1e-6
+#else
+#define MOD_ENV_LIMIT 1e-9
+#endif
+
+static void check(const char* name, double maxErr, double limit) {
+    int ok = maxErr <= limit;
+    printf("%-24s max error %.3e (limit %.1e) %s\n", name, maxErr, limit, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+static double relErr(double got, double want) {
+    return fabs(got - want) / fmax(fabs(want), 1e-300);
+}
+
+// Envelope stage times as seconds plus the reference state: time in the
+// stage is a whole sample count k, and a stage ends once k / sr reaches it
+typedef struct {
+    double sr;
+    int stage;
+    double level;
+    double peak;
+    double delay, attack, hold, decay, sustain, release;
+    double releaseStart;
+    int k;
+} RefEnv;
+
+static RefEnv refEnvFromSf2(double sr, double delayTc, double attackTc, double holdTc,
+                            double decayTc, double sustain, double releaseTc, double minRelease) {
+    RefEnv env = { sr, 1, 0.0, 1.0,
+                   fmax(0.0, timecentsToSeconds(delayTc)), fmax(0.0, timecentsToSeconds(attackTc)),
+                   fmax(0.0, timecentsToSeconds(holdTc)), fmax(0.0, timecentsToSeconds(decayTc)),
+                   sustain, fmax(minRelease, timecentsToSeconds(releaseTc)), 0.0, 0 };
+    if (env.delay <= 0.0) env.stage = 2;
+    return env;
+}
+
+static void refEnvRelease(RefEnv* env) {
+    env->stage = 6;
+    env->k = 0;
+    env->releaseStart = env->level;
+}
+
+// The exp/log volume envelope segments, as the reference
+static double volEnvReferenceNext(RefEnv* env) {
+    env->k++;
+    double t = env->k / env->sr;
+    switch (env->stage) {
+        case 1:
+            if (t >= env->delay) { env->stage = 2; env->k = 0; }
+            env->level = 0.0;
+            return 0.0;
+        case 2: {
+            double x = fmin(1.0, t / env->attack);
+            env->level = env->peak * (1.0 - exp(-x * 6.0));
+            if (x >= 1.0) { env->level = env->peak; env->stage = (env->hold > 0) ? 3 : 4; env->k = 0; }
+            return env->level;
+        }
+        case 3:
+            env->level = env->peak;
+            if (t >= env->hold) { env->stage = 4; env->k = 0; }
+            return env->level;
+        case 4: {
+            double x = fmin(1.0, t / env->decay);
+            double start = fmax(EPS, env->peak);
+            double end = fmax(EPS, env->sustain);
+            env->level = exp(log(start) + (log(end) - log(start)) * x);
+            if (x >= 1.0) { env->level = env->sustain; env->stage = 5; env->k = 0; }
+            return env->level;
+        }
+        case 5:
+            env->level = env->sustain;
+            return env->level;
+        case 6: {
+            double x = fmin(1.0, t / env->release);
+            double start = fmax(EPS, env->releaseStart);
+            env->level = exp(log(start) + (log(EPS) - log(start)) * x);
+            if (x >= 1.0) { env->level = 0.0; env->stage = 0; }
+            return env->level;
+        }
+    }
+    env->level = 0.0;
+    return 0.0;
+}
+
+// The division-per-step linear modulation envelope, as the reference
+static double modEnvReferenceStep(RefEnv* env, int samples) {
+    env->k += samples;
+    double t = env->k / env->sr;
+    switch (env->stage) {
+        case 1:
+            if (t >= env->delay) { env->stage = 2; env->k = 0; }
+            env->level = 0.0;
+            return 0.0;
+        case 2:
+            env->level = fmin(1.0, t / env->attack);
+            if (env->level >= 1.0) { env->stage = (env->hold > 0) ? 3 : 4; env->k = 0; }
+            return env->level;
+        case 3:
+            env->level = 1.0;
+            if (t >= env->hold) { env->stage = 4; env->k = 0; }
+            return env->level;
+        case 4: {
+            double x = fmin(1.0, t / env->decay);
+            env->level = 1.0 + (env->sustain - 1.0) * x;
+            if (x >= 1.0) { env->stage = 5; env->k = 0; }
+            return env->level;
+        }
+        case 5:
+            env->level = env->sustain;
+            return env->level;
+        case 6: {
+            double x = fmin(1.0, t / env->release);
+            env->level = env->releaseStart * (1.0 - x);
+            if (x >= 1.0) { env->level = 0.0; env->stage = 0; }
+            return env->level;
+        }
+    }
+    env->level = 0.0;
+    return 0.0;
+}
+
+int main(void) {
+    fastMathInit(); // synthCreate and voiceCreate do this for the engine
+    double maxErr = 0.0;
+    for (double c = -12000.0; c <= 12000.0; c += 0.37) {
+        maxErr = fmax(maxErr, relErr(fastCentsToRatio(c), centsToRatio(c)));
+    }
+    check("fastCentsToRatio", maxErr, 1e-7);
+
+    maxErr = 0.0;
+    for (double fc = 1500.0; fc <= 13500.0; fc += 0.73) {
+        maxErr = fmax(maxErr, relErr(fastFcCentsToHz(fc), fcCentsToHz(fc)));
+    }
+    check("fastFcCentsToHz", maxErr, 1e-7);
+
+    maxErr = 0.0;
+    for (double cb = 0.0; cb <= 1440.0; cb += 0.11) {
+        maxErr = fmax(maxErr, relErr(fastCbAttenToLin(cb), cbAttenToLin(cb)));
+    }
+    check("fastCbAttenToLin", maxErr, 1e-7);
+
+    maxErr = 0.0;
+    for (double ph = 0.0; ph < 3.0; ph += 0.000137) {
+        maxErr = fmax(maxErr, fabs(fastSinCycles(ph) - sin(2.0 * M_PI * ph)));
+    }
+    check("fastSinCycles", maxErr, 1e-5);
+
+    // LFO over 10 s at 5 Hz against sin() of the ideal phase
+    LFO lfo;
+    lfoInit(&lfo, 48000.0);
+    lfoSet(&lfo, 5.0, 0.0);
+    maxErr = 0.0;
+    for (int n = 1; n <= 480000; n++) {
+        double y = lfoNext(&lfo);
+        maxErr = fmax(maxErr, fabs(y - sin(2.0 * M_PI * 5.0 * n / 48000.0)));
+    }
+    check("lfoNext (10 s)", maxErr, 1e-5);
+
+    // Recursive-multiplier envelope against the exp/log segments
+    VolEnv env;
+    volEnvInit(&env, 48000.0);
+    volEnvSetFromSf2(&env, -3600.0, -1200.0, -2400.0, 0.0, 240.0, -600.0);
+    RefEnv ref = refEnvFromSf2(48000.0, -3600.0, -1200.0, -2400.0, 0.0, env.sustain, -600.0,
+                               MIN_VOL_RELEASE_SEC);
+    volEnvNoteOn(&env);
+    maxErr = 0.0;
+    for (int n = 0; n < 48000 * 3; n++) {
+        if (n == 48000 * 2) {
+            volEnvNoteOff(&env);
+            refEnvRelease(&ref);
+        }
+        double y = volEnvNext(&env);
+        maxErr = fmax(maxErr, fabs(y - volEnvReferenceNext(&ref)));
+    }
+    check("volEnvNext", maxErr, 1e-9);
+
+    // Block rendering against per-sample stepping, with block edges landing
+    // inside and on stage boundaries
+    VolEnv blockEnv;
+    volEnvInit(&env, 48000.0);
+    volEnvSetFromSf2(&env, -3600.0, -1200.0, -2400.0, 0.0, 240.0, -600.0);
+    blockEnv = env;
+    volEnvNoteOn(&env);
+    volEnvNoteOn(&blockEnv);
+    maxErr = 0.0;
+    float block[257];
+    for (int n = 0, len = 1; n < 48000 * 3; n += len, len = len % 257 + 1) {
+        if (n >= 48000 * 2 && blockEnv.stage != 6 && blockEnv.stage != 0) {
+            volEnvNoteOff(&env);
+            volEnvNoteOff(&blockEnv);
+        }
+        volEnvRenderBlock(&blockEnv, block, len);
+        for (int i = 0; i < len; i++) maxErr = fmax(maxErr, fabs(block[i] - (float)volEnvNext(&env)));
+    }
+    check("volEnvRenderBlock", maxErr, 0.0);
+
+    // Modulation envelope per sample and per 16-sample control period
+    for (int period = 1; period <= 16; period += 15) {
+        ModEnv mod;
+        modEnvInit(&mod, 48000.0);
+        modEnvSetFromSf2(&mod, -3600.0, -1200.0, -2400.0, 0.0, 0.3, -600.0);
+        ref = refEnvFromSf2(48000.0, -3600.0, -1200.0, -2400.0, 0.0, 0.3, -600.0, MIN_MOD_RELEASE_SEC);
+        modEnvNoteOn(&mod);
+        maxErr = 0.0;
+        for (int n = 0; n < 48000 * 3; n += period) {
+            if (n == 48000 * 2) {
+                modEnvNoteOff(&mod);
+                refEnvRelease(&ref);
+            }
+            double y = modEnvStep(&mod, period);
+            maxErr = fmax(maxErr, fabs(y - modEnvReferenceStep(&ref, period)));
+        }
+        check(period == 1 ? "modEnvNext" : "modEnvStep (16)", maxErr, MOD_ENV_LIMIT);
+    }
+
+    ModEnv mod, blockMod;
+    modEnvInit(&mod, 48000.0);
+    modEnvSetFromSf2(&mod, -3600.0, -1200.0, -2400.0, 0.0, 0.3, -600.0);
+    blockMod = mod;
+    modEnvNoteOn(&mod);
+    modEnvNoteOn(&blockMod);
+    maxErr = 0.0;
+    for (int n = 0, len = 1; n < 48000 * 3; n += len, len = len % 257 + 1) {
+        if (n >= 48000 * 2 && blockMod.stage != 6 && blockMod.stage != 0) {
+            modEnvNoteOff(&mod);
+            modEnvNoteOff(&blockMod);
+        }
+        modEnvRenderBlock(&blockMod, block, len);
+        for (int i = 0; i < len; i++) maxErr = fmax(maxErr, fabs(block[i] - (float)modEnvNext(&mod)));
+    }
+    check("modEnvRenderBlock", maxErr, 0.0);
+
+    return failures ? 1 : 0;
+}
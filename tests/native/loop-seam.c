@@ -0,0 +1,81 @@
+// Loop playback check for dsp.c: a looping voice must render exactly what a
+// non-looping voice renders from the same loop unrolled end to end, for every
+// interpolator, at a fractional pitch and over about a minute, so loop wraps
+// neither click (reads across the loop point come from the seam, not from the
+// data after loopEnd) nor drift (32.32 phase, wrap by subtraction). Built and
+// run by tests/dsp-native.test.js:
+//   cc -O2 tests/native/loop-seam.c -lm
+#include "../../src/dsp.c"
+#include "test-util.h"
+
+#define FRAMES 128
+#define BLOCKS 22500 // 60 s
+#define PREFIX 100
+#define TAIL 64
+
+static unsigned int seed = 1;
+static int16_t noise(void) {
+    seed = seed * 1103515245u + 12345u;
+    return (int16_t)((seed >> 16) & 0x7fff) - 16384;
+}
+
+// Renders BLOCKS quanta of one voice and returns the first differing frame
+// against `ref` (or -1), storing the output in `out` when ref is NULL
+static float* renderVoice(const int16_t* data, int length, int looping, int loopStart, int loopEnd,
+                          int interp, double rate) {
+    static float outL[FRAMES], outR[FRAMES];
+    float* all = (float*)malloc((size_t)BLOCKS * FRAMES * sizeof(float));
+    Voice* v = voiceCreate(SR);
+    voiceSetInterpolation(v, interp);
+    voiceSetControlInterval(v, 16);
+    voiceSetSample(v, data, NULL, length, 0, 1.0, 1.0, loopStart, loopEnd, looping ? 1 : 0);
+    voiceSetPitch(v, rate, 0.0, 0.0);
+    voiceSetFilter(v, 13500.0, 0.0, 0.0);
+    voiceSetGain(v, 1.0, 0.0);
+    voiceNoteOn(v);
+    for (int b = 0; b < BLOCKS; b++) {
+        memset(outL, 0, sizeof outL);
+        memset(outR, 0, sizeof outR);
+        voiceRenderBlock(v, outL, outR, FRAMES);
+        memcpy(all + b * FRAMES, outL, sizeof outL);
+    }
+    voiceDestroy(v);
+    return all;
+}
+
+static void checkLoop(int loopLen, int interp, double rate, const char* name) {
+    // Looping sample: prefix, loop, then unrelated data a wrap must not read
+    int length = PREFIX + loopLen + TAIL;
+    int16_t* looped = (int16_t*)malloc((size_t)length * sizeof(int16_t));
+    for (int i = 0; i < length; i++) looped[i] = noise();
+
+    // Reference: the same prefix with the loop repeated past what 60 s needs
+    int unrolledLen = PREFIX + (int)(rate * BLOCKS * FRAMES) + 4 * loopLen + 64;
+    int16_t* unrolled = (int16_t*)malloc((size_t)unrolledLen * sizeof(int16_t));
+    for (int i = 0; i < unrolledLen; i++) {
+        unrolled[i] = i < PREFIX ? looped[i] : looped[PREFIX + (i - PREFIX) % loopLen];
+    }
+
+    float* a = renderVoice(looped, length, 1, PREFIX, PREFIX + loopLen, interp, rate);
+    float* b = renderVoice(unrolled, unrolledLen, 0, 0, 0, interp, rate);
+    int same = memcmp(a, b, (size_t)BLOCKS * FRAMES * sizeof(float)) == 0;
+    float peak = 0.0f;
+    for (int i = 0; i < BLOCKS * FRAMES; i++) peak = fmaxf(peak, fabsf(b[i]));
+    check(name, same && peak > 0.01f);
+    free(a);
+    free(b);
+    free(looped);
+    free(unrolled);
+}
+
+int main(void) {
+    checkLoop(4410, INTERP_LINEAR, 1.37, "linear, 4410-frame loop");
+    checkLoop(4410, INTERP_HERMITE, 1.37, "hermite, 4410-frame loop");
+    checkLoop(4410, INTERP_SINC8, 1.37, "sinc8, 4410-frame loop");
+    checkLoop(4410, INTERP_SINC16, 0.731, "sinc16, 4410-frame loop, pitched down");
+    checkLoop(32, INTERP_SINC16, 1.37, "sinc16, 32-frame loop (the SF2 minimum)");
+    checkLoop(32, INTERP_SINC16, 13.3, "sinc16, 32-frame loop, wrap every 3 frames");
+    checkLoop(997, INTERP_HERMITE, 7.9, "hermite, several frames per loop pass");
+
+    return testResult();
+}
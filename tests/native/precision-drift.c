@@ -0,0 +1,134 @@
+// Float32 drift check for dsp.c: renders the same scenes with the default
+// double engine and with -DDSP_FLOAT32 and requires the difference to stay
+// DRIFT_LIMIT_DB below the double signal, overall and in every 100 ms window.
+// Built twice and run by tests/dsp-native.test.js:
+//   cc -O2 tests/native/precision-drift.c -o drift-double -lm
+//   cc -O2 -DDSP_FLOAT32 tests/native/precision-drift.c -o drift-float -lm
+//   ./drift-double ref.bin && ./drift-float ref.bin
+// The double build writes the reference; the float build compares against it.
+#include <stdio.h>
+#include "../../src/dsp.c"
+
+#define SR 48000.0
+#define FRAMES 128
+#define SECONDS 8
+#define TOTAL ((int)SR * SECONDS)
+#define WINDOW 4800
+#define BANK 48000
+#define DRIFT_LIMIT_DB -90.0
+
+static int16_t bank[BANK];
+static float outL[TOTAL], outR[TOTAL];
+
+typedef struct {
+    const char* name;
+    double filterFc;     // cents
+    double modEnvToFc;   // cents
+    double vibToPitch;   // cents
+    int notes;
+    int interpolation;   // INTERP_*
+    int controlInterval;
+} Scene;
+
+static const Scene scenes[] = {
+    { "open filter, sinc8", 13500, 0, 0, 1, INTERP_SINC8, 16 },
+    { "low cutoff sweep", 4000, 4800, 0, 1, INTERP_SINC8, 16 },
+    { "vibrato, hermite", 9000, 0, 50, 1, INTERP_HERMITE, 16 },
+    { "chord, per-sample control", 7000, 2400, 20, 6, INTERP_LINEAR, 1 },
+};
+
+// Looping harmonic tone with a 1 s loop
+static void fillBank(void) {
+    for (int i = 0; i < BANK; i++) {
+        double ph = 2.0 * M_PI * 220.0 * i / SR;
+        bank[i] = (int16_t)(9000.0 * sin(ph) + 4000.0 * sin(3.0 * ph) + 2000.0 * sin(7.0 * ph));
+    }
+}
+
+static void renderScene(const Scene* sc) {
+    Synth* s = synthCreate(SR);
+    synthSetSampleBank(s, bank, BANK);
+    synthSetInterpolation(s, sc->interpolation);
+    synthSetControlInterval(s, sc->controlInterval);
+    synthSetRegionCount(s, 0, 1);
+    Region* r = synthGetRegion(s, 0, 0);
+    regionSetRanges(r, 0, 127, 0, 127);
+    regionSetSample(r, 0, BANK, 1.0, -1, 0, 1.0, 0, BANK, 1, SR);
+    regionSetTuning(r, 57, 100, 0, 0);
+    // Long attack, decay and release so the envelopes run for whole seconds
+    regionSetVolEnv(r, -12000, -1200, -12000, 1200, 120, 0);
+    regionSetModEnv(r, -12000, 0, -12000, 0, 0.2, 0);
+    regionSetFilter(r, sc->filterFc, sc->modEnvToFc, 300);
+    regionSetModLfo(r, -12000, -600, 10);
+    regionSetVibLfo(r, -1200, 0, sc->vibToPitch);
+
+    memset(outL, 0, sizeof outL);
+    memset(outR, 0, sizeof outR);
+    for (int n = 0; n < sc->notes; n++) synthNoteOn(s, 0, 57 + n * 4, 60 + n * 10);
+    for (int pos = 0; pos < TOTAL; pos += FRAMES) {
+        if (pos == TOTAL / 2) {
+            for (int n = 0; n < sc->notes; n++) synthNoteOff(s, 0, 57 + n * 4);
+        }
+        synthRender(s, outL + pos, outR + pos, FRAMES);
+    }
+    synthDestroy(s);
+}
+
+static inline double ratioDb(double err, double ref) {
+    return 10.0 * log10(fmax(err, 1e-30) / fmax(ref, 1e-30));
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <reference file>\n", argv[0]);
+        return 2;
+    }
+    fillBank();
+    int sceneCount = (int)(sizeof(scenes) / sizeof(scenes[0]));
+
+#ifndef DSP_FLOAT32
+    FILE* f = fopen(argv[1], "wb");
+    if (!f) return 2;
+    for (int k = 0; k < sceneCount; k++) {
+        renderScene(&scenes[k]);
+        fwrite(outL, sizeof(float), TOTAL, f);
+        fwrite(outR, sizeof(float), TOTAL, f);
+    }
+    fclose(f);
+    printf("wrote double reference for %d scenes\n", sceneCount);
+    return 0;
+#else
+    static float refL[TOTAL], refR[TOTAL];
+    FILE* f = fopen(argv[1], "rb");
+    if (!f) return 2;
+    int failures = 0;
+    for (int k = 0; k < sceneCount; k++) {
+        if (fread(refL, sizeof(float), TOTAL, f) != TOTAL || fread(refR, sizeof(float), TOTAL, f) != TOTAL) {
+            fclose(f);
+            return 2;
+        }
+        renderScene(&scenes[k]);
+
+        double errSum = 0.0, refSum = 0.0, worst = -1e9;
+        for (int w = 0; w < TOTAL; w += WINDOW) {
+            double e = 0.0, p = 0.0;
+            for (int i = w; i < w + WINDOW && i < TOTAL; i++) {
+                double dl = outL[i] - refL[i], dr = outR[i] - refR[i];
+                e += dl * dl + dr * dr;
+                p += (double)refL[i] * refL[i] + (double)refR[i] * refR[i];
+            }
+            errSum += e;
+            refSum += p;
+            // Windows where the reference itself is near silence say nothing
+            if (p / WINDOW > 1e-8) worst = fmax(worst, ratioDb(e, p));
+        }
+        double overall = ratioDb(errSum, refSum);
+        int ok = overall <= DRIFT_LIMIT_DB && worst <= DRIFT_LIMIT_DB;
+        printf("%-28s drift %7.1f dB, worst window %7.1f dB (limit %.0f) %s\n",
+               scenes[k].name, overall, worst, DRIFT_LIMIT_DB, ok ? "ok" : "FAIL");
+        if (!ok) failures++;
+    }
+    fclose(f);
+    return failures ? 1 : 0;
+#endif
+}
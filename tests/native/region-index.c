@@ -0,0 +1,96 @@
+// Key/velocity region index check for dsp.c: for every (note, velocity) the
+// index must yield exactly the regions a full table scan matches, in table
+// order, including after the table is replaced; a packed table loaded with
+// synthLoadRegions must index the same way. Built and run by
+// tests/dsp-native.test.js:
+//   cc -O2 tests/native/region-index.c -lm
+#include "../../src/dsp.c"
+#include "test-util.h"
+
+#define REGIONS 400
+
+static unsigned rng = 12345;
+
+static int nextRand(int n) {
+    rng = rng * 1103515245u + 12345u;
+    return (int)((rng >> 16) % (unsigned)n);
+}
+
+// Drum-kit-like table: mostly single keys, some wide layers and velocity splits
+static void fillTable(Synth* s, int channel, int count) {
+    synthSetRegionCount(s, channel, count);
+    for (int i = 0; i < count; i++) {
+        Region* r = synthGetRegion(s, channel, i);
+        int kl = nextRand(128), kh = kl + (nextRand(4) == 0 ? nextRand(128 - kl) : 0);
+        int vl = nextRand(3) == 0 ? nextRand(128) : 0;
+        int vh = vl + nextRand(128 - vl);
+        regionSetRanges(r, kl, kh, vl, vh);
+    }
+}
+
+static int matchesScan(Synth* s, int channel) {
+    const SynthChannel* ch = &s->channels[channel];
+    for (int note = 0; note < 128; note++) {
+        for (int vel = 0; vel < 128; vel++) {
+            int count;
+            const int* list = synthLookupRegions(s, channel, note, vel, &count);
+            if (!list) return 0;
+            int n = 0;
+            for (int i = 0; i < ch->regionCount; i++) {
+                const Region* r = &ch->regions[i];
+                if (note < r->keyLo || note > r->keyHi || vel < r->velLo || vel > r->velHi) continue;
+                if (n >= count || list[n] != i) return 0;
+                n++;
+            }
+            if (n != count) return 0;
+        }
+    }
+    return 1;
+}
+
+int main(void) {
+    Synth* s = synthCreate(SR);
+
+    fillTable(s, 0, REGIONS);
+    check("index matches full scan", matchesScan(s, 0));
+
+    fillTable(s, 0, 37);
+    check("rebuilt after table replaced", matchesScan(s, 0));
+
+    synthSetRegionCount(s, 1, 0);
+    int count = -1;
+    synthLookupRegions(s, 1, 60, 100, &count);
+    check("empty table yields no regions", count == 0);
+
+    Region* r = synthGetRegion(s, 0, 0);
+    regionSetRanges(r, 0, 127, 0, 127);
+    check("rebuilt after region edited", matchesScan(s, 0));
+
+    // Same ranges through the packed column layout
+    const SynthChannel* ch = &s->channels[0];
+    int n = ch->regionCount;
+    static int32_t ints[REGION_INT_COLUMNS * REGIONS];
+    static float floats[REGION_FLOAT_COLUMNS * REGIONS];
+    for (int i = 0; i < n; i++) {
+        const Region* r = &ch->regions[i];
+        ints[REGION_COL_KEY_LO * n + i] = r->keyLo;
+        ints[REGION_COL_KEY_HI * n + i] = r->keyHi;
+        ints[REGION_COL_VEL_LO * n + i] = r->velLo;
+        ints[REGION_COL_VEL_HI * n + i] = r->velHi;
+        ints[REGION_COL_ROOT_KEY * n + i] = 60 + i;
+        floats[REGION_FCOL_MOD_ENV * n + i] = (float)i;
+    }
+    check("packed table loads", synthLoadRegions(s, 2, ints, floats, n));
+    int same = s->channels[2].regionCount == n;
+    for (int i = 0; same && i < n; i++) {
+        const Region* a = &ch->regions[i];
+        const Region* b = &s->channels[2].regions[i];
+        same = a->keyLo == b->keyLo && a->keyHi == b->keyHi && a->velLo == b->velLo && a->velHi == b->velHi &&
+               b->rootKey == 60 + i && b->modEnv[0] == (double)i;
+    }
+    check("packed columns land in their fields", same);
+    check("packed table index matches full scan", matchesScan(s, 2));
+
+    synthDestroy(s);
+    return testResult();
+}
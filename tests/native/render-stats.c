@@ -0,0 +1,97 @@
+// Profiling counter check for dsp.c: blocks, voice peak/sum, steals, fade
+// cuts and event queue depth must count what the engine did, the stage
+// timings must stay within the render time and only run with profiling on,
+// and profiling must not change the output. Built and run by
+// tests/dsp-native.test.js:
+//   cc -O2 tests/native/render-stats.c -lm
+#include "../../src/dsp.c"
+#include "test-util.h"
+
+#define FRAMES 128
+#define STATS_FIELDS 14 // SYNTH_STATS_FIELDS in sf2-processor.js
+
+static float outL[FRAMES], outR[FRAMES];
+
+static Synth* statsSynth(int maxVoices) {
+    return makeSynth(1, maxVoices, -12000, -12000, 0, 1200);
+}
+
+// Plays a few notes through scheduled events and hashes the output
+static uint64_t renderSong(int profiling) {
+    Synth* s = statsSynth(8);
+    synthSetProfiling(s, profiling);
+    uint64_t h = 1469598103934665603ull;
+    for (int b = 0; b < 64; b++) {
+        if (b % 8 == 0) synthScheduleEvent(s, (b * 7) % FRAMES, SYNTH_EVENT_NOTE_ON, 0, 48 + b / 4, 100, 0);
+        if (b % 8 == 4) synthScheduleEvent(s, (b * 5) % FRAMES, SYNTH_EVENT_NOTE_OFF, 0, 48 + (b - 4) / 4, 0, 0);
+        synthRender(s, outL, outR, FRAMES);
+        for (int i = 0; i < FRAMES; i++) {
+            uint32_t bits[2];
+            memcpy(&bits[0], &outL[i], 4);
+            memcpy(&bits[1], &outR[i], 4);
+            h = (h ^ bits[0]) * 1099511628211ull;
+            h = (h ^ bits[1]) * 1099511628211ull;
+        }
+    }
+    synthDestroy(s);
+    return h;
+}
+
+int main(void) {
+    fillBank(0.0);
+    check("stats are doubles only", sizeof(SynthStats) == STATS_FIELDS * sizeof(double));
+
+    // Blocks, frames and voice counts
+    Synth* s = statsSynth(4);
+    const SynthStats* st = synthGetStats(s);
+    synthNoteOn(s, 0, 60, 100);
+    synthRender(s, outL, outR, FRAMES);
+    synthNoteOn(s, 0, 62, 100);
+    synthNoteOn(s, 0, 64, 100);
+    synthRender(s, outL, outR, 100);
+    synthRender(s, outL, outR, FRAMES);
+    check("blocks counted", st->blocks == 3);
+    check("frames counted", st->frames == 2 * FRAMES + 100);
+    check("voice peak", st->voicesPeak == 3);
+    check("voice sum gives the average", st->voicesSum == 1 + 3 + 3);
+    check("no steals within the budget", st->voicesStolen == 0 && st->voicesCut == 0);
+    check("timings off by default", st->renderSeconds == 0 && st->voiceSeconds == 0 && st->loadPeak == 0);
+
+    // Steals: one into a fade slot, then more than the fade slots hold
+    synthNoteOn(s, 0, 65, 100);
+    synthNoteOn(s, 0, 67, 100);
+    check("steal counted", st->voicesStolen == 1 && st->voicesCut == 0);
+    for (int i = 0; i < SYNTH_FADE_VOICES; i++) synthNoteOn(s, 0, 70 + i, 100);
+    check("steals past the fade slots are cuts",
+          st->voicesStolen == 1 + SYNTH_FADE_VOICES && st->voicesCut == 1);
+
+    synthResetStats(s);
+    check("reset clears the counters", st->blocks == 0 && st->voicesStolen == 0 && st->voicesPeak == 0);
+
+    // Event queue depth and rejections
+    for (int i = 0; i < 5; i++) synthScheduleEvent(s, 10 * i, SYNTH_EVENT_NOTE_OFF, 0, 60, 0, 0);
+    check("queue peak", st->eventsQueuedPeak == 5);
+    synthRender(s, outL, outR, FRAMES);
+    for (int i = 0; i < SYNTH_EVENT_CAPACITY; i++) synthScheduleEvent(s, FRAMES, SYNTH_EVENT_NOTE_OFF, 0, 60, 0, 0);
+    check("full queue refuses", !synthScheduleEvent(s, 0, SYNTH_EVENT_NOTE_OFF, 0, 60, 0, 0));
+    check("refusal counted", st->eventsRejected == 1 && st->eventsQueuedPeak == SYNTH_EVENT_CAPACITY);
+    synthClearEvents(s, -1);
+
+    // Stage timings
+    synthResetStats(s);
+    synthSetProfiling(s, 1);
+    for (int b = 0; b < 50; b++) {
+        synthScheduleEvent(s, 64, SYNTH_EVENT_NOTE_ON, 0, 40 + b, 100, 0);
+        synthRender(s, outL, outR, FRAMES);
+    }
+    double stages = st->eventSeconds + st->voiceSeconds + st->mixSeconds;
+    check("render time measured", st->renderSeconds > 0);
+    check("voice and event stages measured", st->voiceSeconds > 0 && st->eventSeconds > 0);
+    check("stages fit inside the render time", stages <= st->renderSeconds);
+    check("peak load measured", st->loadPeak > 0 && st->loadPeak >= st->renderSeconds * SR / st->frames);
+    synthDestroy(s);
+
+    check("profiling leaves the output alone", renderSong(0) == renderSong(1));
+
+    return testResult();
+}
@@ -0,0 +1,51 @@
+// Shared fixture for the native tests: the check() reporter, a sine sample
+// bank and a synth with one looping region on it. Include it after dsp.c (or
+// dsp.h for tests that link the library).
+#ifndef DSP_TEST_UTIL_H
+#define DSP_TEST_UTIL_H
+
+#include <math.h>
+#include <stdio.h>
+#include "../../src/dsp.h"
+
+#define SR 48000.0
+#define BANK 4096
+
+static int failures = 0;
+static int16_t bank[BANK];
+
+// Prints one result line; the runners fail a test on any line with FAIL
+static void check(const char* name, int ok) {
+    printf("%-48s %s\n", name, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+// Exit status for main
+static int testResult(void) {
+    if (failures) printf("%d check(s) FAILED\n", failures);
+    return failures ? 1 : 0;
+}
+
+// Fills `bank` with a sine (0.05 rad per sample) of amplitude 12000 around `dc`
+static inline void fillBank(double dc) {
+    for (int i = 0; i < BANK; i++) bank[i] = (int16_t)(12000.0 * sin(i * 0.05) + dc);
+}
+
+// A synth on `bank` with one region looping 256..BANK-256 on each of the
+// first `channels` channels, with an instant attack and hold and the given
+// volume envelope (timecents / cB); maxVoices 0 keeps the default budget
+static inline Synth* makeSynth(int channels, int maxVoices, double delayTc, double decayTc,
+                               double sustainCb, double releaseTc) {
+    Synth* s = synthCreate(SR);
+    synthSetSampleBank(s, bank, BANK);
+    if (maxVoices > 0) synthSetMaxVoices(s, maxVoices);
+    for (int c = 0; c < channels; c++) {
+        synthSetRegionCount(s, c, 1);
+        Region* r = synthGetRegion(s, c, 0);
+        regionSetSample(r, 0, BANK, 1.0, -1, 0, 1.0, 256, BANK - 256, 1, SR);
+        regionSetVolEnv(r, delayTc, -12000, -12000, decayTc, sustainCb, releaseTc);
+    }
+    return s;
+}
+
+#endif
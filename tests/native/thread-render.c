@@ -0,0 +1,138 @@
+// Threaded render check for dsp.c (DSP_THREADS): a busy three-channel song
+// with voice stealing, scheduled events, effects sends and odd block sizes
+// must hash the same for every render thread count, on both render calls. Built and run by
+// tests/dsp-native.test.js:
+//   cc -O2 -DDSP_THREADS -pthread tests/native/thread-render.c -lm
+#include "../../src/dsp.c"
+#include "test-util.h"
+
+#define SONG 48000 // frames per channel of the song's stereo sample
+#define MAX_FRAMES 1000
+#define SECONDS 3
+
+static int16_t song[SONG * 2];
+static float outL[MAX_FRAMES], outR[MAX_FRAMES];
+static float channels[SYNTH_CHANNELS * 2 * MAX_FRAMES];
+static float fxReturn[2 * MAX_FRAMES];
+
+static uint32_t lcg(uint32_t* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static void hashFloats(uint64_t* h, const float* x, int n) {
+    for (int i = 0; i < n; i++) {
+        uint32_t bits;
+        memcpy(&bits, &x[i], sizeof bits);
+        *h = (*h ^ bits) * 1099511628211ull;
+    }
+}
+
+static Synth* songSynth(void) {
+    Synth* s = synthCreate(SR);
+    synthSetSampleBank(s, song, SONG * 2);
+    synthSetMaxVoices(s, 48);
+
+    // Channel 0: mono sinc pad with a delayed attack
+    synthSetRegionCount(s, 0, 1);
+    Region* r = synthGetRegion(s, 0, 0);
+    regionSetSample(r, 0, SONG, 1.0, -1, 0, 1.0, 4000, SONG - 4000, 1, SR);
+    regionSetVolEnv(r, -3000, -4000, -12000, 1200, 100, -1800);
+    regionSetModEnv(r, -12000, -3000, -12000, 0, 0.3, -2000);
+    regionSetFilter(r, 9000, 2400, 300);
+    regionSetModLfo(r, -6000, -500, 10);
+    regionSetVibLfo(r, -5000, -200, 15);
+    regionSetEffects(r, 200, 400);
+
+    // Channel 1: stereo keys
+    synthSetRegionCount(s, 1, 1);
+    r = synthGetRegion(s, 1, 0);
+    regionSetSample(r, 0, SONG, 1.0, SONG, SONG, 1.0, 2000, SONG - 2000, 3, SR);
+    regionSetVolEnv(r, -12000, -8000, -12000, 0, 300, -3000);
+    regionSetFilter(r, 11000, 0, 0);
+    regionSetEffects(r, 0, 250);
+
+    // Channel 2: one-shot hits in an exclusive class
+    synthSetRegionCount(s, 2, 1);
+    r = synthGetRegion(s, 2, 0);
+    regionSetSample(r, 0, 6000, 1.0, -1, 0, 1.0, 0, 0, 0, SR);
+    regionSetAmp(r, 30.0, 0.0, 1);
+    regionSetVolEnv(r, -12000, -12000, -12000, -1200, 960, -6000);
+
+    synthSetInterpolation(s, INTERP_SINC8);
+    return s;
+}
+
+// Renders the song with `threads` render threads and hashes the output
+static uint64_t renderSong(int threads, int perChannel, int* rendered) {
+    Synth* s = songSynth();
+    int got = synthSetThreadCount(s, threads);
+    if (got != threads) printf("asked for %d threads, got %d\n", threads, got);
+
+    uint64_t h = 1469598103934665603ull;
+    uint32_t rng = 12345;
+    const int sizes[] = { 128, 128, 37, MAX_FRAMES, 128, 300 };
+    *rendered = 0;
+    int block = 0;
+    for (int done = 0; done < (int)(SECONDS * SR); block++) {
+        int frames = sizes[block % 6];
+        for (int k = 0; k < 4; k++) {
+            int offset = (int)(lcg(&rng) % (uint32_t)frames);
+            int channel = (int)(lcg(&rng) % 3u);
+            int note = 36 + (int)(lcg(&rng) % 48u);
+            int roll = (int)(lcg(&rng) % 8u);
+            if (roll < 4) synthScheduleEvent(s, offset, SYNTH_EVENT_NOTE_ON, channel, note, 60 + roll * 16, 0);
+            else if (roll < 7) synthScheduleEvent(s, offset, SYNTH_EVENT_NOTE_OFF, channel, note, 0, 0);
+            else synthScheduleEvent(s, offset, SYNTH_EVENT_CONTROLLERS, channel, 70 + roll, (int)(lcg(&rng) % 128u), 110);
+        }
+        if (perChannel) {
+            synthRenderChannelsWithReturn(s, channels, fxReturn, frames);
+            hashFloats(&h, channels, SYNTH_CHANNELS * 2 * frames);
+            hashFloats(&h, fxReturn, 2 * frames);
+        } else {
+            synthRender(s, outL, outR, frames);
+            hashFloats(&h, outL, frames);
+            hashFloats(&h, outR, frames);
+        }
+        int n = synthGetRenderedVoiceCount(s);
+        if (n > *rendered) *rendered = n;
+        done += frames;
+    }
+    synthDestroy(s);
+    return h;
+}
+
+int main(void) {
+    for (int i = 0; i < SONG; i++) {
+        double t = i / SR;
+        double x = 0.5 * sin(2.0 * M_PI * 220.0 * t) + 0.25 * sin(2.0 * M_PI * 661.0 * t) +
+                   0.125 * sin(2.0 * M_PI * 1543.0 * t);
+        song[i] = (int16_t)(x * 30000.0);
+        song[SONG + i] = (int16_t)(x * 27000.0);
+    }
+
+    const int counts[] = { 2, 3, 4, 8 };
+    for (int perChannel = 0; perChannel <= 1; perChannel++) {
+        const char* call = perChannel ? "synthRenderChannelsWithReturn" : "synthRender";
+        int rendered;
+        uint64_t one = renderSong(1, perChannel, &rendered);
+        char name[96];
+        snprintf(name, sizeof name, "%s: song is busy (%d voices)", call, rendered);
+        check(name, rendered >= 24);
+        for (int c = 0; c < 4; c++) {
+            int r;
+            snprintf(name, sizeof name, "%s: %d threads match 1", call, counts[c]);
+            check(name, renderSong(counts[c], perChannel, &r) == one);
+        }
+        int r;
+        snprintf(name, sizeof name, "%s: 4 threads repeat", call);
+        check(name, renderSong(4, perChannel, &r) == one);
+#ifndef __FP_FAST_FMAF
+        // Without a fused multiply-add the slot sums round like the direct mix
+        snprintf(name, sizeof name, "%s: matches the unthreaded path", call);
+        check(name, renderSong(0, perChannel, &r) == one);
+#endif
+    }
+
+    return testResult();
+}
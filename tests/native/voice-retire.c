@@ -0,0 +1,76 @@
+// Voice retirement check for dsp.c: a looping voice must finish once its
+// release reaches idle, a voice decaying into silence must finish before its
+// envelope gets there, a voice under cc7 = 0 must keep playing, and a voice
+// in its delay stage must count as active but not rendered. Built and run by
+// tests/dsp-native.test.js:
+//   cc -O2 tests/native/voice-retire.c -lm
+#include "../../src/dsp.c"
+#include "test-util.h"
+
+#define FRAMES 128
+
+static float outL[FRAMES], outR[FRAMES];
+
+static int renderBlocks(Synth* s, int blocks) {
+    for (int b = 0; b < blocks; b++) {
+        memset(outL, 0, sizeof outL);
+        memset(outR, 0, sizeof outR);
+        synthRender(s, outL, outR, FRAMES);
+        if (synthGetActiveVoiceCount(s) == 0) return b + 1;
+    }
+    return -1;
+}
+
+static float peakOut(void) {
+    float p = 0.0f;
+    for (int i = 0; i < FRAMES; i++) p = fmaxf(p, fmaxf(fabsf(outL[i]), fabsf(outR[i])));
+    return p;
+}
+
+int main(void) {
+    fillBank(0.0);
+
+    // Looping voice: finishes after release instead of looping forever
+    Synth* s = makeSynth(1, 0, -12000, -12000, 0, -1200); // ~0.43 s release
+    synthNoteOn(s, 0, 60, 100);
+    renderBlocks(s, 4);
+    check("looping voice sounding", synthGetActiveVoiceCount(s) == 1 && peakOut() > 0.01f);
+    synthNoteOff(s, 0, 60);
+    int blocks = renderBlocks(s, 2000); // ~5.3 s
+    check("looping voice retired after release", blocks > 0);
+    check("retired within release time", blocks > 0 && blocks * FRAMES < 48000);
+    synthDestroy(s);
+
+    // Held note decaying to full attenuation: retired as inaudible
+    s = makeSynth(1, 0, -12000, 0, 1440, -1200); // 1 s decay to -144 dB
+    synthNoteOn(s, 0, 60, 100);
+    blocks = renderBlocks(s, 2000);
+    check("decayed voice retired while held", blocks > 0 && blocks * FRAMES < 48000);
+    synthDestroy(s);
+
+    // Channel volume 0 does not count as silence
+    s = makeSynth(1, 0, -12000, -12000, 0, -1200);
+    synthSetControllers(s, 0, 0, 64, 127);
+    synthNoteOn(s, 0, 60, 100);
+    renderBlocks(s, 100);
+    check("muted channel voice kept", synthGetActiveVoiceCount(s) == 1);
+    synthSetControllers(s, 0, 127, 64, 127);
+    renderBlocks(s, 4);
+    check("muted channel voice audible again", peakOut() > 0.01f);
+    synthDestroy(s);
+
+    // Delay stage: active, not rendered, silent; then rendered once it sounds
+    s = makeSynth(1, 0, 0, -12000, 0, -1200); // 1 s delay
+    synthNoteOn(s, 0, 60, 100);
+    synthNoteOn(s, 0, 64, 100);
+    renderBlocks(s, 1);
+    check("delayed voices active", synthGetActiveVoiceCount(s) == 2);
+    check("delayed voices not rendered", synthGetRenderedVoiceCount(s) == 0);
+    check("delayed voices silent", peakOut() == 0.0f);
+    renderBlocks(s, 48000 / FRAMES);
+    check("voices rendered after delay", synthGetRenderedVoiceCount(s) == 2);
+    check("voices audible after delay", peakOut() > 0.01f);
+    synthDestroy(s);
+
+    return testResult();
+}
@@ -0,0 +1,81 @@
+// Voice stealing check for dsp.c: with the budget full, a new note must take
+// a releasing voice before a held one and the quietest held voice before a
+// louder, older one, and the stolen voice must fade out over
+// SYNTH_STEAL_FADE_SEC rather than stop dead. Built and run by
+// tests/dsp-native.test.js:
+//   cc -O2 tests/native/voice-steal.c -lm
+#include "../../src/dsp.c"
+#include "test-util.h"
+
+#define FRAMES 128
+
+static float outL[FRAMES], outR[FRAMES];
+
+// Long release so released voices stay audible
+static Synth* stealSynth(int maxVoices) {
+    return makeSynth(1, maxVoices, -12000, -12000, 0, 1200);
+}
+
+static const Voice* findVoice(const Synth* s, int note) {
+    for (int i = 0; i < s->maxVoices; i++) {
+        if (!s->voices[i].finished && s->voices[i].note == note) return &s->voices[i];
+    }
+    return NULL;
+}
+
+static int fadingCount(const Synth* s) {
+    int n = 0;
+    for (int i = 0; i < SYNTH_FADE_VOICES; i++) n += !s->fading[i].finished;
+    return n;
+}
+
+int main(void) {
+    fillBank(0.0);
+
+    // Releasing voice goes before the oldest held one
+    Synth* s = stealSynth(3);
+    synthNoteOn(s, 0, 60, 100);
+    synthNoteOn(s, 0, 62, 100);
+    synthNoteOn(s, 0, 64, 100);
+    synthRender(s, outL, outR, FRAMES);
+    synthNoteOff(s, 0, 64);
+    synthRender(s, outL, outR, FRAMES);
+    synthNoteOn(s, 0, 65, 100);
+    check("releasing voice stolen first", findVoice(s, 60) && findVoice(s, 62) && !findVoice(s, 64));
+    check("new note sounding", findVoice(s, 65) != NULL);
+    check("stolen voice fading", fadingCount(s) == 1);
+
+    int fadeFrames = (int)(SYNTH_STEAL_FADE_SEC * SR) + 1;
+    int blocks = (fadeFrames + FRAMES - 1) / FRAMES;
+    for (int b = 0; b < blocks; b++) synthRender(s, outL, outR, FRAMES);
+    check("fade finishes within the fade time", fadingCount(s) == 0);
+    synthDestroy(s);
+
+    // Quietest held voice goes before a louder, older one
+    s = stealSynth(2);
+    synthNoteOn(s, 0, 60, 127);
+    synthNoteOn(s, 0, 62, 20);
+    synthRender(s, outL, outR, FRAMES);
+    synthNoteOn(s, 0, 64, 100);
+    check("quiet held voice stolen before loud", findVoice(s, 60) && !findVoice(s, 62) && findVoice(s, 64));
+    synthDestroy(s);
+
+    // The fade starts at the stolen voice's level: the first faded frame
+    // stays close to the last frame before the steal
+    float refL[FRAMES], refR[FRAMES];
+    s = stealSynth(1);
+    synthNoteOn(s, 0, 60, 100);
+    synthRender(s, refL, refR, FRAMES);
+    synthNoteOn(s, 0, 48, 1);
+    Voice* fade = NULL;
+    for (int i = 0; i < SYNTH_FADE_VOICES; i++) if (!s->fading[i].finished) fade = &s->fading[i];
+    check("single-voice budget still fades", fade != NULL);
+    if (fade) {
+        float l[FRAMES] = { 0 }, r[FRAMES] = { 0 };
+        voiceRenderBlock(fade, l, r, 1);
+        check("fade starts at the voice's level", fabsf(l[0]) > 0.0f && fabsf(l[0] - refL[FRAMES - 1]) < 0.1f);
+    }
+    synthDestroy(s);
+
+    return testResult();
+}
@@ -79,6 +79,66 @@ describe('WASM Binary Implementation Tests', () => {
     expect(processorContent).toContain("throw new Error('WASM module not initialized')");
   });
 
+  test('sf2-processor.js event ring reader matches the event-ring.js layout', () => {
+    const ringContent = fs.readFileSync(path.join(__dirname, '..', 'src', 'event-ring.js'), 'utf-8');
+    const processorContent = fs.readFileSync(path.join(__dirname, '..', 'src', 'sf2-processor.js'), 'utf-8');
+    // The engine's SYNTH_EVENT_* codes are declared in dsp.h
+    const dspContent = fs.readFileSync(path.join(__dirname, '..', 'src', 'dsp.h'), 'utf-8');
+    const constant = (src, name) => Number(src.match(new RegExp(`const ${name} = (\\d+);`))?.[1]);
+
+    expect(constant(processorContent, 'RING_HEADER_WORDS')).toBe(constant(ringContent, 'HEADER_WORDS'));
+    expect(constant(processorContent, 'RING_RECORD_WORDS')).toBe(constant(ringContent, 'RECORD_WORDS'));
+    expect(constant(processorContent, 'RING_WRITE')).toBe(constant(ringContent, 'WRITE'));
+    expect(constant(processorContent, 'RING_READ')).toBe(constant(ringContent, 'READ'));
+    expect(constant(processorContent, 'RING_CAPACITY')).toBe(constant(ringContent, 'CAPACITY'));
+    // Ring record types are passed to synthScheduleEvent unchanged
+    for (const [ring, engine] of [
+      ['EVENT_RING_NOTE_ON', 'SYNTH_EVENT_NOTE_ON'],
+      ['EVENT_RING_NOTE_OFF', 'SYNTH_EVENT_NOTE_OFF'],
+      ['EVENT_RING_ALL_NOTES_OFF', 'SYNTH_EVENT_ALL_NOTES_OFF'],
+      ['EVENT_RING_CONTROLLERS', 'SYNTH_EVENT_CONTROLLERS'],
+    ]) {
+      const code = Number(dspContent.match(new RegExp(`${engine} = (\\d+)`))?.[1]);
+      expect(Number.isInteger(code)).toBe(true);
+      expect(constant(ringContent.replace(/export /g, ''), ring)).toBe(code);
+      expect(constant(processorContent, engine)).toBe(code);
+    }
+  });
+
+  test('packed region table layout matches across sf2-parser.js, sf2-processor.js and dsp.h', () => {
+    const parserContent = fs.readFileSync(path.join(__dirname, '..', 'src', 'sf2-parser.js'), 'utf-8');
+    const processorContent = fs.readFileSync(path.join(__dirname, '..', 'src', 'sf2-processor.js'), 'utf-8');
+    // REGION_COL_* / REGION_FCOL_* and the column counts are enums in dsp.h
+    const dspContent = fs.readFileSync(path.join(__dirname, '..', 'src', 'dsp.h'), 'utf-8');
+    const columns = (name) => parserContent
+      .match(new RegExp(`export const ${name} = \\[([^\\]]*)\\]`))[1]
+      .match(/"\w+"/g)
+      .map((c) => c.slice(1, -1));
+    const jsConstant = (name) => Number(processorContent.match(new RegExp(`const ${name} = (\\d+);`))?.[1]);
+    const cConstant = (name) => Number(dspContent.match(new RegExp(`${name} = (\\d+),`))?.[1]);
+
+    const intColumns = columns('REGION_INT_COLUMNS');
+    const floatColumns = columns('REGION_FLOAT_COLUMNS');
+    expect(cConstant('REGION_INT_COLUMNS')).toBe(intColumns.length);
+    expect(cConstant('REGION_FLOAT_COLUMNS')).toBe(floatColumns.length);
+    expect(jsConstant('REGION_INT_COLUMNS')).toBe(intColumns.length);
+    expect(jsConstant('REGION_FLOAT_COLUMNS')).toBe(floatColumns.length);
+    for (const [name, column] of [
+      ['REGION_COL_OFFSET_L', 'offsetL'],
+      ['REGION_COL_LENGTH', 'length'],
+      ['REGION_COL_OFFSET_R', 'offsetR'],
+      ['REGION_COL_LENGTH_R', 'lengthR'],
+    ]) {
+      expect(cConstant(name)).toBe(intColumns.indexOf(column));
+      expect(jsConstant(name)).toBe(intColumns.indexOf(column));
+    }
+    expect(cConstant('REGION_FCOL_VOL_ENV')).toBe(floatColumns.indexOf('volDelayTc'));
+    expect(cConstant('REGION_FCOL_MOD_ENV')).toBe(floatColumns.indexOf('modDelayTc'));
+    expect(cConstant('REGION_FCOL_VIB_LFO_TO_PITCH')).toBe(floatColumns.indexOf('vibLfoToPitchCents'));
+    expect(cConstant('REGION_FCOL_CHORUS_SEND')).toBe(floatColumns.indexOf('chorusSend'));
+    expect(cConstant('REGION_FCOL_REVERB_SEND')).toBe(floatColumns.indexOf('reverbSend'));
+  });
+
   test('Built dist includes WASM files', () => {
     const distPath = path.join(__dirname, '..', 'dist');
     const wasmPath = path.join(distPath, 'dsp.wasm');
@@ -1,7 +1,16 @@
 import { defineConfig } from "vite";
 import react from "@vitejs/plugin-react";
 
+// Cross-origin isolation enables SharedArrayBuffer, which lets every track
+// worklet share one sample bank. Without it the app falls back to copies.
+const crossOriginIsolationHeaders = {
+  "Cross-Origin-Opener-Policy": "same-origin",
+  "Cross-Origin-Embedder-Policy": "credentialless",
+};
+
 export default defineConfig(({ command }) => ({
   plugins: [react()],
-  base: "/gbk/"
+  base: "/gbk/",
+  server: { headers: crossOriginIsolationHeaders },
+  preview: { headers: crossOriginIsolationHeaders }
 }));